@@ -0,0 +1,81 @@
+#ifndef deribit_messages
+#define deribit_messages
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Builds messages shaped like the ones Deribit sends for BTC-PERPETUAL, prices
+// are on the 0.5 tick and sizes are whole contracts as on the live feed.
+namespace DeribitMessages {
+
+// Header up to and including MsgSeqNum, BodyLength and CheckSum are filled in
+// by `finish`.
+inline std::string header(char type) {
+  return std::string("35=") + type +
+         "\x01"
+         "49=DERIBITSERVER\x01"
+         "56=CLIENT\x01"
+         "34=1\x01"
+         "52=20240101-00:00:00.000\x01";
+}
+
+inline std::string finish(std::string const& body) {
+  std::string message =
+      "8=FIX.4.4\x01"
+      "9=" +
+      std::to_string(body.size()) + "\x01" + body;
+  unsigned checksum = 0;
+  for (char c : message)
+    checksum += static_cast<unsigned char>(c);
+  char trailer[8];
+  std::snprintf(trailer, sizeof(trailer), "10=%03u\x01", checksum % 256);
+  return message + trailer;
+}
+
+inline std::string price(size_t level, bool bid) {
+  double mid = 64123.5;
+  double offset = (level + 1) * 0.5;
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.1f", bid ? mid - offset : mid + offset);
+  return buffer;
+}
+
+inline std::string size(size_t level) {
+  return std::to_string(10 * (level % 97 + 1));
+}
+
+// A MarketDataSnapshotFullRefresh with `depth` levels on each side.
+inline std::string snapshot(size_t depth) {
+  std::string body = header('W') +
+                     "55=BTC-PERPETUAL\x01"
+                     "231=1\x01"
+                     "311=BTC-PERPETUAL\x01"
+                     "268=" +
+                     std::to_string(depth * 2) + "\x01";
+  for (size_t i = 0; i < depth; i++)
+    for (bool bid : {true, false})
+      body += std::string("269=") + (bid ? "0" : "1") + "\x01" +
+              "270=" + price(i, bid) + "\x01" + "271=" + size(i) + "\x01";
+  return finish(body);
+}
+
+// A MarketDataIncrementalRefresh changing `entries` levels near the touch.
+inline std::string delta(size_t entries) {
+  std::string body = header('X') +
+                     "55=BTC-PERPETUAL\x01"
+                     "268=" +
+                     std::to_string(entries) + "\x01";
+  for (size_t i = 0; i < entries; i++) {
+    bool bid = i % 2 == 0;
+    char action = "012"[i % 3];
+    body += std::string("279=") + action + "\x01" + "269=" + (bid ? "0" : "1") +
+            "\x01" + "270=" + price(i / 2, bid) + "\x01" +
+            "271=" + (action == '2' ? "0" : size(i)) + "\x01";
+  }
+  return finish(body);
+}
+
+}  // namespace DeribitMessages
+
+#endif  // deribit_messages
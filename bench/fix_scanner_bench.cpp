@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/datasources/fix_scanner.h"
+#include "deribit_messages.h"
+#include "latency.h"
+
+// Price and size strings as they appear in a full depth snapshot.
+static std::vector<std::string> values() {
+  std::vector<std::string> values;
+  for (size_t i = 0; i < 1000; i++) {
+    values.push_back(DeribitMessages::price(i, i % 2 == 0));
+    values.push_back(DeribitMessages::size(i));
+  }
+  return values;
+}
+
+static void BM_ParseFixed(benchmark::State& state) {
+  auto strings = values();
+  for (auto _ : state)
+    for (auto const& value : strings)
+      benchmark::DoNotOptimize(FixScanner::parse_fixed(value));
+  state.SetItemsProcessed(state.iterations() * strings.size());
+}
+BENCHMARK(BM_ParseFixed);
+
+static void BM_ParseFixedScalar(benchmark::State& state) {
+  auto strings = values();
+  for (auto _ : state)
+    for (auto const& value : strings)
+      benchmark::DoNotOptimize(FixScanner::parse_fixed_scalar(value));
+  state.SetItemsProcessed(state.iterations() * strings.size());
+}
+BENCHMARK(BM_ParseFixedScalar);
+
+static void BM_Strtod(benchmark::State& state) {
+  auto strings = values();
+  for (auto _ : state)
+    for (auto const& value : strings)
+      benchmark::DoNotOptimize(std::strtod(value.c_str(), nullptr));
+  state.SetItemsProcessed(state.iterations() * strings.size());
+}
+BENCHMARK(BM_Strtod);
+
+// Walks every field of a snapshot the way the decoder does.
+template <size_t (*find)(std::string_view, size_t)>
+static void BM_ScanFields(benchmark::State& state) {
+  auto raw = DeribitMessages::snapshot(state.range(0));
+  for (auto _ : state) {
+    size_t fields = 0;
+    for (size_t pos = 0; pos < raw.size(); pos = find(raw, pos) + 1)
+      fields++;
+    benchmark::DoNotOptimize(fields);
+  }
+  state.SetBytesProcessed(state.iterations() * raw.size());
+}
+BENCHMARK(BM_ScanFields<FixScanner::find_soh>)->Arg(10)->Arg(1000);
+BENCHMARK(BM_ScanFields<FixScanner::find_soh_scalar>)->Arg(10)->Arg(1000);
+
+static size_t find_soh_memchr(std::string_view raw, size_t pos) {
+  auto soh = std::memchr(raw.data() + pos, FixScanner::SOH, raw.size() - pos);
+  return soh == nullptr ? raw.size()
+                        : static_cast<char const*>(soh) - raw.data();
+}
+BENCHMARK(BM_ScanFields<find_soh_memchr>)->Arg(10)->Arg(1000);
+
+static void BM_DecodeSnapshot(benchmark::State& state) {
+  auto raw = DeribitMessages::snapshot(state.range(0));
+  BidAskSnapshot snapshot;
+  std::string_view symbol;
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    snapshot.bids.clear();
+    snapshot.asks.clear();
+    recorder.time([&]() {
+      benchmark::DoNotOptimize(
+          FixScanner::decode_snapshot(raw, symbol, snapshot));
+    });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_DecodeSnapshot)->Arg(10)->Arg(1000)->Arg(5000);
+
+static void BM_DecodeDelta(benchmark::State& state) {
+  auto raw = DeribitMessages::delta(state.range(0));
+  BidAskDelta delta;
+  std::string_view symbol;
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    delta.bids.clear();
+    delta.asks.clear();
+    recorder.time([&]() {
+      benchmark::DoNotOptimize(FixScanner::decode_delta(raw, symbol, delta));
+    });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeDelta)->Arg(1)->Arg(10)->Arg(100);
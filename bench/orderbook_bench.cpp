@@ -0,0 +1,264 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "../src/orderbook.h"
+#include "latency.h"
+
+// Books are built around BTC-PERPETUAL, ticks of 0.5 around 64000.
+constexpr double TICK_SIZE = 0.5;
+constexpr double MID = 64000;
+constexpr size_t DEPTH = 1000;
+// Operations are generated up front so that the random number generator is
+// not part of what is measured.
+constexpr size_t OPERATIONS = 1 << 16;
+
+typedef struct {
+  Side side;
+  bool remove;
+  Level level;
+} Operation;
+
+static double bid_price(size_t distance) {
+  return MID - TICK_SIZE * (distance + 1);
+}
+
+static double ask_price(size_t distance) {
+  return MID + TICK_SIZE * distance;
+}
+
+template <typename Book>
+static void fill(Book& book, size_t depth) {
+  for (size_t i = 0; i < depth; i++) {
+    book.add_level({bid_price(i), 100}, Side::Bid);
+    book.add_level({ask_price(i), 100}, Side::Ask);
+  }
+}
+
+// Updates concentrated on the first levels of the book, most change a size and
+// the rest remove a level which is added back later.
+static std::vector<Operation> near_touch_churn() {
+  std::mt19937_64 rng(42);
+  std::geometric_distribution<size_t> distance(0.2);
+  std::bernoulli_distribution remove(0.2);
+  std::vector<std::vector<bool>> removed(2, std::vector<bool>(DEPTH));
+
+  std::vector<Operation> operations;
+  for (size_t i = 0; i < OPERATIONS; i++) {
+    Side side = i % 2 == 0 ? Side::Bid : Side::Ask;
+    size_t d = std::min(distance(rng), DEPTH - 1);
+    double price = side == Side::Bid ? bid_price(d) : ask_price(d);
+    bool is_removed = removed[i % 2][d];
+    bool remove_level = !is_removed && remove(rng);
+    removed[i % 2][d] = remove_level;
+    operations.push_back({side, remove_level, {price, double(1 + i % 1000)}});
+  }
+  return operations;
+}
+
+// Aggressive orders walking through the book, each sweep removes the best
+// levels of one side and then refills them.
+static std::vector<Operation> deep_sweeps(size_t levels) {
+  std::vector<Operation> operations;
+  while (operations.size() < OPERATIONS) {
+    Side side = operations.size() / (2 * levels) % 2 == 0 ? Side::Bid : Side::Ask;
+    for (size_t d = 0; d < levels; d++)
+      operations.push_back(
+          {side, true, {side == Side::Bid ? bid_price(d) : ask_price(d), 0}});
+    for (size_t d = levels; d-- > 0;)
+      operations.push_back(
+          {side, false, {side == Side::Bid ? bid_price(d) : ask_price(d), 50}});
+  }
+  return operations;
+}
+
+template <typename Book>
+static void run_operations(benchmark::State& state,
+                           std::vector<Operation> const& operations) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  LatencyRecorder recorder;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& operation = operations[i++ % operations.size()];
+    recorder.time([&]() {
+      if (operation.remove)
+        book.remove_level(operation.level.price, operation.side);
+      else
+        book.add_level(operation.level, operation.side);
+    });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Book>
+static void BM_NearTouchChurn(benchmark::State& state) {
+  run_operations<Book>(state, near_touch_churn());
+}
+
+template <typename Book>
+static void BM_DeepSweep(benchmark::State& state) {
+  run_operations<Book>(state, deep_sweeps(state.range(0)));
+}
+
+template <typename Book>
+static void BM_SnapshotRebuild(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.time([&]() {
+      book.reset();
+      fill(book, state.range(0));
+    });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+// A full refresh of the best `levels` levels of each side, as sent for books
+// subscribed to with a bounded depth. `shift` moves the whole book down by as
+// many ticks.
+static BidAskSnapshot refresh_message(size_t levels, size_t shift) {
+  BidAskSnapshot snapshot;
+  for (size_t d = 0; d < levels; d++) {
+    snapshot.bids.push_back({bid_price(d + shift), 100});
+    snapshot.asks.push_back({ask_price(d + shift), 100});
+  }
+  return snapshot;
+}
+
+// Refreshes replacing the book in place as the price moves a tick back and
+// forth, against `BM_SnapshotRebuild` of as many levels.
+template <typename Book>
+static void BM_ConflatedRefresh(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  BidAskSnapshot messages[] = {refresh_message(state.range(0), 0),
+                               refresh_message(state.range(0), 1)};
+  book.replace(messages[0]);
+  LatencyRecorder recorder;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& message = messages[++i % 2];
+    recorder.time([&]() { book.replace(message); });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+
+// A whole sweep arriving as one message, which takes out the best levels of
+// one side and puts them back with new sizes.
+static BidAskDelta sweep_message(Side side, size_t levels) {
+  BidAskDelta delta;
+  auto& changes = side == Side::Bid ? delta.bids : delta.asks;
+  for (size_t d = 0; d < levels; d++) {
+    double price = side == Side::Bid ? bid_price(d) : ask_price(d);
+    changes.push_back({OfferAction::Remove, {price, 0}});
+  }
+  for (size_t d = levels; d-- > 0;) {
+    double price = side == Side::Bid ? bid_price(d) : ask_price(d);
+    changes.push_back({OfferAction::Update, {price, 50}});
+  }
+  return delta;
+}
+
+template <typename Book>
+static void BM_SweepMessage(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  BidAskDelta messages[] = {sweep_message(Side::Bid, state.range(0)),
+                            sweep_message(Side::Ask, state.range(0))};
+  LatencyRecorder recorder;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& message = messages[i++ % 2];
+    recorder.time([&]() {
+      for (auto const& change : message.bids)
+        if (change.action == OfferAction::Remove)
+          book.remove_level(change.offer.price, Side::Bid);
+        else
+          book.add_level({change.offer.price, change.offer.quantity},
+                         Side::Bid);
+      for (auto const& change : message.asks)
+        if (change.action == OfferAction::Remove)
+          book.remove_level(change.offer.price, Side::Ask);
+        else
+          book.add_level({change.offer.price, change.offer.quantity},
+                         Side::Ask);
+    });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Book>
+static void BM_SweepMessageBatched(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  BidAskDelta messages[] = {sweep_message(Side::Bid, state.range(0)),
+                            sweep_message(Side::Ask, state.range(0))};
+  LatencyRecorder recorder;
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& message = messages[i++ % 2];
+    recorder.time([&]() { book.apply(message); });
+  }
+  recorder.report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Book>
+static void BM_BestBidAsk(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.time([&]() {
+      benchmark::DoNotOptimize(book.best_bid());
+      benchmark::DoNotOptimize(book.best_ask());
+    });
+  }
+  recorder.report(state);
+}
+
+template <typename Book>
+static void BM_TopN(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  LatencyRecorder recorder;
+  for (auto _ : state)
+    recorder.time([&]() { benchmark::DoNotOptimize(book.top_n(state.range(0))); });
+  recorder.report(state);
+}
+
+template <typename Book>
+static void BM_BestLevels(benchmark::State& state) {
+  Book book(TICK_SIZE);
+  fill(book, DEPTH);
+  std::vector<Level> levels(state.range(0));
+  LatencyRecorder recorder;
+  for (auto _ : state) {
+    recorder.time([&]() {
+      benchmark::DoNotOptimize(book.best_levels(Side::Bid, levels));
+      benchmark::DoNotOptimize(book.best_levels(Side::Ask, levels));
+    });
+  }
+  recorder.report(state);
+}
+
+#define BOOK_BENCHMARKS(Book)                                          \
+  BENCHMARK_TEMPLATE(BM_NearTouchChurn, Book);                         \
+  BENCHMARK_TEMPLATE(BM_DeepSweep, Book)->Arg(10)->Arg(100);           \
+  BENCHMARK_TEMPLATE(BM_SweepMessage, Book)->Arg(4)->Arg(100);         \
+  BENCHMARK_TEMPLATE(BM_SweepMessageBatched, Book)->Arg(4)->Arg(100);  \
+  BENCHMARK_TEMPLATE(BM_SnapshotRebuild, Book)->Arg(20)->Arg(DEPTH);   \
+  BENCHMARK_TEMPLATE(BM_ConflatedRefresh, Book)->Arg(10)->Arg(20);     \
+  BENCHMARK_TEMPLATE(BM_BestBidAsk, Book);                             \
+  BENCHMARK_TEMPLATE(BM_TopN, Book)->Arg(5)->Arg(20);                  \
+  BENCHMARK_TEMPLATE(BM_BestLevels, Book)->Arg(5)->Arg(20)
+
+BOOK_BENCHMARKS(OrderBook);
+BOOK_BENCHMARKS(MapOrderBook);
+BOOK_BENCHMARKS(FlatOrderBook);
+BOOK_BENCHMARKS(RadixOrderBook);
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+#include <quickfix/DataDictionary.h>
+#include <quickfix/FieldConvertors.h>
+#include <quickfix/Message.h>
+#include <quickfix/fix44/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix44/MarketDataSnapshotFullRefresh.h>
+
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+#include "../src/datasources/deribit.h"
+#include "deribit_messages.h"
+#include "latency.h"
+
+// The path market data took before the raw decoder: QuickFIX parses the whole
+// message into field maps and groups, then every price and size goes through
+// its generic double conversion.
+
+static FIX::DataDictionary const& dictionary() {
+  static FIX::DataDictionary dictionary(SPEC_DIR "/DERIBIT_FIX44.xml");
+  return dictionary;
+}
+
+static void BM_QuickfixDoubleConvertor(benchmark::State& state) {
+  std::vector<std::string> strings;
+  for (size_t i = 0; i < 1000; i++) {
+    strings.push_back(DeribitMessages::price(i, i % 2 == 0));
+    strings.push_back(DeribitMessages::size(i));
+  }
+  for (auto _ : state)
+    for (auto const& value : strings)
+      benchmark::DoNotOptimize(FIX::DoubleConvertor::convert(value));
+  state.SetItemsProcessed(state.iterations() * strings.size());
+}
+BENCHMARK(BM_QuickfixDoubleConvertor);
+
+static void BM_QuickfixDecodeSnapshot(benchmark::State& state) {
+  auto raw = DeribitMessages::snapshot(state.range(0));
+  for (auto _ : state) {
+    FIX44::MarketDataSnapshotFullRefresh message;
+    message.setString(raw, false, &dictionary());
+    BidAskSnapshot snapshot;
+    Deribit::Fix::decode(message, snapshot);
+    benchmark::DoNotOptimize(snapshot);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * 2);
+}
+BENCHMARK(BM_QuickfixDecodeSnapshot)->Arg(10)->Arg(1000)->Arg(5000);
+
+static void BM_QuickfixDecodeDelta(benchmark::State& state) {
+  auto raw = DeribitMessages::delta(state.range(0));
+  for (auto _ : state) {
+    FIX44::MarketDataIncrementalRefresh message;
+    message.setString(raw, false, &dictionary());
+    BidAskDelta delta;
+    Deribit::Fix::decode(message, delta);
+    benchmark::DoNotOptimize(delta);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QuickfixDecodeDelta)->Arg(1)->Arg(10)->Arg(100);
+
+// A client which is never started, only used to call the crackers' handlers.
+static Deribit::Fix& application() {
+  static auto path =
+      (std::filesystem::temp_directory_path() / "orderbook_bench").string();
+  static std::istringstream config(
+      "[DEFAULT]\n"
+      "ConnectionType=initiator\n"
+      "FileStorePath=" + path + "\n"
+      "FileLogPath=" + path + "\n"
+      "[SESSION]\n"
+      "BeginString=FIX.4.4\n"
+      "SenderCompID=CLIENT\n"
+      "TargetCompID=DERIBITSERVER\n");
+  static SymbolTable symbols(1);
+  static Deribit::Fix application{FIX::SessionSettings(config)};
+  if (symbols.size() == 0) {
+    symbols.intern("BTC-PERPETUAL");
+    application.attach_symbols(symbols);
+  }
+  return application;
+}
+
+static void BM_FixOnMessageSnapshot(benchmark::State& state) {
+  FIX44::MarketDataSnapshotFullRefresh message;
+  message.setString(DeribitMessages::snapshot(state.range(0)), false,
+                    &dictionary());
+  FIX::SessionID session_id("FIX.4.4", "CLIENT", "DERIBITSERVER");
+
+  size_t levels = 0;
+  application().attach_bid_ask_snapshot_handler(
+      [&](SymbolId, BidAskSnapshot const& snapshot) {
+        levels += snapshot.bids.size() + snapshot.asks.size();
+      });
+
+  LatencyRecorder recorder;
+  for (auto _ : state)
+    recorder.time([&]() { application().onMessage(message, session_id); });
+  recorder.report(state);
+  state.SetItemsProcessed(levels);
+}
+BENCHMARK(BM_FixOnMessageSnapshot)->Arg(10)->Arg(1000);
+
+static void BM_FixOnMessageDelta(benchmark::State& state) {
+  FIX44::MarketDataIncrementalRefresh message;
+  message.setString(DeribitMessages::delta(state.range(0)), false,
+                    &dictionary());
+  FIX::SessionID session_id("FIX.4.4", "CLIENT", "DERIBITSERVER");
+
+  size_t changes = 0;
+  application().attach_bid_ask_delta_handler(
+      [&](SymbolId, BidAskDelta const& delta) {
+        changes += delta.bids.size() + delta.asks.size();
+      });
+
+  LatencyRecorder recorder;
+  for (auto _ : state)
+    recorder.time([&]() { application().onMessage(message, session_id); });
+  recorder.report(state);
+  state.SetItemsProcessed(changes);
+}
+BENCHMARK(BM_FixOnMessageDelta)->Arg(1)->Arg(10)->Arg(100);
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <random>
+#include <string>
+
+#include "../src/book_manager.h"
+#include "../src/datasources/capture.h"
+#include "../src/datasources/replay.h"
+
+// Writes a capture of a snapshot followed by `count` single level updates
+// around the touch, the way BTC-PERPETUAL trades on a quiet day.
+static std::string write_capture(size_t count) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "orderbook_replay_bench.bin")
+                  .string();
+  std::filesystem::remove(path);
+
+  Capture::Writer writer(path);
+  BidAskSnapshot snapshot;
+  for (int i = 0; i < 100; i++) {
+    snapshot.bids.push_back({64000 - i * 0.5, 100});
+    snapshot.asks.push_back({64000.5 + i * 0.5, 100});
+  }
+  writer.write("BTC-PERPETUAL", snapshot, 0);
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> level(0, 40);
+  for (size_t i = 0; i < count; i++) {
+    double price = 64000 - level(rng) * 0.5;
+    OfferChange change = {i % 4 == 0 ? OfferAction::Remove : OfferAction::Update,
+                          {price, i % 4 == 0 ? 0.0 : double(i % 1000)}};
+    BidAskDelta delta;
+    if (i % 2 == 0)
+      delta.bids.push_back(change);
+    else
+      delta.asks.push_back({change.action, {128000.5 - price, change.offer.quantity}});
+    writer.write("BTC-PERPETUAL", delta, i * 1000);
+  }
+  return path;
+}
+
+static void BM_ReplayIntoBookManager(benchmark::State& state) {
+  auto path = write_capture(state.range(0));
+  uint64_t updates = 0;
+  for (auto _ : state) {
+    BookManager books(1);
+    books.add_book("BTC-PERPETUAL", 0.5);
+    Replay source(path, false);
+    source.attach_symbols(books.interned_symbols());
+    source.attach_bid_ask_snapshot_handler(
+        [&](SymbolId id, BidAskSnapshot const& snapshot) {
+          books.on_snapshot(id, snapshot);
+        });
+    source.attach_bid_ask_delta_handler(
+        [&](SymbolId id, BidAskDelta const& delta) {
+          books.on_delta(id, delta);
+        });
+    updates += source.replay_all();
+    books.flush();
+  }
+  state.SetItemsProcessed(updates);
+  std::filesystem::remove(path);
+}
+BENCHMARK(BM_ReplayIntoBookManager)->Arg(1000000)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,87 @@
+#include "bitmap.h"
+
+#include <algorithm>
+#include <bit>
+
+LevelBitmap::LevelBitmap(size_t size) {
+  words = std::vector<uint64_t>((size + 63) / 64);
+  summary = std::vector<uint64_t>((words.size() + 63) / 64);
+}
+
+size_t LevelBitmap::size() const {
+  return words.size() * 64;
+}
+
+void LevelBitmap::set(int64_t index) {
+  size_t word = index >> 6;
+  words[word] |= uint64_t(1) << (index & 63);
+  summary[word >> 6] |= uint64_t(1) << (word & 63);
+}
+
+void LevelBitmap::reset(int64_t index) {
+  size_t word = index >> 6;
+  words[word] &= ~(uint64_t(1) << (index & 63));
+  if (words[word] == 0)
+    summary[word >> 6] &= ~(uint64_t(1) << (word & 63));
+}
+
+bool LevelBitmap::test(int64_t index) const {
+  return (words[index >> 6] >> (index & 63)) & 1;
+}
+
+void LevelBitmap::clear() {
+  std::fill(words.begin(), words.end(), 0);
+  std::fill(summary.begin(), summary.end(), 0);
+}
+
+std::optional<int64_t> LevelBitmap::prev(int64_t index) const {
+  int64_t i = index - 1;
+  if (i < 0)
+    return std::nullopt;
+
+  int64_t word = i >> 6;
+  uint64_t bits = words[word] & (~uint64_t(0) >> (63 - (i & 63)));
+  if (bits != 0)
+    return word * 64 + 63 - std::countl_zero(bits);
+  if (word == 0)
+    return std::nullopt;
+
+  int64_t w = word - 1;
+  int64_t s = w >> 6;
+  uint64_t summary_bits = summary[s] & (~uint64_t(0) >> (63 - (w & 63)));
+  while (true) {
+    if (summary_bits != 0) {
+      w = s * 64 + 63 - std::countl_zero(summary_bits);
+      return w * 64 + 63 - std::countl_zero(words[w]);
+    }
+    if (s == 0)
+      return std::nullopt;
+    summary_bits = summary[--s];
+  }
+}
+
+std::optional<int64_t> LevelBitmap::next(int64_t index) const {
+  int64_t i = index + 1;
+  if (i >= static_cast<int64_t>(size()))
+    return std::nullopt;
+
+  int64_t word = i >> 6;
+  uint64_t bits = words[word] & (~uint64_t(0) << (i & 63));
+  if (bits != 0)
+    return word * 64 + std::countr_zero(bits);
+  if (word + 1 >= static_cast<int64_t>(words.size()))
+    return std::nullopt;
+
+  int64_t w = word + 1;
+  int64_t s = w >> 6;
+  uint64_t summary_bits = summary[s] & (~uint64_t(0) << (w & 63));
+  while (true) {
+    if (summary_bits != 0) {
+      w = s * 64 + std::countr_zero(summary_bits);
+      return w * 64 + std::countr_zero(words[w]);
+    }
+    if (++s >= static_cast<int64_t>(summary.size()))
+      return std::nullopt;
+    summary_bits = summary[s];
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef bitmap
+#define bitmap
+
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// A fixed-size two-level bitmap, the summary level has one bit per non-empty
+// word so that finding the nearest set bit in either direction only takes a
+// couple of bit scans.
+class LevelBitmap {
+ private:
+  std::vector<uint64_t> words;
+  std::vector<uint64_t> summary;
+
+ public:
+  // Size is rounded up to a multiple of 64.
+  LevelBitmap(size_t size);
+
+  size_t size() const;
+
+  void set(int64_t index);
+  void reset(int64_t index);
+  bool test(int64_t index) const;
+  void clear();
+
+  // Returns the highest set index below `index`.
+  std::optional<int64_t> prev(int64_t index) const;
+  // Returns the lowest set index above `index`.
+  std::optional<int64_t> next(int64_t index) const;
+
+  // Calls `f` with every set index in ascending order.
+  template <typename F>
+  void for_each(F&& f) const;
+};
+
+template <typename F>
+void LevelBitmap::for_each(F&& f) const {
+  for (size_t word = 0; word < words.size(); word++)
+    for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+      f(int64_t(word * 64 + std::countr_zero(bits)));
+}
+
+#endif  // bitmap
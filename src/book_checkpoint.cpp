@@ -0,0 +1,161 @@
+#include "book_checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace BookCheckpoint {
+
+static constexpr char MAGIC[8] = {'O', 'B', 'C', 'H', 'E', 'C', 'K', 'P'};
+static constexpr uint32_t VERSION = 1;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t entries;
+  int64_t timestamp;
+} Header;
+
+typedef struct {
+  char symbol[SYMBOL_SIZE];
+  uint64_t sequence;
+  uint32_t bid_count;
+  uint32_t ask_count;
+} EntryHeader;
+
+static_assert(sizeof(Header) % alignof(Level) == 0 &&
+              sizeof(EntryHeader) % alignof(Level) == 0);
+
+static size_t size_of(Entry const& entry) {
+  return sizeof(EntryHeader) +
+         (entry.bids.size() + entry.asks.size()) * sizeof(Level);
+}
+
+void write(std::string const& path, std::span<Entry const> entries) {
+  size_t size = sizeof(Header);
+  for (auto const& entry : entries) {
+    if (entry.symbol.size() >= SYMBOL_SIZE)
+      throw std::runtime_error("Symbol " + std::string(entry.symbol) +
+                               " is too long for a checkpoint");
+    size += size_of(entry);
+  }
+
+  std::string temporary = path + ".tmp";
+  int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Could not open checkpoint " + temporary);
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not size checkpoint " + temporary);
+  }
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    throw std::runtime_error("Could not map checkpoint " + temporary);
+
+  auto* data = static_cast<std::byte*>(mapping);
+  Header header = {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.entries = entries.size();
+  header.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+  std::memcpy(data, &header, sizeof(header));
+
+  size_t offset = sizeof(Header);
+  for (auto const& entry : entries) {
+    EntryHeader entry_header = {};
+    std::memcpy(entry_header.symbol, entry.symbol.data(), entry.symbol.size());
+    entry_header.sequence = entry.sequence;
+    entry_header.bid_count = entry.bids.size();
+    entry_header.ask_count = entry.asks.size();
+    std::memcpy(data + offset, &entry_header, sizeof(entry_header));
+    offset += sizeof(entry_header);
+    std::memcpy(data + offset, entry.bids.data(), entry.bids.size_bytes());
+    offset += entry.bids.size_bytes();
+    std::memcpy(data + offset, entry.asks.data(), entry.asks.size_bytes());
+    offset += entry.asks.size_bytes();
+  }
+  munmap(mapping, size);
+
+  // Like the journals nothing is synced to disk, the checkpoint survives a
+  // crash of the process but not of the machine
+  if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    throw std::runtime_error("Could not replace checkpoint " + path);
+}
+
+Reader::Reader(std::string const& path)
+    : data(nullptr), size(0), offset(sizeof(Header)), remaining(0) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Could not open checkpoint " + path);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error(path + " is not a checkpoint");
+  }
+  size = info.st_size;
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    throw std::runtime_error("Could not map checkpoint " + path);
+  data = static_cast<std::byte const*>(mapping);
+
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION) {
+    munmap(mapping, size);
+    throw std::runtime_error(path + " is not a checkpoint");
+  }
+  remaining = header.entries;
+  written_at = header.timestamp;
+}
+
+Reader::~Reader() {
+  munmap(const_cast<std::byte*>(data), size);
+}
+
+int64_t Reader::timestamp() const {
+  return written_at;
+}
+
+size_t Reader::entries() const {
+  return remaining;
+}
+
+bool Reader::next(Entry& entry) {
+  if (remaining == 0 || size - offset < sizeof(EntryHeader))
+    return false;
+
+  EntryHeader header;
+  std::memcpy(&header, data + offset, sizeof(header));
+  size_t levels = size_t(header.bid_count) + header.ask_count;
+  if (levels > (size - offset - sizeof(header)) / sizeof(Level))
+    return false;
+
+  auto const* bids = reinterpret_cast<Level const*>(data + offset +
+                                                    sizeof(header));
+  entry.symbol = std::string_view(
+      reinterpret_cast<char const*>(data + offset),
+      strnlen(reinterpret_cast<char const*>(data + offset), SYMBOL_SIZE));
+  entry.sequence = header.sequence;
+  entry.bids = std::span(bids, header.bid_count);
+  entry.asks = std::span(bids + header.bid_count, header.ask_count);
+
+  offset += sizeof(header) + levels * sizeof(Level);
+  remaining--;
+  return true;
+}
+
+}  // namespace BookCheckpoint
@@ -0,0 +1,63 @@
+#ifndef book_checkpoint
+#define book_checkpoint
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "level_storage.h"
+
+// Every level of a set of books saved to a file, so that a restarted process
+// has books to show before the exchange sent new snapshots.
+//
+// The file is a header followed by one entry per book: its symbol, the number
+// of messages applied to it and its levels, best first. A checkpoint is
+// written to a temporary file which then replaces the old one, so the file
+// always holds a whole checkpoint. It is read through a memory mapping, the
+// levels of an entry point straight into it.
+namespace BookCheckpoint {
+
+// Longest symbol an entry holds, including the terminating 0.
+constexpr size_t SYMBOL_SIZE = 64;
+
+typedef struct {
+  std::string_view symbol;
+  uint64_t sequence;
+  std::span<Level const> bids;
+  std::span<Level const> asks;
+} Entry;
+
+// Throws if the file cannot be written or a symbol is too long.
+void write(std::string const& path, std::span<Entry const> entries);
+
+class Reader {
+ private:
+  std::byte const* data;
+  size_t size;
+  size_t offset;
+  size_t remaining;
+  int64_t written_at;
+
+ public:
+  // Throws if the file cannot be read or is not a checkpoint.
+  Reader(std::string const& path);
+  ~Reader();
+
+  Reader(Reader const&) = delete;
+  Reader& operator=(Reader const&) = delete;
+
+  // When the checkpoint was written, in nanoseconds since the epoch.
+  int64_t timestamp() const;
+  // Number of entries not read yet.
+  size_t entries() const;
+
+  // Returns false once every entry was read. The entry points into the
+  // mapping and is only valid as long as the reader.
+  bool next(Entry& entry);
+};
+
+}  // namespace BookCheckpoint
+
+#endif  // book_checkpoint
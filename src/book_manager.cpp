@@ -0,0 +1,697 @@
+#include "book_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "book_checkpoint.h"
+
+// Number of empty polls before an idle worker goes to sleep.
+constexpr size_t SPIN_LIMIT = 1024;
+
+// Period over which the refresh rate of a book with a depth is measured, in
+// nanoseconds.
+constexpr int64_t PROMOTION_WINDOW = 1'000'000'000;
+
+static int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// The side a trade took liquidity from. Without an aggressor it is the side
+// whose level at the trade's price changes in the same message.
+static Side traded_side(Trade const& trade, BidAskDelta const& delta) {
+  if (trade.aggressor != Aggressor::Unknown)
+    return trade.aggressor == Aggressor::Buyer ? Side::Ask : Side::Bid;
+  for (auto const& ask : delta.asks)
+    if (ask.offer.price == trade.offer.price)
+      return Side::Ask;
+  return Side::Bid;
+}
+
+BookManager::Book::Book(double tick_size, BookOptions const& options)
+    : depth(options.depth),
+      promote_rate(options.promote_rate),
+      book(std::make_unique<OrderBook>(tick_size)),
+      spare(std::make_unique<OrderBook>(tick_size)),
+      queues(options.queues ? std::make_unique<QueueBook>(tick_size)
+                            : nullptr),
+      positions(options.queues ? std::make_unique<Seqlock<QueuePositions>>()
+                               : nullptr) {
+  if (queues)
+    tracked.reserve(MAX_TRACKED_ORDERS);
+}
+
+BookManager::Shard::Shard(size_t queue_size)
+    : queue(queue_size), orders(ORDER_QUEUE_SIZE) {}
+
+BookManager::BookManager(size_t workers, size_t capacity, size_t queue_size)
+    : symbols(capacity), books(capacity) {
+  workers = std::max<size_t>(workers, 1);
+  for (size_t i = 0; i < workers; i++)
+    shards.push_back(std::make_unique<Shard>(queue_size));
+  for (auto& shard : shards)
+    shard->thread = std::thread(&BookManager::run, this, std::ref(*shard));
+}
+
+BookManager::~BookManager() {
+  for (auto& shard : shards) {
+    shard->stopping.store(true, std::memory_order_release);
+    shard->wakeups.fetch_add(1, std::memory_order_release);
+    shard->wakeups.notify_one();
+  }
+  for (auto& shard : shards)
+    shard->thread.join();
+}
+
+size_t BookManager::size() const {
+  return symbols.size();
+}
+
+size_t BookManager::workers() const {
+  return shards.size();
+}
+
+SymbolId BookManager::add_book(std::string const& symbol,
+                               double tick_size,
+                               BookOptions const& options) {
+  if (auto id = symbols.find(symbol); id.has_value())
+    return *id;
+
+  // Another thread may be adding the same symbol, or the next id
+  std::lock_guard<std::mutex> lock(add_mutex);
+  if (auto id = symbols.find(symbol); id.has_value())
+    return *id;
+
+  // The book is stored before interning publishes the id with release
+  // semantics, so nobody can see an id without its book.
+  SymbolId id = symbols.size();
+  if (id >= books.size())
+    throw std::runtime_error("No room for another book");
+  books[id] = std::make_unique<Book>(tick_size, options);
+  return symbols.intern(symbol);
+}
+
+std::optional<SymbolId> BookManager::find(std::string_view symbol) const {
+  return symbols.find(symbol);
+}
+
+std::string const& BookManager::symbol(SymbolId id) const {
+  return symbols.name(id);
+}
+
+SymbolTable const& BookManager::interned_symbols() const {
+  return symbols;
+}
+
+OrderBook& BookManager::book(SymbolId id) {
+  return *books[id]->book;
+}
+
+bool BookManager::has_queues(SymbolId id) const {
+  return books[id]->queues != nullptr;
+}
+
+size_t BookManager::depth(SymbolId id) const {
+  return books[id]->depth.load(std::memory_order_relaxed);
+}
+
+void BookManager::set_depth(SymbolId id, size_t depth) {
+  Book& book = *books[id];
+  book.depth.store(depth, std::memory_order_relaxed);
+  book.window_start = 0;
+  book.window_refreshes = 0;
+  invalidate(id);
+}
+
+TopOfBook BookManager::top_of_book(SymbolId id) const {
+  return books[id]->top.load();
+}
+
+uint64_t BookManager::sequence(SymbolId id) const {
+  return books[id]->top.sequence();
+}
+
+QueueBook::OrderId BookManager::track(SymbolId id,
+                                      Side side,
+                                      double price,
+                                      double quantity) {
+  Book& book = *books[id];
+  if (!book.queues)
+    throw std::runtime_error("Book has no queues to track orders in");
+  if (book.tracking.fetch_add(1, std::memory_order_relaxed) >=
+      MAX_TRACKED_ORDERS) {
+    book.tracking.fetch_sub(1, std::memory_order_relaxed);
+    throw std::runtime_error("Too many orders tracked");
+  }
+
+  QueueBook::OrderId order =
+      next_order.fetch_add(1, std::memory_order_relaxed);
+  enqueue_order(id, {id, order, false, side, price, quantity});
+  return order;
+}
+
+void BookManager::cancel(SymbolId id, QueueBook::OrderId order) {
+  if (books[id]->queues)
+    enqueue_order(id, {id, order, true, Side::Bid, 0, 0});
+}
+
+std::optional<QueuePosition> BookManager::position(
+    SymbolId id,
+    QueueBook::OrderId order) const {
+  Book const& book = *books[id];
+  if (!book.positions)
+    return std::nullopt;
+  QueuePositions positions = book.positions->load();
+  for (size_t i = 0; i < positions.count; i++)
+    if (positions.orders[i].id == order)
+      return positions.orders[i].position;
+  return std::nullopt;
+}
+
+double BookManager::trade_rate(SymbolId id, Side side) const {
+  Book const& book = *books[id];
+  if (!book.positions)
+    return 0;
+  return book.positions->load().trade_rates[int(side)];
+}
+
+double BookManager::fill_probability(SymbolId id,
+                                     QueueBook::OrderId order,
+                                     double horizon) const {
+  Book const& book = *books[id];
+  if (!book.positions)
+    return 0;
+  // Position and trade rate from the same publication
+  QueuePositions positions = book.positions->load();
+  for (size_t i = 0; i < positions.count; i++) {
+    TrackedOrder const& tracked = positions.orders[i];
+    if (tracked.id == order)
+      return QueueBook::fill_probability(
+          tracked.position, positions.trade_rates[int(tracked.side)], horizon);
+  }
+  return 0;
+}
+
+QueueStats BookManager::stats(size_t shard) const {
+  Shard const& s = *shards[shard];
+  return {
+      .depth = s.queue.size(),
+      .max_depth = s.max_depth.load(std::memory_order_relaxed),
+      .enqueued = s.enqueued.load(std::memory_order_relaxed),
+      .applied = s.applied.load(std::memory_order_relaxed),
+      .overflows = s.overflows.load(std::memory_order_relaxed),
+  };
+}
+
+RebuildStats BookManager::rebuild_stats(size_t shard) const {
+  HdrHistogram const& rebuild_time = shards[shard]->rebuild_time;
+  return {
+      .rebuilds = rebuild_time.count(),
+      .mean = rebuild_time.mean(),
+      .p99 = rebuild_time.value_at(99),
+      .max = rebuild_time.max(),
+  };
+}
+
+SyncStats BookManager::sync_stats(SymbolId id) const {
+  Book const& book = *books[id];
+  return {
+      .synced = book.synced.load(std::memory_order_relaxed),
+      .recoveries = book.recoveries.load(std::memory_order_relaxed),
+      .dropped = book.dropped.load(std::memory_order_relaxed),
+  };
+}
+
+size_t BookManager::shard(SymbolId id) const {
+  return id % shards.size();
+}
+
+uint64_t BookManager::updates() const {
+  uint64_t total = 0;
+  for (auto const& shard : shards)
+    total += shard->published.load(std::memory_order_acquire);
+  return total;
+}
+
+uint64_t BookManager::wait_for_updates(uint64_t seen,
+                                       std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(update_mutex);
+  waiters.fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in `publish`, either the shard sees the waiter or we
+  // see its update.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t total = seen;
+  update_signal.wait_for(lock, timeout, [&] {
+    total = updates();
+    return total > seen;
+  });
+  waiters.fetch_sub(1, std::memory_order_relaxed);
+  return total;
+}
+
+void BookManager::attach_recovery_handler(
+    std::function<void(SymbolId)> handler) {
+  recovery_handler = std::move(handler);
+}
+
+void BookManager::attach_top_of_book_handler(
+    std::function<void(SymbolId, TopOfBook const&)> handler) {
+  top_of_book_handler = std::move(handler);
+}
+
+void BookManager::on_snapshot(SymbolId id, BidAskSnapshot const& snapshot) {
+  Book& book = *books[id];
+  book.synced.store(true, std::memory_order_relaxed);
+  book.stale.store(false, std::memory_order_relaxed);
+  book.stream_sequence = snapshot.sequence;
+
+  enqueue_snapshot(id, snapshot);
+  if (book.depth.load(std::memory_order_relaxed) > 0 && book.promote_rate > 0)
+    count_refresh(id);
+}
+
+void BookManager::on_delta(SymbolId id, BidAskDelta const& delta) {
+  uint64_t first =
+      delta.first_sequence != 0 ? delta.first_sequence : delta.sequence;
+  if (!accept(id, first, delta.sequence))
+    return;
+
+  Shard& shard = shard_of(id);
+  // Trades go first so that the levels they took size from are not taken to
+  // have been cancelled
+  bool trades = books[id]->queues != nullptr;
+  size_t remaining = delta.bids.size() + delta.asks.size() +
+                     (trades ? delta.trades.size() : 0);
+  auto stamps = LatencyTrace::queued();
+
+  if (trades) {
+    for (auto const& trade : delta.trades)
+      enqueue(shard, {id, traded_side(trade, delta), OfferAction::Remove,
+                      --remaining == 0, false, false, true, trade.offer,
+                      stamps});
+  }
+  for (auto const& bid : delta.bids)
+    enqueue(shard, {id, Side::Bid, bid.action, --remaining == 0, false, false,
+                    false, bid.offer, stamps});
+  for (auto const& ask : delta.asks)
+    enqueue(shard, {id, Side::Ask, ask.action, --remaining == 0, false, false,
+                    false, ask.offer, stamps});
+
+  commit(shard);
+}
+
+void BookManager::invalidate(SymbolId id) {
+  Book& book = *books[id];
+  book.synced.store(false, std::memory_order_relaxed);
+  book.recoveries.store(book.recoveries.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+  if (recovery_handler)
+    recovery_handler(id);
+}
+
+void BookManager::flush() {
+  for (auto& shard : shards) {
+    uint64_t target = shard->enqueued.load(std::memory_order_acquire);
+    while (shard->applied.load(std::memory_order_acquire) < target)
+      std::this_thread::yield();
+    uint64_t orders = shard->orders_enqueued.load(std::memory_order_acquire);
+    while (shard->orders_applied.load(std::memory_order_acquire) < orders)
+      std::this_thread::yield();
+  }
+}
+
+void BookManager::save(std::string const& path) {
+  std::lock_guard<std::mutex> lock(save_mutex);
+
+  std::vector<uint64_t> requests;
+  for (auto& shard : shards) {
+    requests.push_back(shard->save_requests.fetch_add(1) + 1);
+    wake(*shard);
+  }
+  for (size_t i = 0; i < shards.size(); i++)
+    while (shards[i]->saves.load(std::memory_order_acquire) < requests[i])
+      std::this_thread::yield();
+
+  // The shards leave the copies alone until the next checkpoint
+  std::vector<BookCheckpoint::Entry> entries;
+  for (SymbolId id = 0; id < symbols.size(); id++) {
+    Book const& book = *books[id];
+    if (book.saved_sequence == 0)
+      continue;
+    entries.push_back({symbols.name(id), book.saved_sequence,
+                       book.saved[int(Side::Bid)],
+                       book.saved[int(Side::Ask)]});
+  }
+  BookCheckpoint::write(path, entries);
+}
+
+size_t BookManager::restore(std::string const& path) {
+  BookCheckpoint::Reader reader(path);
+  BookCheckpoint::Entry entry;
+  size_t restored = 0;
+
+  while (reader.next(entry)) {
+    auto id = symbols.find(entry.symbol);
+    if (!id.has_value())
+      continue;
+
+    Book& book = *books[*id];
+    // Publications count from 0 in every process, so that the published
+    // sequence stays the one the book's seqlock reports
+    book.stale.store(true, std::memory_order_relaxed);
+
+    BidAskSnapshot snapshot;
+    for (auto const& bid : entry.bids)
+      snapshot.bids.push_back({bid.price, bid.quantity});
+    for (auto const& ask : entry.asks)
+      snapshot.asks.push_back({ask.price, ask.quantity});
+    enqueue_snapshot(*id, snapshot);
+    restored++;
+  }
+  return restored;
+}
+
+bool BookManager::accept(SymbolId id, uint64_t first, uint64_t last) {
+  Book& book = *books[id];
+  bool accepted = book.synced.load(std::memory_order_relaxed);
+
+  // Deltas without a sequence number are trusted, the datasource has to
+  // `invalidate` the book itself when it knows that some were lost
+  if (accepted && last != 0 && book.stream_sequence != 0) {
+    if (first > book.stream_sequence + 1) {
+      // Requesting the snapshot now rather than on every later delta
+      invalidate(id);
+      accepted = false;
+    } else if (last <= book.stream_sequence) {
+      // Resent or reordered, already applied
+      accepted = false;
+    }
+  }
+  if (accepted && last != 0)
+    book.stream_sequence = last;
+
+  if (!accepted)
+    book.dropped.store(book.dropped.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  return accepted;
+}
+
+void BookManager::count_refresh(SymbolId id) {
+  Book& book = *books[id];
+  int64_t timestamp = now();
+  if (book.window_start == 0)
+    book.window_start = timestamp;
+  book.window_refreshes++;
+
+  int64_t elapsed = timestamp - book.window_start;
+  if (elapsed < PROMOTION_WINDOW)
+    return;
+  double rate = book.window_refreshes * 1e9 / elapsed;
+  book.window_start = timestamp;
+  book.window_refreshes = 0;
+  if (rate > book.promote_rate)
+    set_depth(id, 0);
+}
+
+void BookManager::trade(Book& book, BookRecord const& record) {
+  book.queues->trade(record.side, record.offer.price, record.offer.quantity,
+                     now());
+}
+
+void BookManager::rebuild(Shard& shard, Book& book, BookRecord const& record) {
+  if (!book.rebuilding) {
+    book.rebuilding = true;
+    book.rebuild_started = now();
+    book.spare->reset();
+    if (book.queues)
+      book.queues->begin_snapshot();
+  }
+
+  if (record.action != OfferAction::Remove) {
+    book.spare->add_level({record.offer.price, record.offer.quantity},
+                          record.side);
+    if (book.queues)
+      book.queues->set(record.side, record.offer.price, record.offer.quantity);
+  }
+
+  if (record.last) {
+    if (book.queues)
+      book.queues->end_snapshot();
+    // Readers only ever see the book once a whole message is applied, the
+    // old book becomes the spare for the next snapshot
+    std::swap(book.book, book.spare);
+    book.rebuilding = false;
+    shard.rebuild_time.record(now() - book.rebuild_started);
+  }
+}
+
+void BookManager::refresh(Shard& shard, Book& book, BookRecord const& record) {
+  if (record.action != OfferAction::Remove) {
+    auto& offers =
+        record.side == Side::Bid ? shard.refresh.bids : shard.refresh.asks;
+    offers.push_back(record.offer);
+  }
+
+  if (record.last) {
+    book.book->replace(shard.refresh);
+    if (book.queues) {
+      book.queues->begin_snapshot();
+      for (auto const& bid : shard.refresh.bids)
+        book.queues->set(Side::Bid, bid.price, bid.quantity);
+      for (auto const& ask : shard.refresh.asks)
+        book.queues->set(Side::Ask, ask.price, ask.quantity);
+      book.queues->end_snapshot();
+    }
+    shard.refresh.bids.clear();
+    shard.refresh.asks.clear();
+  }
+}
+
+void BookManager::enqueue_order(SymbolId id, OrderCommand&& command) {
+  Shard& shard = shard_of(id);
+  while (!shard.orders.try_push(std::move(command))) {
+    wake(shard);
+    std::this_thread::yield();
+  }
+  shard.orders_enqueued.fetch_add(1, std::memory_order_release);
+  wake(shard);
+}
+
+void BookManager::apply_order(OrderCommand const& command) {
+  Book& book = *books[command.symbol];
+  auto& tracked = book.tracked;
+
+  if (command.cancel) {
+    auto it = std::find_if(tracked.begin(), tracked.end(), [&](auto& order) {
+      return order.id == command.order;
+    });
+    if (it == tracked.end())
+      return;
+    book.queues->cancel(command.order);
+    tracked.erase(it);
+    book.tracking.fetch_sub(1, std::memory_order_relaxed);
+  } else {
+    book.queues->track(command.order, command.side, command.price,
+                       command.quantity);
+    tracked.push_back({command.order, command.side, {}});
+  }
+  publish_positions(book);
+}
+
+BookManager::Shard& BookManager::shard_of(SymbolId id) {
+  return *shards[shard(id)];
+}
+
+void BookManager::enqueue_snapshot(SymbolId id,
+                                   BidAskSnapshot const& snapshot) {
+  bool refresh = books[id]->depth.load(std::memory_order_relaxed) > 0;
+  Shard& shard = shard_of(id);
+  size_t remaining = snapshot.bids.size() + snapshot.asks.size();
+  auto stamps = LatencyTrace::queued();
+
+  if (remaining == 0)
+    enqueue(shard, {id, Side::Bid, OfferAction::Remove, true, true, refresh,
+                    false, {}, stamps});
+  for (auto const& bid : snapshot.bids)
+    enqueue(shard, {id, Side::Bid, OfferAction::Add, --remaining == 0, true,
+                    refresh, false, bid, stamps});
+  for (auto const& ask : snapshot.asks)
+    enqueue(shard, {id, Side::Ask, OfferAction::Add, --remaining == 0, true,
+                    refresh, false, ask, stamps});
+
+  commit(shard);
+}
+
+void BookManager::enqueue(Shard& shard, BookRecord const& record) {
+  if (!shard.queue.try_push(record)) {
+    // The worker is falling behind, rather than dropping updates and
+    // corrupting the book we wait for it to make room.
+    shard.overflows.fetch_add(1, std::memory_order_relaxed);
+    do {
+      wake(shard);
+      std::this_thread::yield();
+    } while (!shard.queue.try_push(record));
+  }
+  shard.enqueued.store(shard.enqueued.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+}
+
+void BookManager::commit(Shard& shard) {
+  size_t depth = shard.queue.size();
+  if (depth > shard.max_depth.load(std::memory_order_relaxed))
+    shard.max_depth.store(depth, std::memory_order_relaxed);
+  wake(shard);
+}
+
+void BookManager::wake(Shard& shard) {
+  // Pairs with the fence in `run`, either the worker sees the new records or
+  // we see that it is about to sleep.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (shard.sleeping.load(std::memory_order_relaxed)) {
+    shard.wakeups.fetch_add(1, std::memory_order_release);
+    shard.wakeups.notify_one();
+  }
+}
+
+void BookManager::publish(Shard& shard, SymbolId id, Book& book) {
+  TopOfBook top = {};
+  top.sequence = ++book.sequence;
+  top.timestamp = now();
+  top.stale = book.stale.load(std::memory_order_relaxed);
+  top.bid_count = book.book->best_levels(Side::Bid, top.bids);
+  top.ask_count = book.book->best_levels(Side::Ask, top.asks);
+  // The depths near the touch also give the weighted mid
+  Depth bid_depth = book.book->depth_within(Side::Bid, METRICS_BPS);
+  Depth ask_depth = book.book->depth_within(Side::Ask, METRICS_BPS);
+  top.metrics = {
+      .microprice = book.book->microprice().value_or(0),
+      .weighted_mid = OrderBook::weighted_mid(bid_depth, ask_depth).value_or(0),
+      .imbalance = book.book->imbalance(METRICS_LEVELS).value_or(0),
+      .bid_depth = bid_depth.quantity,
+      .ask_depth = ask_depth.quantity,
+  };
+  book.top.store(top);
+  if (book.queues)
+    publish_positions(book);
+  if (top_of_book_handler)
+    top_of_book_handler(id, top);
+
+  shard.published.store(shard.published.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+    update_signal.notify_all();
+  }
+}
+
+void BookManager::publish_positions(Book& book) {
+  QueuePositions positions = {};
+  for (auto& order : book.tracked) {
+    order.position = book.queues->position(order.id).value_or(QueuePosition{});
+    positions.orders[positions.count++] = order;
+  }
+  positions.trade_rates[int(Side::Bid)] = book.queues->trade_rate(Side::Bid);
+  positions.trade_rates[int(Side::Ask)] = book.queues->trade_rate(Side::Ask);
+  book.positions->store(positions);
+}
+
+void BookManager::copy_books(Shard& shard) {
+  uint64_t requests = shard.save_requests.load(std::memory_order_acquire);
+  for (SymbolId id = 0; id < symbols.size(); id++) {
+    if (&shard_of(id) != &shard)
+      continue;
+    Book& book = *books[id];
+    for (Side side : {Side::Bid, Side::Ask}) {
+      auto& saved = book.saved[int(side)];
+      saved.resize(book.book->size(side));
+      book.book->best_levels(side, saved);
+    }
+    book.saved_sequence = book.sequence;
+  }
+  shard.saves.store(requests, std::memory_order_release);
+}
+
+void BookManager::run(Shard& shard) {
+  BookRecord record;
+  OrderCommand command;
+  size_t idle = 0;
+
+  while (true) {
+    // Every book is whole in between records, they are only ever changed
+    // once the last record of a message is in
+    if (shard.save_requests.load(std::memory_order_acquire) !=
+        shard.saves.load(std::memory_order_relaxed))
+      copy_books(shard);
+
+    // Orders are taken in between messages as well. A push of another
+    // producer may still be landing, it is popped on the next pass
+    if (shard.orders_enqueued.load(std::memory_order_acquire) !=
+        shard.orders_applied.load(std::memory_order_relaxed)) {
+      while (shard.orders.try_pop(command)) {
+        apply_order(command);
+        shard.orders_applied.store(
+            shard.orders_applied.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+      }
+    }
+
+    if (shard.queue.try_pop(record)) {
+      Book& book = *books[record.symbol];
+      if (record.refresh) {
+        refresh(shard, book, record);
+      } else if (record.snapshot) {
+        rebuild(shard, book, record);
+      } else {
+        if (record.trade) {
+          trade(book, record);
+        } else {
+          auto& changes =
+              record.side == Side::Bid ? shard.batch.bids : shard.batch.asks;
+          changes.push_back({record.action, record.offer});
+          if (book.queues)
+            book.queues->set(record.side, record.offer.price,
+                             record.action == OfferAction::Remove
+                                 ? 0
+                                 : record.offer.quantity);
+        }
+        if (record.last) {
+          book.book->apply(shard.batch);
+          shard.batch.bids.clear();
+          shard.batch.asks.clear();
+        }
+      }
+      if (record.last) {
+        publish(shard, record.symbol, book);
+        LatencyTrace::applied(record.stamps);
+      }
+      shard.applied.store(shard.applied.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+      idle = 0;
+      continue;
+    }
+
+    if (shard.stopping.load(std::memory_order_acquire) &&
+        shard.queue.empty())
+      return;
+
+    if (++idle < SPIN_LIMIT)
+      continue;
+
+    uint32_t seen = shard.wakeups.load(std::memory_order_acquire);
+    shard.sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.queue.empty() &&
+        !shard.stopping.load(std::memory_order_acquire) &&
+        shard.save_requests.load(std::memory_order_acquire) ==
+            shard.saves.load(std::memory_order_relaxed) &&
+        shard.orders_enqueued.load(std::memory_order_acquire) ==
+            shard.orders_applied.load(std::memory_order_relaxed))
+      shard.wakeups.wait(seen, std::memory_order_acquire);
+    shard.sleeping.store(false, std::memory_order_relaxed);
+    idle = 0;
+  }
+}
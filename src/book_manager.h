@@ -0,0 +1,383 @@
+#ifndef book_manager
+#define book_manager
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cache_line.h"
+#include "datasources/datasource.h"
+#include "hdr_histogram.h"
+#include "latency_trace.h"
+#include "mpsc_queue.h"
+#include "orderbook.h"
+#include "published_book.h"
+#include "queue_book.h"
+#include "seqlock.h"
+#include "spsc_queue.h"
+#include "symbol_table.h"
+
+// Maximum number of books a manager can hold.
+constexpr size_t DEFAULT_BOOK_CAPACITY = 4096;
+
+// Number of records each shard can have queued.
+constexpr size_t DEFAULT_QUEUE_SIZE = 1 << 16;
+
+// Orders whose queue position a book with queues can track at once.
+constexpr size_t MAX_TRACKED_ORDERS = 16;
+
+// Number of order commands each shard can have queued.
+constexpr size_t ORDER_QUEUE_SIZE = 256;
+
+// How a book is fed, see `BookManager::add_book`.
+typedef struct {
+  // With a depth the book is made of full refreshes of its best `depth`
+  // levels rather than a snapshot followed by deltas, 0 for the whole book.
+  size_t depth = 0;
+  // Whether queue positions are estimated from the book's trades.
+  bool queues = false;
+  // Refreshes a second above which a book with a depth is switched to the
+  // whole book, 0 to never switch.
+  double promote_rate = 0;
+} BookOptions;
+
+// A single level change queued for a book. Messages are split into one record
+// per entry, `last` is set on the final record of each message. The shard
+// gathers the records of a message back into one batch before applying it.
+typedef struct {
+  SymbolId symbol;
+  Side side;
+  OfferAction action;
+  bool last;
+  // Set on the records of a snapshot, which replaces the whole book. An empty
+  // snapshot is queued as a single `Remove` record.
+  bool snapshot;
+  // Set along with `snapshot` when it is a refresh of the best levels of a
+  // book with a depth, which is applied to the book in place.
+  bool refresh;
+  // Set on the records of trades, which only books with queues are sent. The
+  // side is the one traded against and the action is meaningless.
+  bool trade;
+  Offer offer;
+  // When the message was received and handed to the manager, empty unless
+  // latency tracing is built in.
+  [[no_unique_address]] LatencyTrace::QueueStamps stamps;
+} BookRecord;
+
+// A tracked order of a book with queues and where it stood when published.
+typedef struct {
+  QueueBook::OrderId id;
+  Side side;
+  QueuePosition position;
+} TrackedOrder;
+
+// Queue positions of a book's tracked orders, published with every message.
+typedef struct {
+  size_t count;
+  TrackedOrder orders[MAX_TRACKED_ORDERS];
+  double trade_rates[2];
+} QueuePositions;
+
+// Counters of a shard's queue.
+typedef struct {
+  size_t depth;
+  size_t max_depth;
+  uint64_t enqueued;
+  uint64_t applied;
+  // Number of times the queue was full and the datasource had to wait.
+  uint64_t overflows;
+} QueueStats;
+
+// Time a shard spent building books from snapshots, in nanoseconds.
+typedef struct {
+  uint64_t rebuilds;
+  double mean;
+  uint64_t p99;
+  uint64_t max;
+} RebuildStats;
+
+// Whether a book follows its stream and how often it had to be recovered.
+typedef struct {
+  bool synced;
+  // Number of times the book lost sync and a new snapshot was asked for.
+  uint64_t recoveries;
+  // Deltas dropped while waiting for a snapshot.
+  uint64_t dropped;
+} SyncStats;
+
+// Owns the order books of many instruments and shards them across a pool of
+// worker threads.
+//
+// Symbols are interned when a book is added and every update is routed by the
+// symbol's id. A book belongs to the shard `id % workers` and is only ever
+// mutated by that shard's thread. Updates reach the shards through lock-free
+// single producer queues, so the datasource thread only has to split messages
+// into records and enqueue them. The `on_*` methods must therefore always be
+// called from the same thread.
+//
+// Readers on any thread get a consistent view of a book through
+// `top_of_book`, which the shard publishes through a seqlock once it has
+// applied a whole message. Reading never blocks the shard.
+//
+// Books added with queues keep a `QueueBook` next to the order book, fed with
+// the same changes and with the trades, which are dropped for other books.
+// Orders are tracked and cancelled from any thread through a queue to the
+// owning shard, which publishes their positions through a seqlock along with
+// the `TopOfBook`.
+//
+// Books added with a depth only ever get full refreshes of their best levels,
+// which suits the many instruments that rarely trade. Each refresh is applied
+// to the book in place rather than rebuilt into the spare, so only the levels
+// which changed are touched. A book whose refreshes come faster than its
+// promotion rate is switched to the whole book through the recovery handler.
+//
+// Books can be saved to a checkpoint and restored from it on startup, so that
+// readers have levels to show, marked stale, before new snapshots came in.
+//
+// A snapshot is built into a spare book which is swapped in once it is
+// complete, so readers see either the old book or the new one and never levels
+// of both. Deltas are only applied on top of a snapshot. When their sequence
+// numbers show that one was lost the book drops everything up to the next
+// snapshot and the recovery handler is asked to fetch one.
+class BookManager {
+ private:
+  struct Book {
+    // Only touched by the datasource thread, apart from the counters.
+    std::atomic<bool> synced = false;
+    uint64_t stream_sequence = 0;
+    std::atomic<uint64_t> recoveries = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<size_t> depth;
+    double promote_rate;
+    // Set while the book holds levels restored from a checkpoint.
+    std::atomic<bool> stale = false;
+    // Refreshes counted towards the promotion since `window_start`.
+    int64_t window_start = 0;
+    uint64_t window_refreshes = 0;
+
+    // Only touched by the owning shard.
+    alignas(CACHE_LINE_SIZE) std::unique_ptr<OrderBook> book;
+    std::unique_ptr<OrderBook> spare;
+    bool rebuilding = false;
+    int64_t rebuild_started = 0;
+    // Only for books added with queues, set once when the book is added.
+    std::unique_ptr<QueueBook> queues;
+    std::vector<TrackedOrder> tracked;
+    std::unique_ptr<Seqlock<QueuePositions>> positions;
+    // Orders tracked or about to be, counted by `track` so that no more than
+    // fit in `QueuePositions` are ever queued.
+    std::atomic<size_t> tracking = 0;
+
+    Seqlock<TopOfBook> top;
+    uint64_t sequence = 0;
+    // Levels and sequence of the book as of the last checkpoint.
+    std::vector<Level> saved[2];
+    uint64_t saved_sequence = 0;
+
+    Book(double tick_size, BookOptions const& options);
+  };
+
+  // Tracks or cancels an order of a book with queues on the owning shard.
+  typedef struct {
+    SymbolId symbol;
+    QueueBook::OrderId order;
+    bool cancel;
+    Side side;
+    double price;
+    double quantity;
+  } OrderCommand;
+
+  struct Shard {
+    std::thread thread;
+    SpscQueue<BookRecord> queue;
+    // Pushed to from any thread, unlike `queue`.
+    MpscQueue<OrderCommand> orders;
+    std::atomic<uint64_t> orders_enqueued = 0;
+    std::atomic<uint64_t> orders_applied = 0;
+
+    std::atomic<uint64_t> enqueued = 0;
+    std::atomic<uint64_t> applied = 0;
+    // Number of messages published to readers.
+    std::atomic<uint64_t> published = 0;
+    std::atomic<uint64_t> overflows = 0;
+    std::atomic<size_t> max_depth = 0;
+    HdrHistogram rebuild_time;
+    // Records of the message being dequeued, applied to its book at once.
+    BidAskDelta batch;
+    BidAskSnapshot refresh;
+
+    // Lets an idle worker sleep until the datasource wakes it up.
+    std::atomic<bool> sleeping = false;
+    std::atomic<uint32_t> wakeups = 0;
+    std::atomic<bool> stopping = false;
+
+    // A checkpoint is asked for by bumping `save_requests`, the shard copies
+    // its books and catches `saves` up.
+    std::atomic<uint64_t> save_requests = 0;
+    std::atomic<uint64_t> saves = 0;
+
+    Shard(size_t queue_size);
+  };
+
+  SymbolTable symbols;
+  // Indexed by symbol id, sized up front so that adding books never moves
+  // books which are being updated.
+  std::vector<std::unique_ptr<Book>> books;
+  // Books are added one at a time, readers never take it.
+  std::mutex add_mutex;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  // Readers waiting for updates, shards only take the lock to wake them when
+  // there are any.
+  std::atomic<uint32_t> waiters = 0;
+  std::mutex update_mutex;
+  std::condition_variable update_signal;
+
+  // Only one checkpoint is taken at a time.
+  std::mutex save_mutex;
+
+  std::atomic<QueueBook::OrderId> next_order = 1;
+
+  std::function<void(SymbolId)> recovery_handler;
+  std::function<void(SymbolId, TopOfBook const&)> top_of_book_handler;
+
+  Shard& shard_of(SymbolId id);
+  void enqueue(Shard& shard, BookRecord const& record);
+  void enqueue_snapshot(SymbolId id, BidAskSnapshot const& snapshot);
+  void commit(Shard& shard);
+  void wake(Shard& shard);
+  // Checks the sequence numbers a delta takes up, `first` to `last`, against
+  // the book's stream, returns false if the delta has to be dropped.
+  bool accept(SymbolId id, uint64_t first, uint64_t last);
+  void rebuild(Shard& shard, Book& book, BookRecord const& record);
+  void refresh(Shard& shard, Book& book, BookRecord const& record);
+  // Counts a refresh of a book with a depth, switches the book to the whole
+  // book once they come faster than its promotion rate.
+  void count_refresh(SymbolId id);
+  void trade(Book& book, BookRecord const& record);
+  void enqueue_order(SymbolId id, OrderCommand&& command);
+  void apply_order(OrderCommand const& command);
+  void publish(Shard& shard, SymbolId id, Book& book);
+  void publish_positions(Book& book);
+  // Copies the levels of the shard's books for a checkpoint.
+  void copy_books(Shard& shard);
+  void run(Shard& shard);
+
+ public:
+  BookManager(size_t workers,
+              size_t capacity = DEFAULT_BOOK_CAPACITY,
+              size_t queue_size = DEFAULT_QUEUE_SIZE);
+  ~BookManager();
+
+  size_t size() const;
+  size_t workers() const;
+
+  // Adds a book for `symbol`, returns the id of the existing book if there is
+  // one already. Safe to call from any thread while the books are in use: the
+  // book is in place before its id is published, so whoever sees the id
+  // through `size`, `find` or the symbol table sees the book too. Queue
+  // positions cost the books without them nothing.
+  SymbolId add_book(std::string const& symbol,
+                    double tick_size,
+                    BookOptions const& options = {});
+  std::optional<SymbolId> find(std::string_view symbol) const;
+  std::string const& symbol(SymbolId id) const;
+  // The table books are added to, datasources resolve their symbols through it
+  // once at the edge.
+  SymbolTable const& interned_symbols() const;
+
+  // Only safe to read from outside of the owning shard once flushed.
+  OrderBook& book(SymbolId id);
+  bool has_queues(SymbolId id) const;
+  // Number of levels the book is refreshed with, 0 for the whole book. The
+  // recovery handler subscribes to the book with this depth.
+  size_t depth(SymbolId id) const;
+  // Switches the book to another depth and has the recovery handler
+  // subscribe to it again. Snapshots still in flight are applied as if they
+  // came with the new depth until the new subscription's first one replaces
+  // them. Called on the datasource thread, like the `on_*` methods.
+  void set_depth(SymbolId id, size_t depth);
+  // Safe to call from any thread.
+  TopOfBook top_of_book(SymbolId id) const;
+  // Sequence of the last published `TopOfBook`, a single load to tell whether
+  // a book changed. Safe to call from any thread.
+  uint64_t sequence(SymbolId id) const;
+
+  /* Queue positions, only for books with queues */
+
+  // Tracks an order joining the back of its level's queue, as of the last
+  // message the owning shard applied when it takes the order in. Throws if
+  // the book has no queues or tracks `MAX_TRACKED_ORDERS` already. Safe to
+  // call from any thread, the order's position is published once the shard
+  // took it in, which `flush` waits for.
+  QueueBook::OrderId track(SymbolId id,
+                           Side side,
+                           double price,
+                           double quantity);
+  // Stops tracking the order, unknown orders are ignored. Safe to call from
+  // any thread.
+  void cancel(SymbolId id, QueueBook::OrderId order);
+  // As of the last message applied, empty until the order was taken in or
+  // once it was cancelled. Safe to call from any thread.
+  std::optional<QueuePosition> position(SymbolId id,
+                                        QueueBook::OrderId order) const;
+  double trade_rate(SymbolId id, Side side) const;
+  // See `QueueBook::fill_probability`, 0 for unknown orders.
+  double fill_probability(SymbolId id,
+                          QueueBook::OrderId order,
+                          double horizon) const;
+
+  QueueStats stats(size_t shard) const;
+  RebuildStats rebuild_stats(size_t shard) const;
+  SyncStats sync_stats(SymbolId id) const;
+  // Index of the shard which owns the book.
+  size_t shard(SymbolId id) const;
+
+  // Number of messages published to readers across all books, only grows.
+  uint64_t updates() const;
+  // Blocks until more than `seen` messages were published or `timeout`
+  // passed, returns `updates()`. Costs the shards nothing while no one waits.
+  uint64_t wait_for_updates(uint64_t seen, std::chrono::milliseconds timeout);
+
+  // Called on the datasource thread whenever a book needs a new snapshot,
+  // attach it before any update comes in.
+  void attach_recovery_handler(std::function<void(SymbolId)> handler);
+  // Called on the owning shard's thread with every `TopOfBook` it publishes,
+  // for mirroring the books elsewhere. Attach it before any update comes in.
+  void attach_top_of_book_handler(
+      std::function<void(SymbolId, TopOfBook const&)> handler);
+
+  /* Routing updates to the owning shard */
+  void on_snapshot(SymbolId id, BidAskSnapshot const& snapshot);
+  void on_delta(SymbolId id, BidAskDelta const& delta);
+  // Drops the book's deltas until its next snapshot and calls the recovery
+  // handler, for when the datasource knows that updates were lost.
+  void invalidate(SymbolId id);
+
+  // Blocks until every update and order command enqueued so far has been
+  // applied.
+  void flush();
+
+  /* Checkpoints, see `BookCheckpoint` */
+
+  // Writes every level of every book which has been published to `path`. The
+  // shards copy their books in between messages, this blocks until they all
+  // did and the file is written. Safe to call from any thread.
+  void save(std::string const& path);
+  // Fills the books listed in the checkpoint at `path`, returns the number
+  // of books restored. Restored books are stale, they drop deltas like a book
+  // which lost sync until their next snapshot replaces them. Call before any
+  // update comes in, from the thread which then feeds the books.
+  size_t restore(std::string const& path);
+};
+
+#endif  // book_manager
@@ -0,0 +1,51 @@
+#include "book_view.h"
+
+#include <algorithm>
+
+// Quantities are in USD lots on Deribit's perpetuals, fractions only show up
+// on other instruments.
+constexpr int QUANTITY_PRECISION = 1;
+
+BookView::BookView(std::string symbol, size_t depth, int price_precision)
+    : symbol(std::move(symbol)),
+      depth(std::min(depth, TOP_OF_BOOK_DEPTH)) {
+  for (size_t i = 0; i < this->depth; i++) {
+    bids.push_back({NumberCell(price_precision, PRICE_WIDTH),
+                    NumberCell(QUANTITY_PRECISION, QUANTITY_WIDTH)});
+    asks.push_back({NumberCell(price_precision, PRICE_WIDTH),
+                    NumberCell(QUANTITY_PRECISION, QUANTITY_WIDTH)});
+  }
+}
+
+ftxui::Element BookView::row(LevelCells& cells,
+                             Level const* level,
+                             ftxui::Color color) {
+  using namespace ftxui;
+
+  if (level == nullptr)
+    return text(cells.price.clear() + " " + cells.quantity.clear());
+  return hbox({
+      text(cells.price.format(level->price)) | ftxui::color(color),
+      text(" "),
+      text(cells.quantity.format(level->quantity)),
+  });
+}
+
+ftxui::Element BookView::render(TopOfBook const& top) {
+  using namespace ftxui;
+
+  // Missing levels are left blank so that the ladder keeps its shape while
+  // the book fills up
+  Elements rows;
+  rows.push_back(text(symbol) | bold);
+  rows.push_back(separator());
+  for (size_t i = depth; i-- > 0;)
+    rows.push_back(row(asks[i], i < top.ask_count ? &top.asks[i] : nullptr,
+                       Color::Red));
+  rows.push_back(separator());
+  for (size_t i = 0; i < depth; i++)
+    rows.push_back(row(bids[i], i < top.bid_count ? &top.bids[i] : nullptr,
+                       Color::Green));
+
+  return vbox(std::move(rows));
+}
@@ -0,0 +1,42 @@
+#ifndef book_view
+#define book_view
+
+#include <string>
+#include <vector>
+
+#include "book_manager.h"
+#include "frame_diff.h"
+#include "ftxui/dom/elements.hpp"
+
+// Width of the price and quantity cells.
+constexpr size_t PRICE_WIDTH = 12;
+constexpr size_t QUANTITY_WIDTH = 14;
+
+// Renders the best levels of a book as a ladder, asks above bids.
+//
+// The cells of every level are kept between frames so that only levels which
+// changed are formatted again.
+class BookView {
+ private:
+  typedef struct {
+    NumberCell price;
+    NumberCell quantity;
+  } LevelCells;
+
+  std::string symbol;
+  size_t depth;
+  std::vector<LevelCells> bids;
+  std::vector<LevelCells> asks;
+
+  static ftxui::Element row(LevelCells& cells,
+                            Level const* level,
+                            ftxui::Color color);
+
+ public:
+  // Shows `depth` levels a side, at most `TOP_OF_BOOK_DEPTH`.
+  BookView(std::string symbol, size_t depth, int price_precision = 2);
+
+  ftxui::Element render(TopOfBook const& top);
+};
+
+#endif  // book_view
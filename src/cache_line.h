@@ -0,0 +1,9 @@
+#ifndef cache_line
+#define cache_line
+
+#include <cstddef>
+
+// Size of a cache line, used to keep data written by different threads apart.
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+#endif  // cache_line
@@ -0,0 +1,148 @@
+#include "consolidated_book.h"
+
+#include <cmath>
+
+ConsolidatedBook::ConsolidatedBook(double tick_size) : tick_size(tick_size) {}
+
+int64_t ConsolidatedBook::to_ticks(double price, double basis) const {
+  return std::llround((price + basis) / tick_size);
+}
+
+void ConsolidatedBook::add(Side side, int64_t tick, double quantity) {
+  Entry& entry = levels[int(side)][tick];
+  entry.quantity += quantity;
+  entry.sources++;
+}
+
+void ConsolidatedBook::remove(Side side, int64_t tick, double quantity) {
+  auto it = levels[int(side)].find(tick);
+  if (it == levels[int(side)].end())
+    return;
+  // Counting the sources rather than checking the size for 0, which rounding
+  // may never quite get back to
+  if (--it->second.sources == 0)
+    levels[int(side)].erase(it);
+  else
+    it->second.quantity -= quantity;
+}
+
+void ConsolidatedBook::merge(Side side,
+                             std::span<Level const> before,
+                             double before_basis,
+                             std::span<Level const> after,
+                             double after_basis) {
+  auto better = [side](int64_t a, int64_t b) {
+    return side == Side::Bid ? a > b : a < b;
+  };
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < before.size() || j < after.size()) {
+    int64_t old_tick =
+        i < before.size() ? to_ticks(before[i].price, before_basis) : 0;
+    int64_t new_tick =
+        j < after.size() ? to_ticks(after[j].price, after_basis) : 0;
+
+    if (j == after.size() ||
+        (i < before.size() && better(old_tick, new_tick))) {
+      remove(side, old_tick, before[i++].quantity);
+    } else if (i == before.size() || better(new_tick, old_tick)) {
+      add(side, new_tick, after[j++].quantity);
+    } else {
+      // The same level, only a change of size reaches the book
+      double change = after[j++].quantity - before[i++].quantity;
+      if (change != 0)
+        levels[int(side)][new_tick].quantity += change;
+    }
+  }
+}
+
+std::optional<int64_t> ConsolidatedBook::horizon(Side side) const {
+  std::optional<int64_t> horizon;
+  for (auto const& source : sources) {
+    auto const& levels = source.levels[int(side)];
+    if (!source.truncated[int(side)] || levels.empty())
+      continue;
+    int64_t worst = to_ticks(levels.back().price, source.basis);
+    if (!horizon.has_value() ||
+        (side == Side::Bid ? worst > *horizon : worst < *horizon))
+      horizon = worst;
+  }
+  return horizon;
+}
+
+size_t ConsolidatedBook::add_source(SymbolId id, double basis) {
+  sources.push_back({.id = id, .basis = basis});
+  return sources.size() - 1;
+}
+
+void ConsolidatedBook::set_basis(size_t source, double basis) {
+  Source& s = sources[source];
+  for (Side side : {Side::Bid, Side::Ask})
+    merge(side, s.levels[int(side)], s.basis, s.levels[int(side)], basis);
+  s.basis = basis;
+}
+
+void ConsolidatedBook::update(size_t source,
+                              Side side,
+                              std::span<Level const> levels,
+                              bool truncated) {
+  Source& s = sources[source];
+  merge(side, s.levels[int(side)], s.basis, levels, s.basis);
+  s.levels[int(side)].assign(levels.begin(), levels.end());
+  s.truncated[int(side)] = truncated;
+}
+
+void ConsolidatedBook::update(size_t source, TopOfBook const& top) {
+  update(source, Side::Bid, std::span(top.bids, top.bid_count),
+         top.bid_count == TOP_OF_BOOK_DEPTH);
+  update(source, Side::Ask, std::span(top.asks, top.ask_count),
+         top.ask_count == TOP_OF_BOOK_DEPTH);
+  sources[source].sequence = top.sequence;
+}
+
+size_t ConsolidatedBook::poll(BookManager const& books) {
+  size_t updated = 0;
+  for (size_t i = 0; i < sources.size(); i++) {
+    if (books.sequence(sources[i].id) == sources[i].sequence)
+      continue;
+    update(i, books.top_of_book(sources[i].id));
+    updated++;
+  }
+  return updated;
+}
+
+size_t ConsolidatedBook::size() const {
+  return sources.size();
+}
+
+size_t ConsolidatedBook::best_levels(Side side,
+                                     std::span<ConsolidatedLevel> levels) const {
+  auto horizon = this->horizon(side);
+  auto past_horizon = [&](int64_t tick) {
+    if (!horizon.has_value())
+      return false;
+    return side == Side::Bid ? tick < *horizon : tick > *horizon;
+  };
+  size_t count = 0;
+  auto copy = [&](auto begin, auto end) {
+    for (auto it = begin; it != end && count < levels.size(); it++) {
+      if (past_horizon(it->first))
+        break;
+      levels[count++] = {double(it->first) * tick_size, it->second.quantity,
+                         it->second.sources};
+    }
+  };
+  if (side == Side::Bid)
+    copy(this->levels[int(side)].rbegin(), this->levels[int(side)].rend());
+  else
+    copy(this->levels[int(side)].begin(), this->levels[int(side)].end());
+  return count;
+}
+
+std::optional<ConsolidatedLevel> ConsolidatedBook::best(Side side) const {
+  ConsolidatedLevel level;
+  if (best_levels(side, std::span(&level, 1)) == 0)
+    return std::nullopt;
+  return level;
+}
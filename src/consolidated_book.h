@@ -0,0 +1,101 @@
+#ifndef consolidated_book
+#define consolidated_book
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "book_manager.h"
+#include "level_storage.h"
+#include "symbol_table.h"
+
+// A level of the consolidated book, with the number of sources which have size
+// at its price.
+typedef struct {
+  double price;
+  double quantity;
+  uint32_t sources;
+} ConsolidatedLevel;
+
+// Merges the best levels of several books of the same underlying into one
+// book, each source's prices moved by its basis first, e.g. dated futures onto
+// the perpetual.
+//
+// Every level of the consolidated book keeps the total size of the sources at
+// its price. When a source changes only that source is merged again: its old
+// and new levels are walked side by side and only the levels which differ
+// touch the consolidated book, so an update costs the same however many
+// sources there are and nothing when a level did not change.
+//
+// Sources only publish their best `TOP_OF_BOOK_DEPTH` levels, so past the
+// worst level of a source which has more there may be size missing. Levels
+// past that horizon are not reported.
+//
+// Not thread safe, owned by the thread that polls it.
+class ConsolidatedBook {
+ private:
+  struct Source {
+    SymbolId id;
+    double basis;
+    // Published sequence of the book as of the last poll.
+    uint64_t sequence = 0;
+    // Levels of each side as last merged, best first and not moved.
+    std::vector<Level> levels[2] = {};
+    // Whether the source has levels past the last of `levels`.
+    bool truncated[2] = {false, false};
+  };
+
+  typedef struct {
+    double quantity;
+    uint32_t sources;
+  } Entry;
+
+  double tick_size;
+  std::vector<Source> sources;
+  // Keyed by tick, bids are walked from the end.
+  std::map<int64_t, Entry> levels[2];
+
+  int64_t to_ticks(double price, double basis) const;
+  // Moves the levels of a source from `before` to `after`, both best first.
+  void merge(Side side,
+             std::span<Level const> before,
+             double before_basis,
+             std::span<Level const> after,
+             double after_basis);
+  void add(Side side, int64_t tick, double quantity);
+  void remove(Side side, int64_t tick, double quantity);
+  // The worst tick which is known to hold all of its size.
+  std::optional<int64_t> horizon(Side side) const;
+
+ public:
+  ConsolidatedBook(double tick_size);
+
+  // Adds the book `id` as a source, `basis` is added to its prices. Returns
+  // the index of the source.
+  size_t add_source(SymbolId id, double basis);
+  // Moves the levels of a source to a new basis.
+  void set_basis(size_t source, double basis);
+
+  // Replaces the levels of one side of a source, `levels` are best first.
+  // `truncated` tells whether the source has more levels than these.
+  void update(size_t source,
+              Side side,
+              std::span<Level const> levels,
+              bool truncated);
+  void update(size_t source, TopOfBook const& top);
+  // Updates the sources whose books were published since the last poll,
+  // returns the number of sources updated. Costs a single load for every
+  // source which did not change.
+  size_t poll(BookManager const& books);
+
+  size_t size() const;
+
+  // Copies the best consolidated levels of a side into `levels`, up to the
+  // horizon. Returns the number of levels copied.
+  size_t best_levels(Side side, std::span<ConsolidatedLevel> levels) const;
+  std::optional<ConsolidatedLevel> best(Side side) const;
+};
+
+#endif  // consolidated_book
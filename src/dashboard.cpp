@@ -0,0 +1,103 @@
+#include "dashboard.h"
+
+#include <cmath>
+
+// Decimals needed to show every multiple of `tick_size`.
+static int precision_of(double tick_size) {
+  int precision = 0;
+  for (double scaled = tick_size;
+       precision < 8 && std::abs(scaled - std::round(scaled)) > 1e-9;
+       scaled *= 10)
+    precision++;
+  return precision;
+}
+
+Dashboard::Dashboard(BookManager& books) : books(books) {}
+
+void Dashboard::add(SymbolId id, size_t depth, double tick_size) {
+  panels.push_back({
+      .id = id,
+      .view = BookView(books.symbol(id), depth, precision_of(tick_size)),
+      .sampled_sequence = books.top_of_book(id).sequence,
+      .sampled_at = std::chrono::steady_clock::now(),
+      .rate = 0,
+      .rate_cell = NumberCell(0, 7),
+      .queue_cell = NumberCell(0, 7),
+      .age_cell = NumberCell(0, 7),
+      .recovery_cell = NumberCell(0, 7),
+      .rebuild_cell = NumberCell(3, 7),
+      .microprice_cell =
+          NumberCell(precision_of(tick_size) + 2, PRICE_WIDTH),
+      .imbalance_cell = NumberCell(2, 7),
+  });
+}
+
+void Dashboard::report(std::string message) {
+  std::lock_guard<std::mutex> lock(reports_mutex);
+  reports.push_back(std::move(message));
+  if (reports.size() > MAX_REPORTS)
+    reports.pop_front();
+}
+
+ftxui::Element Dashboard::render(Panel& panel,
+                                 std::chrono::steady_clock::time_point now) {
+  using namespace ftxui;
+  using namespace std::chrono;
+
+  auto top = books.top_of_book(panel.id);
+
+  if (now - panel.sampled_at >= RATE_INTERVAL) {
+    panel.rate = (top.sequence - panel.sampled_sequence) /
+                 duration<double>(now - panel.sampled_at).count();
+    panel.sampled_sequence = top.sequence;
+    panel.sampled_at = now;
+  }
+
+  // The view is stamped on the steady clock when it is published
+  auto published = steady_clock::time_point(nanoseconds(top.timestamp));
+  auto stats = books.stats(books.shard(panel.id));
+  auto rebuilds = books.rebuild_stats(books.shard(panel.id));
+  auto sync = books.sync_stats(panel.id);
+
+  Element age = top.sequence == 0
+                    ? text(panel.age_cell.clear())
+                    : text(panel.age_cell.format(
+                          duration<double, std::milli>(now - published)
+                              .count()));
+
+  return vbox({
+             panel.view.render(top),
+             separator(),
+             hbox({top.bid_count > 0 && top.ask_count > 0
+                       ? text(panel.microprice_cell.format(
+                             top.metrics.microprice))
+                       : text(panel.microprice_cell.clear()),
+                   text(" micro")}),
+             hbox({text(panel.imbalance_cell.format(top.metrics.imbalance)),
+                   text(" imbalance")}),
+             hbox({text(panel.rate_cell.format(panel.rate)), text(" upd/s")}),
+             hbox({text(panel.queue_cell.format(stats.depth)),
+                   text(" queued")}),
+             hbox({age, text(" ms ago")}),
+             hbox({text(panel.recovery_cell.format(sync.recoveries)),
+                   text(top.stale     ? " resyncs, restored"
+                        : sync.synced ? " resyncs"
+                                      : " resyncs, waiting")}),
+             hbox({text(panel.rebuild_cell.format(rebuilds.max / 1e6)),
+                   text(" ms max rebuild")}),
+         }) |
+         border;
+}
+
+ftxui::Element Dashboard::render() {
+  auto now = std::chrono::steady_clock::now();
+  ftxui::Elements tiles;
+  for (auto& panel : panels)
+    tiles.push_back(render(panel, now));
+
+  ftxui::Elements lines = {ftxui::flexbox(std::move(tiles))};
+  std::lock_guard<std::mutex> lock(reports_mutex);
+  for (auto const& report : reports)
+    lines.push_back(ftxui::text(report));
+  return ftxui::vbox(std::move(lines));
+}
@@ -0,0 +1,70 @@
+#ifndef dashboard
+#define dashboard
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "book_manager.h"
+#include "book_view.h"
+#include "frame_diff.h"
+#include "ftxui/dom/elements.hpp"
+
+// How often the update rate of each book is sampled.
+constexpr auto RATE_INTERVAL = std::chrono::seconds(1);
+
+// Number of the latest reports shown below the books.
+constexpr size_t MAX_REPORTS = 5;
+
+// Shows many books side by side, each with its update rate, the backlog of
+// the shard it belongs to, how long ago it last changed and how often it had
+// to be rebuilt, along with its microprice and imbalance.
+//
+// Everything is read from the views the shards publish, so drawing the
+// dashboard never holds up the shards however many books it shows.
+//
+// Events such as rejected subscriptions are reported below the books rather
+// than written to the terminal, which would garble the frame.
+class Dashboard {
+ private:
+  typedef struct {
+    SymbolId id;
+    BookView view;
+    // Published sequence and time of the last rate sample.
+    uint64_t sampled_sequence;
+    std::chrono::steady_clock::time_point sampled_at;
+    double rate;
+    NumberCell rate_cell;
+    NumberCell queue_cell;
+    NumberCell age_cell;
+    NumberCell recovery_cell;
+    NumberCell rebuild_cell;
+    NumberCell microprice_cell;
+    NumberCell imbalance_cell;
+  } Panel;
+
+  BookManager& books;
+  std::vector<Panel> panels;
+  std::mutex reports_mutex;
+  std::deque<std::string> reports;
+
+  ftxui::Element render(Panel& panel,
+                        std::chrono::steady_clock::time_point now);
+
+ public:
+  Dashboard(BookManager& books);
+
+  // Shows the book of `id` with `depth` levels a side, prices are shown with
+  // as many decimals as the tick size has.
+  void add(SymbolId id, size_t depth, double tick_size);
+  // Shows `message` until `MAX_REPORTS` newer ones came in. Safe to call from
+  // any thread, it is drawn with the next frame.
+  void report(std::string message);
+
+  ftxui::Element render();
+};
+
+#endif  // dashboard
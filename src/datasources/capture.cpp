@@ -0,0 +1,246 @@
+#include "capture.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace Capture
+{
+  namespace
+  {
+    constexpr size_t ALIGNMENT = 8;
+    // Writes are handed to the file once this much is buffered.
+    constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    size_t padded(size_t size)
+    {
+      return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    template <typename T>
+    T read(char const *data)
+    {
+      T value;
+      std::memcpy(&value, data, sizeof(T));
+      return value;
+    }
+  } // namespace
+
+  int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  Writer::Writer(std::string const &path) : m_file(nullptr), m_buffer()
+  {
+    this->m_file = std::fopen(path.c_str(), "ab+");
+    if (this->m_file == nullptr)
+      throw std::runtime_error("Could not open capture file " + path);
+
+    std::fseek(this->m_file, 0, SEEK_END);
+    if (std::ftell(this->m_file) == 0)
+    {
+      FileHeader header = {};
+      std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+      header.version = VERSION;
+      header.header_size = sizeof(FileHeader);
+      append_bytes(&header, sizeof(header));
+      return;
+    }
+
+    // Appending to an existing capture, make sure it is one
+    FileHeader header;
+    std::rewind(this->m_file);
+    if (std::fread(&header, sizeof(header), 1, this->m_file) != 1 ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION)
+    {
+      std::fclose(this->m_file);
+      throw std::runtime_error(path + " is not a capture file");
+    }
+    std::fseek(this->m_file, 0, SEEK_END);
+  }
+
+  Writer::~Writer()
+  {
+    flush();
+    std::fclose(this->m_file);
+  }
+
+  void Writer::append_bytes(void const *data, size_t size)
+  {
+    this->m_buffer.append(static_cast<char const *>(data), size);
+  }
+
+  void Writer::append(RecordKind kind, std::string_view symbol, int64_t timestamp,
+                      uint32_t bid_count, uint32_t ask_count, uint32_t trade_count)
+  {
+    size_t item_size = kind == RecordKind::Snapshot ? sizeof(Offer) : sizeof(StoredChange);
+
+    RecordHeader header = {};
+    header.size = sizeof(RecordHeader) + padded(symbol.size()) +
+                  (bid_count + ask_count) * item_size + trade_count * sizeof(StoredTrade);
+    header.kind = kind;
+    header.symbol_size = symbol.size();
+    header.bid_count = bid_count;
+    header.ask_count = ask_count;
+    header.trade_count = trade_count;
+    header.timestamp = timestamp;
+
+    append_bytes(&header, sizeof(header));
+    append_bytes(symbol.data(), symbol.size());
+    this->m_buffer.append(padded(symbol.size()) - symbol.size(), '\0');
+  }
+
+  void Writer::write(std::string_view symbol, BidAskSnapshot const &snapshot, int64_t timestamp)
+  {
+    append(RecordKind::Snapshot, symbol, timestamp, snapshot.bids.size(), snapshot.asks.size());
+    for (auto const &offer : snapshot.bids)
+      append_bytes(&offer, sizeof(Offer));
+    for (auto const &offer : snapshot.asks)
+      append_bytes(&offer, sizeof(Offer));
+
+    if (this->m_buffer.size() >= BUFFER_SIZE)
+      flush();
+  }
+
+  void Writer::write(std::string_view symbol, BidAskDelta const &delta, int64_t timestamp)
+  {
+    append(RecordKind::Delta, symbol, timestamp, delta.bids.size(), delta.asks.size(), delta.trades.size());
+    for (auto const *changes : {&delta.bids, &delta.asks})
+      for (auto const &change : *changes)
+      {
+        StoredChange stored = {};
+        stored.action = static_cast<uint8_t>(change.action);
+        stored.price = change.offer.price;
+        stored.quantity = change.offer.quantity;
+        append_bytes(&stored, sizeof(stored));
+      }
+    // Books which track queues need the trades to replay the same way
+    for (auto const &trade : delta.trades)
+    {
+      StoredTrade stored = {};
+      stored.aggressor = static_cast<uint8_t>(trade.aggressor);
+      stored.price = trade.offer.price;
+      stored.quantity = trade.offer.quantity;
+      append_bytes(&stored, sizeof(stored));
+    }
+
+    if (this->m_buffer.size() >= BUFFER_SIZE)
+      flush();
+  }
+
+  void Writer::flush()
+  {
+    if (this->m_buffer.empty())
+      return;
+    std::fwrite(this->m_buffer.data(), 1, this->m_buffer.size(), this->m_file);
+    std::fflush(this->m_file);
+    this->m_buffer.clear();
+  }
+
+  Reader::Reader(std::string const &path) : m_data(nullptr), m_size(0), m_offset(0)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Could not open capture file " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader))
+    {
+      close(fd);
+      throw std::runtime_error(path + " is not a capture file");
+    }
+
+    this->m_size = info.st_size;
+    void *data = mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      throw std::runtime_error("Could not map capture file " + path);
+    this->m_data = static_cast<char const *>(data);
+    madvise(data, this->m_size, MADV_SEQUENTIAL);
+
+    auto header = read<FileHeader>(this->m_data);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.header_size < sizeof(FileHeader) || header.header_size > this->m_size)
+    {
+      munmap(data, this->m_size);
+      throw std::runtime_error(path + " is not a capture file");
+    }
+    this->m_offset = header.header_size;
+  }
+
+  Reader::~Reader()
+  {
+    munmap(const_cast<char *>(this->m_data), this->m_size);
+  }
+
+  void Reader::rewind()
+  {
+    this->m_offset = read<FileHeader>(this->m_data).header_size;
+  }
+
+  bool Reader::next(Record &record, BidAskSnapshot &snapshot, BidAskDelta &delta)
+  {
+    if (this->m_size - this->m_offset < sizeof(RecordHeader))
+      return false;
+
+    char const *data = this->m_data + this->m_offset;
+    auto header = read<RecordHeader>(data);
+    if (header.kind != RecordKind::Snapshot && header.kind != RecordKind::Delta)
+      return false;
+    size_t item_size = header.kind == RecordKind::Snapshot ? sizeof(Offer) : sizeof(StoredChange);
+    if (header.kind == RecordKind::Snapshot && header.trade_count != 0)
+      return false;
+    size_t expected = sizeof(RecordHeader) + padded(header.symbol_size) +
+                      (size_t(header.bid_count) + header.ask_count) * item_size +
+                      size_t(header.trade_count) * sizeof(StoredTrade);
+    if (header.size != expected || header.size > this->m_size - this->m_offset)
+      return false;
+
+    record.kind = header.kind;
+    record.timestamp = header.timestamp;
+    record.symbol = std::string_view(data + sizeof(RecordHeader), header.symbol_size);
+
+    char const *items = data + sizeof(RecordHeader) + padded(header.symbol_size);
+    if (header.kind == RecordKind::Snapshot)
+    {
+      snapshot.bids.clear();
+      snapshot.asks.clear();
+      for (uint32_t i = 0; i < header.bid_count; i++, items += sizeof(Offer))
+        snapshot.bids.push_back(read<Offer>(items));
+      for (uint32_t i = 0; i < header.ask_count; i++, items += sizeof(Offer))
+        snapshot.asks.push_back(read<Offer>(items));
+    }
+    else
+    {
+      delta.bids.clear();
+      delta.asks.clear();
+      delta.trades.clear();
+      auto to_change = [](StoredChange const &stored)
+      {
+        return OfferChange{static_cast<OfferAction>(stored.action),
+                           {stored.price, stored.quantity}};
+      };
+      for (uint32_t i = 0; i < header.bid_count; i++, items += sizeof(StoredChange))
+        delta.bids.push_back(to_change(read<StoredChange>(items)));
+      for (uint32_t i = 0; i < header.ask_count; i++, items += sizeof(StoredChange))
+        delta.asks.push_back(to_change(read<StoredChange>(items)));
+      for (uint32_t i = 0; i < header.trade_count; i++, items += sizeof(StoredTrade))
+      {
+        auto stored = read<StoredTrade>(items);
+        delta.trades.push_back({static_cast<Aggressor>(stored.aggressor), {stored.price, stored.quantity}});
+      }
+    }
+
+    this->m_offset += header.size;
+    return true;
+  }
+} // namespace Capture
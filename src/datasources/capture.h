@@ -0,0 +1,130 @@
+#ifndef capture
+#define capture
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "./datasource.h"
+
+// A compact binary log of decoded market data updates.
+//
+// A capture file starts with a `FileHeader` followed by records which are only
+// ever appended. Each record is a `RecordHeader`, the symbol padded to 8 bytes,
+// then the bids, the asks and, for deltas, the trades. Every record is a multiple of 8 bytes long so that
+// the file can be memory mapped and read in place. A record cut short by a crash
+// marks the end of the file.
+namespace Capture
+{
+  constexpr char MAGIC[8] = {'O', 'B', 'C', 'A', 'P', 'T', 'R', 0};
+  constexpr uint32_t VERSION = 2;
+
+  enum class RecordKind : uint8_t
+  {
+    Snapshot,
+    Delta,
+  };
+
+  typedef struct
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+  } FileHeader;
+
+  typedef struct
+  {
+    // Size of the whole record including this header and padding.
+    uint32_t size;
+    RecordKind kind;
+    uint8_t reserved;
+    uint16_t symbol_size;
+    uint32_t bid_count;
+    uint32_t ask_count;
+    // Always 0 for snapshots.
+    uint32_t trade_count;
+    uint32_t reserved_count;
+    // Time the update was received, in nanoseconds since the epoch.
+    int64_t timestamp;
+  } RecordHeader;
+
+  // On disk form of an `OfferChange`, with the action stored explicitly so
+  // that the layout does not depend on the enum's size.
+  typedef struct
+  {
+    uint8_t action;
+    uint8_t reserved[7];
+    double price;
+    double quantity;
+  } StoredChange;
+
+  // On disk form of a `Trade`, like `StoredChange`.
+  typedef struct
+  {
+    uint8_t aggressor;
+    uint8_t reserved[7];
+    double price;
+    double quantity;
+  } StoredTrade;
+
+  // Returns the current time in nanoseconds since the epoch.
+  int64_t now();
+
+  // Appends records to a capture file, creating it if it does not exist.
+  // Writes are buffered, `flush` pushes them to the file.
+  class Writer
+  {
+  private:
+    std::FILE *m_file;
+    std::string m_buffer;
+
+    void append(RecordKind kind, std::string_view symbol, int64_t timestamp,
+                uint32_t bid_count, uint32_t ask_count, uint32_t trade_count = 0);
+    void append_bytes(void const *data, size_t size);
+
+  public:
+    Writer(std::string const &path);
+    ~Writer();
+
+    Writer(Writer const &) = delete;
+    Writer &operator=(Writer const &) = delete;
+
+    void write(std::string_view symbol, BidAskSnapshot const &, int64_t timestamp = now());
+    void write(std::string_view symbol, BidAskDelta const &, int64_t timestamp = now());
+    void flush();
+  };
+
+  // A record decoded from a capture file, `symbol` points into the mapping.
+  typedef struct
+  {
+    RecordKind kind;
+    int64_t timestamp;
+    std::string_view symbol;
+  } Record;
+
+  // Reads a capture file through a read only memory mapping.
+  class Reader
+  {
+  private:
+    char const *m_data;
+    size_t m_size;
+    size_t m_offset;
+
+  public:
+    Reader(std::string const &path);
+    ~Reader();
+
+    Reader(Reader const &) = delete;
+    Reader &operator=(Reader const &) = delete;
+
+    // Reads the next record, filling `snapshot` or `delta` depending on its
+    // kind. Returns false once there are no complete records left.
+    bool next(Record &, BidAskSnapshot &, BidAskDelta &);
+
+    // Goes back to the first record.
+    void rewind();
+  };
+} // namespace Capture
+
+#endif // capture
@@ -1,10 +1,22 @@
 #ifndef datasource
 #define datasource
 
+#include <cstdint>
+
+#include "./small_vector.h"
+
+// Number of entries per side that updates hold without touching the heap,
+// enough for nearly every incremental update.
+constexpr size_t INLINE_OFFERS = 16;
+
+// Number of trades that updates hold without touching the heap.
+constexpr size_t INLINE_TRADES = 4;
+
 // Represents a datasource.
 enum class DatasourceID
 {
     Deribit,
+    Replay,
 };
 
 // An action on an offer, an offer can either be added, updated or removed.
@@ -29,18 +41,46 @@ typedef struct
     Offer offer;
 } OfferChange;
 
-// Represents an orderbook snapshot.
+// The side which took liquidity in a trade, a buyer trades against the asks.
+enum class Aggressor
+{
+    Unknown,
+    Buyer,
+    Seller,
+};
+
+// Represents a trade, the offer holds its price and size.
+typedef struct
+{
+    Aggressor aggressor;
+    Offer offer;
+} Trade;
+
+// Represents an orderbook snapshot, large snapshots spill into blocks which are
+// recycled once the snapshot is destroyed.
 typedef struct
 {
-    std::vector<Offer> bids;
-    std::vector<Offer> asks;
+    SmallVector<Offer, INLINE_OFFERS> bids;
+    SmallVector<Offer, INLINE_OFFERS> asks;
+    // Position of the update in the instrument's stream (RptSeq), 0 when the
+    // datasource does not number its updates. An update whose entries are
+    // numbered each is at the position of its last entry.
+    uint64_t sequence = 0;
 } BidAskSnapshot;
 
 // Represents an orderbook delta update.
 typedef struct
 {
-    std::vector<OfferChange> bids;
-    std::vector<OfferChange> asks;
+    SmallVector<OfferChange, INLINE_OFFERS> bids;
+    SmallVector<OfferChange, INLINE_OFFERS> asks;
+    // Trades reported along with the changes, only when they were subscribed
+    // to.
+    SmallVector<Trade, INLINE_TRADES> trades = {};
+    // See `BidAskSnapshot::sequence`.
+    uint64_t sequence = 0;
+    // Position of the delta's first entry when its entries are numbered each,
+    // otherwise 0 and the delta only takes up `sequence`.
+    uint64_t first_sequence = 0;
 } BidAskDelta;
 
 #endif // datasource
@@ -7,15 +7,77 @@
 #include <quickfix/FixValues.h>
 #include <quickfix/SocketInitiator.h>
 #include <quickfix/fix44/MarketDataRequest.h>
+#include <quickfix/fix44/MarketDataRequestReject.h>
 #include <quickfix/fix44/MarketDataSnapshotFullRefresh.h>
 #include <quickfix/fix44/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix44/SecurityList.h>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
 
 #include "../crypto.h"
+#include "../latency_trace.h"
+#include "./fix_journal.h"
+#include "./fix_scanner.h"
 
 namespace Deribit
 {
+  TapLogFactory::TapLog::TapLog(FIX::Log *log, std::function<void(std::string const &)> const &tap)
+      : m_log(log), m_tap(tap) {}
+
+  FIX::Log *TapLogFactory::TapLog::log() const { return this->m_log; }
+
+  void TapLogFactory::TapLog::clear() { this->m_log->clear(); }
+
+  void TapLogFactory::TapLog::backup() { this->m_log->backup(); }
+
+  void TapLogFactory::TapLog::onIncoming(std::string const &message)
+  {
+    this->m_tap(message);
+    this->m_log->onIncoming(message);
+  }
+
+  void TapLogFactory::TapLog::onOutgoing(std::string const &message) { this->m_log->onOutgoing(message); }
+
+  void TapLogFactory::TapLog::onEvent(std::string const &event) { this->m_log->onEvent(event); }
+
+  TapLogFactory::TapLogFactory(FIX::LogFactory &log_factory, std::function<void(std::string const &)> tap)
+      : m_log_factory(log_factory), m_tap(tap) {}
+
+  FIX::Log *TapLogFactory::create() { return new TapLog(this->m_log_factory.create(), this->m_tap); }
+
+  FIX::Log *TapLogFactory::create(FIX::SessionID const &session_id)
+  {
+    return new TapLog(this->m_log_factory.create(session_id), this->m_tap);
+  }
+
+  void TapLogFactory::destroy(FIX::Log *log)
+  {
+    auto tap_log = static_cast<TapLog *>(log);
+    this->m_log_factory.destroy(tap_log->log());
+    delete tap_log;
+  }
+
+  bool matches(InstrumentFilter const &filter, Instrument const &instrument)
+  {
+    return (filter.currency.empty() || filter.currency == instrument.currency) &&
+           (filter.kind.empty() || filter.kind == instrument.kind) &&
+           (filter.expiry.empty() || filter.expiry == instrument.expiry);
+  }
+
   Fix::~Fix()
   {
+    if (this->m_request_thread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+        this->m_stopping = true;
+      }
+      this->m_subscriptions_changed.notify_one();
+      this->m_request_thread.join();
+    }
+
     if (this->m_initiator != nullptr)
     {
       this->m_initiator->stop();
@@ -25,19 +87,74 @@ namespace Deribit
     this->m_settings.reset();
     this->m_synch.reset();
     this->m_store_factory.reset();
+    this->m_tap_log_factory.reset();
     this->m_log_factory.reset();
+    this->m_journal_writer.reset();
   }
 
   Fix::Fix(FIX::SessionSettings settings)
-      : m_session_id(), m_request_id(0), m_client_order_id(0),
-        m_initiator(nullptr), m_settings(), m_synch(), m_store_factory(),
-        m_log_factory()
+      : m_session_id(), m_request_id(0), m_logged_on(false), m_stopping(false),
+        m_subscriptions(100), m_max_request_rate(10), m_client_order_id(0),
+        m_initiator(nullptr), m_settings(), m_synch(), m_journal_writer(),
+        m_store_factory(), m_log_factory(), m_tap_log_factory(), m_fast_decoding(true),
+        m_differential_decoding(false), m_decode_mismatches(0), m_logons(0), m_symbols(nullptr)
   {
     // Initializing quickfix engine
     this->m_settings = std::make_unique<FIX::SessionSettings>(settings);
     this->m_synch = std::make_unique<FIX::SynchronizedApplication>(*this);
-    this->m_store_factory = std::make_unique<FIX::FileStoreFactory>(*m_settings);
-    this->m_log_factory = std::make_unique<FIX::FileLogFactory>(*m_settings);
+
+    auto const &defaults = this->m_settings->get();
+    if (!defaults.has("AsyncStore") || defaults.getBool("AsyncStore"))
+    {
+      this->m_journal_writer = std::make_unique<Journal::Writer>();
+      this->m_store_factory = std::make_unique<FixJournal::StoreFactory>(*m_settings, *this->m_journal_writer);
+      this->m_log_factory = std::make_unique<FixJournal::LogFactory>(*m_settings, *this->m_journal_writer);
+    }
+    else
+    {
+      this->m_store_factory = std::make_unique<FIX::FileStoreFactory>(*m_settings);
+      this->m_log_factory = std::make_unique<FIX::FileLogFactory>(*m_settings);
+    }
+
+    // Keep a copy of raw market data messages for the fast decoder, they are
+    // handed to `fromApp` on the same thread right after being logged
+    this->m_tap_log_factory = std::make_unique<TapLogFactory>(
+        *this->m_log_factory,
+        [this](std::string const &message)
+        {
+          LatencyTrace::received(LatencyTrace::now());
+
+          auto const msg_type = FixScanner::message_type(message);
+          bool const market_data = msg_type == "W" || msg_type == "X";
+          if (this->m_fast_decoding && market_data)
+            this->m_raw_message.assign(message);
+          else
+            this->m_raw_message.clear();
+
+          if constexpr (LatencyTrace::ENABLED)
+            if (market_data)
+              this->trace_exchange_latency(message);
+        });
+
+    if (defaults.has("FastDecoding"))
+      this->m_fast_decoding = defaults.getBool("FastDecoding");
+    if (defaults.has("DifferentialDecoding"))
+      this->m_differential_decoding = defaults.getBool("DifferentialDecoding");
+    if (defaults.has("MaxSymbolsPerRequest"))
+      this->m_subscriptions = SubscriptionQueue(std::max(defaults.getInt("MaxSymbolsPerRequest"), 1));
+    if (defaults.has("MaxRequestRate"))
+      this->m_max_request_rate = std::max(defaults.getDouble("MaxRequestRate"), 0.1);
+  }
+
+  void Fix::trace_exchange_latency(std::string_view raw)
+  {
+    if (auto sending_time = FixScanner::find_field(raw, FIX::FIELD::SendingTime))
+      if (auto timestamp = FixScanner::parse_timestamp(*sending_time))
+        LatencyTrace::since_utc(LatencyTrace::Stage::Wire, *timestamp);
+
+    if (auto entry_date = FixScanner::find_field(raw, FIX::FIELD::MDEntryDate))
+      if (auto timestamp = FixScanner::parse_timestamp(*entry_date))
+        LatencyTrace::since_utc(LatencyTrace::Stage::Exchange, *timestamp);
   }
 
   void Fix::run() EXCEPT(std::runtime_error)
@@ -46,9 +163,10 @@ namespace Deribit
     {
       m_initiator =
           new FIX::SocketInitiator(*this->m_synch, *this->m_store_factory,
-                                   *this->m_settings, *this->m_log_factory);
+                                   *this->m_settings, *this->m_tap_log_factory);
 
       m_initiator->start();
+      this->m_request_thread = std::thread(&Fix::send_requests, this);
       // printf("[%s][run] Started socket initiator\n",
       //        this->m_session_id.toString().c_str());
     }
@@ -60,16 +178,59 @@ namespace Deribit
     }
   }
 
-  void Fix::attach_bid_ask_snapshot_handler(std::function<void(std::string const &, BidAskSnapshot const &)> handler)
+  void Fix::attach_symbols(SymbolTable const &symbols)
+  {
+    this->m_symbols = &symbols;
+  }
+
+  std::optional<SymbolId> Fix::resolve(std::string_view symbol) const
+  {
+    if (this->m_symbols == nullptr)
+      return std::nullopt;
+    return this->m_symbols->find(symbol);
+  }
+
+  void Fix::attach_bid_ask_snapshot_handler(std::function<void(SymbolId, BidAskSnapshot const &)> handler)
   {
     this->m_bid_ask_snapshot_handler = handler;
   }
 
-  void Fix::attach_bid_ask_delta_handler(std::function<void(std::string const &, BidAskDelta const &)> handler)
+  void Fix::attach_bid_ask_delta_handler(std::function<void(SymbolId, BidAskDelta const &)> handler)
   {
     this->m_bid_ask_delta_handler = handler;
   }
 
+  void Fix::attach_resync_handler(std::function<void()> handler)
+  {
+    this->m_resync_handler = handler;
+  }
+
+  void Fix::attach_logon_handler(std::function<void()> handler)
+  {
+    this->m_logon_handler = handler;
+  }
+
+  void Fix::attach_reject_handler(std::function<void(std::string const &, std::string const &)> handler)
+  {
+    this->m_reject_handler = handler;
+  }
+
+  void Fix::attach_instruments_handler(std::function<void(std::vector<Instrument> const &)> handler)
+  {
+    this->m_instruments_handler = handler;
+  }
+
+  bool Fix::logged_on()
+  {
+    std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+    return this->m_logged_on;
+  }
+
+  uint64_t Fix::decode_mismatches() const
+  {
+    return this->m_decode_mismatches;
+  }
+
   void Fix::request_test()
   {
     FIX::Message message;
@@ -84,14 +245,94 @@ namespace Deribit
     //        std::to_string(this->m_request_id).c_str());
   }
 
-  void Fix::request_order_book(std::string const &symbol)
+  void Fix::request_order_book(std::string const &symbol, Subscription subscription)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+      this->m_subscriptions.queue(symbol, subscription);
+    }
+    this->m_subscriptions_changed.notify_one();
+  }
+
+  void Fix::request_order_books(std::vector<std::string> const &symbols, Subscription subscription)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+      for (auto const &symbol : symbols)
+        this->m_subscriptions.queue(symbol, subscription);
+    }
+    this->m_subscriptions_changed.notify_one();
+  }
+
+  void Fix::send_requests()
+  {
+    // Messages are paced by a bucket of credits, a second worth of messages
+    // can go out at once
+    double credits = this->m_max_request_rate;
+    auto refilled = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(this->m_subscriptions_mutex);
+    while (true)
+    {
+      this->m_subscriptions_changed.wait(lock, [this]
+                                         { return this->m_stopping || (this->m_logged_on && this->m_subscriptions.pending()); });
+      if (this->m_stopping)
+        return;
+
+      auto const now = std::chrono::steady_clock::now();
+      credits = std::min(this->m_max_request_rate,
+                         credits + std::chrono::duration<double>(now - refilled).count() * this->m_max_request_rate);
+      refilled = now;
+      if (credits < 1)
+      {
+        auto const wait = std::chrono::duration<double>((1 - credits) / this->m_max_request_rate);
+        this->m_subscriptions_changed.wait_for(lock, wait, [this]
+                                               { return this->m_stopping; });
+        continue;
+      }
+
+      auto const request = this->m_subscriptions.next(std::to_string(this->m_request_id++));
+      if (!request.has_value())
+        continue;
+      credits -= 1 + request->cancels.size();
+
+      // Sending outside of the lock, QuickFIX's thread takes it from callbacks
+      // while holding the session
+      lock.unlock();
+      // Cancelling the earlier subscriptions first, their updates stop before
+      // the snapshots of the new one come in
+      for (auto const &[previous, cancelled] : request->cancels)
+        this->send_order_book_cancel(cancelled, previous);
+      this->send_order_book_request(request->symbols, request->subscription, request->request_id);
+      lock.lock();
+    }
+  }
+
+  void Fix::send_order_book_cancel(std::vector<std::string> const &symbols, std::string const &request_id)
+  {
+    FIX::Message cancel;
+    cancel.getHeader().setField(FIX::MsgType(FIX::MsgType_MarketDataRequest));
+    cancel.setField(FIX::MDReqID(request_id));
+    cancel.setField(FIX::SubscriptionRequestType(
+        FIX::SubscriptionRequestType_DISABLE_PREVIOUS_SNAPSHOT));
+    cancel.setField(FIX::NoRelatedSym(symbols.size()));
+    FIX44::MarketDataRequest::NoRelatedSym related_symbols;
+    for (auto const &symbol : symbols)
+    {
+      related_symbols.set(FIX::Symbol(symbol));
+      cancel.addGroup(related_symbols);
+    }
+    FIX::Session::sendToTarget(cancel, this->m_session_id);
+  }
+
+  void Fix::send_order_book_request(std::vector<std::string> const &symbols, Subscription subscription,
+                                    std::string const &request_id)
   {
     FIX::Message message;
     FIX::Header &header = message.getHeader();
 
     header.setField(FIX::MsgType(FIX::MsgType_MarketDataRequest));
-    message.setField(FIX::Symbol(symbol));
-    message.setField(FIX::MDReqID(std::to_string(this->m_request_id++)));
+    message.setField(FIX::MDReqID(request_id));
     message.setField(FIX::SubscriptionRequestType(
         FIX::SubscriptionRequestType_SNAPSHOT_AND_UPDATES));
 
@@ -101,22 +342,36 @@ namespace Deribit
     // MDUpdateType=0, MarketDepth=(1,10,20). This results in Market Data - Full Refresh(W) messages,
     // containing the entire specified order book depth. Valid values for MarketDepth are 1, 10, 20.
     // See docs: <https://docs.deribit.com/#market-data-request-v>
-    message.setField(FIX::MDUpdateType(1));
-    message.setField(FIX::MarketDepth(0));
+    message.setField(FIX::MDUpdateType(subscription.depth == 0 ? 1 : 0));
+    message.setField(FIX::MarketDepth(subscription.depth));
 
-    // Request only bid and ask prices
-    message.setField(FIX::NoMDEntryTypes(2));
+    // Request bid and ask prices, and the trades for books which track queues
+    message.setField(FIX::NoMDEntryTypes(subscription.trades ? 3 : 2));
     FIX44::MarketDataRequest::NoMDEntryTypes entry_types;
     entry_types.set(FIX::MDEntryType_BID);
     message.addGroup(entry_types);
     entry_types.set(FIX::MDEntryType_OFFER);
     message.addGroup(entry_types);
+    if (subscription.trades)
+    {
+      entry_types.set(FIX::MDEntryType_TRADE);
+      message.addGroup(entry_types);
+    }
+
+    // Every book of the request shares its depth and entry types
+    message.setField(FIX::NoRelatedSym(symbols.size()));
+    FIX44::MarketDataRequest::NoRelatedSym related_symbols;
+    for (auto const &symbol : symbols)
+    {
+      related_symbols.set(FIX::Symbol(symbol));
+      message.addGroup(related_symbols);
+    }
 
     FIX::Session::sendToTarget(message, this->m_session_id);
-    // printf("[%s][request_order_book] Sent market data (orderbook) request %s for %s\n",
+    // printf("[%s][request_order_book] Sent market data (orderbook) request %s for %zu symbols\n",
     //        this->m_session_id.toString().c_str(),
-    //        std::to_string(this->m_request_id).c_str(),
-    //        symbol.c_str());
+    //        request_id.c_str(),
+    //        symbols.size());
   }
 
   void Fix::request_symbol_info()
@@ -130,6 +385,7 @@ namespace Deribit
 
     message.setField(FIX::FIELD::SecurityReqID, request_id);
     message.setField(FIX::FIELD::SecurityListRequestType, "0");
+    this->m_instruments.clear();
 
     FIX::Session::sendToTarget(message, this->m_session_id);
     // printf("[%s][request_symbol_info] Sent security list request %s \n",
@@ -147,11 +403,35 @@ namespace Deribit
   void Fix::onLogon(const FIX::SessionID &session_id)
   {
     // printf("[%s][onLogon] Logged on\n", this->m_session_id.toString().c_str());
+
+    // Subscriptions end with the session, every one is sent again
+    {
+      std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+      this->m_subscriptions.renew();
+    }
+
+    // Whatever changed while we were logged out is lost. Books resubscribing
+    // from the handler only update their queued request
+    if (this->m_logons++ > 0 && this->m_resync_handler)
+      this->m_resync_handler();
+
+    {
+      std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+      this->m_logged_on = true;
+    }
+    this->m_subscriptions_changed.notify_one();
+
+    if (this->m_logon_handler)
+      this->m_logon_handler();
   }
 
   void Fix::onLogout(const FIX::SessionID &session_id)
   {
     // printf("[%s][onLogout] Logged out\n", this->m_session_id.toString().c_str());
+
+    // Requests wait for the next logon
+    std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+    this->m_logged_on = false;
   }
 
   void Fix::fromAdmin(const FIX::Message &message,
@@ -159,6 +439,12 @@ namespace Deribit
   {
     // printf("[%s][fromAdmin] Received %s\n", this->m_session_id.toString().c_str(),
     //        message.getHeader().getField(FIX::FIELD::MsgType).c_str());
+
+    // Market data skipped by a sequence reset is never delivered, gap fills
+    // included as only messages worth resending are resent
+    if (message.getHeader().getField(FIX::FIELD::MsgType) == FIX::MsgType_SequenceReset &&
+        this->m_resync_handler)
+      this->m_resync_handler();
   }
 
   void Fix::fromApp(const FIX::Message &message,
@@ -168,9 +454,78 @@ namespace Deribit
   {
     // printf("[%s][fromApp] Received %s\n", this->m_session_id.toString().c_str(),
     //        message.getHeader().getField(FIX::FIELD::MsgType).c_str());
+    if (this->on_raw_message(message))
+      return;
     crack(message, session_id);
   }
 
+  bool Fix::on_raw_message(FIX::Message const &message)
+  {
+    if (this->m_raw_message.empty())
+      return false;
+
+    std::string_view raw = this->m_raw_message;
+
+    // Messages QuickFIX queued while recovering a sequence gap never go through
+    // the log, make sure the tapped message is the one being delivered
+    auto const seq_num = FixScanner::find_field(raw, FIX::FIELD::MsgSeqNum);
+    if (seq_num != message.getHeader().getField(FIX::FIELD::MsgSeqNum))
+      return false;
+
+    std::string_view symbol;
+    if (FixScanner::message_type(raw) == "W")
+    {
+      BidAskSnapshot snapshot;
+      if (!FixScanner::decode_snapshot(raw, symbol, snapshot))
+        return false;
+      // Symbols are only looked up in the raw message, they are never copied
+      auto const id = this->resolve(symbol);
+      if (!id.has_value())
+        return true;
+
+      if (this->m_differential_decoding)
+      {
+        BidAskSnapshot expected;
+        decode(static_cast<FIX44::MarketDataSnapshotFullRefresh const &>(message), expected);
+        if (!FixScanner::same(snapshot, expected))
+        {
+          this->m_decode_mismatches++;
+          std::cerr << "Fast decoder mismatch on " << this->m_raw_message << std::endl;
+          snapshot = expected;
+        }
+      }
+
+      LatencyTrace::since(LatencyTrace::Stage::Decode, LatencyTrace::received());
+      if (this->m_bid_ask_snapshot_handler)
+        this->m_bid_ask_snapshot_handler(*id, snapshot);
+      return true;
+    }
+
+    BidAskDelta delta;
+    if (!FixScanner::decode_delta(raw, symbol, delta))
+      return false;
+    auto const id = this->resolve(symbol);
+    if (!id.has_value())
+      return true;
+
+    if (this->m_differential_decoding)
+    {
+      BidAskDelta expected;
+      decode(static_cast<FIX44::MarketDataIncrementalRefresh const &>(message), expected);
+      if (!FixScanner::same(delta, expected))
+      {
+        this->m_decode_mismatches++;
+        std::cerr << "Fast decoder mismatch on " << this->m_raw_message << std::endl;
+        delta = expected;
+      }
+    }
+
+    LatencyTrace::since(LatencyTrace::Stage::Decode, LatencyTrace::received());
+    if (this->m_bid_ask_delta_handler)
+      this->m_bid_ask_delta_handler(*id, delta);
+    return true;
+  }
+
   void Fix::toAdmin(FIX::Message &message, const FIX::SessionID &)
   {
     auto const &msg_type = message.getHeader().getField(FIX::FIELD::MsgType);
@@ -199,7 +554,7 @@ namespace Deribit
                     base_signature_string.size());
       SHA256_Final(hash, &sha256);
 
-      static std::string password_sha_base64 = Base64::encode(hash, sizeof(hash));
+      std::string password_sha_base64 = Base64::encode(hash, sizeof(hash));
 
       message.setField(FIX::HeartBtInt(20));
       message.setField(FIX::Username(username));
@@ -220,20 +575,34 @@ namespace Deribit
     //        message.getHeader().getField(FIX::FIELD::MsgType).c_str());
   }
 
-  void Fix::onMessage(FIX44::MarketDataSnapshotFullRefresh const &message, FIX::SessionID const &session_id)
+  namespace
+  {
+    // Numbers a message by the RptSeq (83) of its body or of an entry the way
+    // the raw decoder does, see `FixScanner::add_sequence`.
+    void add_sequence(FIX::FieldMap const &fields, uint64_t &first, uint64_t &last)
+    {
+      uint64_t rpt_seq = std::stoull(fields.getField(FIX::FIELD::RptSeq));
+      if (!FixScanner::add_sequence(rpt_seq, first, last))
+        throw std::runtime_error("RptSeq of the entries is not contiguous");
+    }
+  } // namespace
+
+  void Fix::decode(FIX44::MarketDataSnapshotFullRefresh const &message, BidAskSnapshot &snapshot)
   {
-    FIX::Symbol symbol;
     FIX::NoMDEntries no_md_entries;
     FIX44::MarketDataSnapshotFullRefresh::NoMDEntries entries_group;
 
-    message.get(symbol);
     message.get(no_md_entries);
-
-    BidAskSnapshot snapshot;
+    uint64_t first_sequence = 0;
+    uint64_t last_sequence = 0;
+    if (message.isSetField(FIX::FIELD::RptSeq))
+      add_sequence(message, first_sequence, last_sequence);
 
     for (size_t i = 0; i < no_md_entries; i++)
     {
       message.getGroup(i + 1, entries_group);
+      if (entries_group.isSetField(FIX::FIELD::RptSeq))
+        add_sequence(entries_group, first_sequence, last_sequence);
 
       FIX::MDEntryType md_entry_type; // 0=bid, 1=ask, 2=trade, 3=indexValue, 6=settlementPrice
       FIX::MDEntryPx md_entry_price;
@@ -251,28 +620,44 @@ namespace Deribit
       else if (md_entry_type == '1')
         snapshot.asks.push_back({md_entry_price, md_entry_size});
     }
+    snapshot.sequence = last_sequence;
+  }
+
+  void Fix::onMessage(FIX44::MarketDataSnapshotFullRefresh const &message, FIX::SessionID const &session_id)
+  {
+    std::string const &symbol = message.getField(FIX::FIELD::Symbol);
+    auto const id = this->resolve(symbol);
+    if (!id.has_value())
+      return;
+
+    BidAskSnapshot snapshot;
+    decode(message, snapshot);
 
     // printf("[%s][onMessage] Received order book snapshot for %s\n",
     //        session_id.toString().c_str(),
-    //        symbol.getString().c_str());
+    //        symbol.c_str());
 
+    LatencyTrace::since(LatencyTrace::Stage::Decode, LatencyTrace::received());
     if (this->m_bid_ask_snapshot_handler)
-      this->m_bid_ask_snapshot_handler(symbol, snapshot);
+      this->m_bid_ask_snapshot_handler(*id, snapshot);
   }
 
-  void Fix::onMessage(FIX44::MarketDataIncrementalRefresh const &message, FIX::SessionID const &session_id)
+  void Fix::decode(FIX44::MarketDataIncrementalRefresh const &message, BidAskDelta &delta)
   {
-    std::string symbol = message.getField(FIX::FIELD::Symbol);
     FIX::NoMDEntries no_md_entries;
     FIX44::MarketDataIncrementalRefresh::NoMDEntries entries_group;
 
     message.get(no_md_entries);
-
-    BidAskDelta delta;
+    uint64_t first_sequence = 0;
+    uint64_t last_sequence = 0;
+    if (message.isSetField(FIX::FIELD::RptSeq))
+      add_sequence(message, first_sequence, last_sequence);
 
     for (size_t i = 0; i < no_md_entries; i++)
     {
       message.getGroup(i + 1, entries_group);
+      if (entries_group.isSetField(FIX::FIELD::RptSeq))
+        add_sequence(entries_group, first_sequence, last_sequence);
 
       FIX::MDUpdateAction md_update_action; // 0=new, 1=change, 2=delete
       FIX::MDEntryType md_entry_type;       // 0=bid, 1=ask, 2=trade
@@ -281,12 +666,27 @@ namespace Deribit
 
       entries_group.get(md_update_action);
       entries_group.get(md_entry_type);
-      // Ignore other types of market data except for bid and ask
-      if (md_entry_type != '0' && md_entry_type != '1')
+      // Ignore other types of market data except for bid, ask and trade
+      if (md_entry_type != '0' && md_entry_type != '1' && md_entry_type != '2')
         continue;
       entries_group.get(md_entry_price);
       entries_group.get(md_entry_size);
 
+      if (md_entry_type == '2')
+      {
+        FIX::Side side;
+        Aggressor aggressor = Aggressor::Unknown;
+        if (entries_group.isSetField(side))
+        {
+          entries_group.get(side);
+          aggressor = side == FIX::Side_BUY    ? Aggressor::Buyer
+                      : side == FIX::Side_SELL ? Aggressor::Seller
+                                               : Aggressor::Unknown;
+        }
+        delta.trades.push_back({aggressor, {md_entry_price, md_entry_size}});
+        continue;
+      }
+
       OfferAction action;
       switch (md_update_action)
       {
@@ -308,12 +708,83 @@ namespace Deribit
       else if (md_entry_type == '1')
         delta.asks.push_back({action, {md_entry_price, md_entry_size}});
     }
+    delta.sequence = last_sequence;
+    delta.first_sequence = first_sequence != last_sequence ? first_sequence : 0;
+  }
+
+  void Fix::onMessage(FIX44::MarketDataIncrementalRefresh const &message, FIX::SessionID const &session_id)
+  {
+    std::string const &symbol = message.getField(FIX::FIELD::Symbol);
+    auto const id = this->resolve(symbol);
+    if (!id.has_value())
+      return;
+
+    BidAskDelta delta;
+    decode(message, delta);
 
     // printf("[%s][onMessage] Received order book delta for %s\n",
     //        session_id.toString().c_str(),
     //        symbol.c_str());
 
+    LatencyTrace::since(LatencyTrace::Stage::Decode, LatencyTrace::received());
     if (this->m_bid_ask_delta_handler)
-      this->m_bid_ask_delta_handler(symbol, delta);
+      this->m_bid_ask_delta_handler(*id, delta);
+  }
+
+  void Fix::onMessage(FIX44::MarketDataRequestReject const &message, FIX::SessionID const &session_id)
+  {
+    FIX::MDReqID request_id;
+    message.get(request_id);
+
+    std::string reason;
+    if (message.isSetField(FIX::FIELD::Text))
+      reason = message.getField(FIX::FIELD::Text);
+    else if (message.isSetField(FIX::FIELD::MDReqRejReason))
+      reason = "reason " + message.getField(FIX::FIELD::MDReqRejReason);
+
+    // Rejected books are forgotten, they would only be rejected again after a
+    // reconnect. Those subscribed to again since are kept
+    std::vector<std::string> rejected;
+    {
+      std::lock_guard<std::mutex> lock(this->m_subscriptions_mutex);
+      rejected = this->m_subscriptions.reject(request_id.getValue());
+    }
+
+    if (this->m_reject_handler)
+      for (auto const &symbol : rejected)
+        this->m_reject_handler(symbol, reason);
+  }
+
+  void Fix::onMessage(FIX44::SecurityList const &message, FIX::SessionID const &session_id)
+  {
+    FIX::NoRelatedSym no_related_sym;
+    FIX44::SecurityList::NoRelatedSym related_sym;
+
+    if (message.isSetField(no_related_sym))
+      message.get(no_related_sym);
+    for (size_t i = 0; i < no_related_sym; i++)
+    {
+      message.getGroup(i + 1, related_sym);
+
+      auto const field = [&related_sym](int tag)
+      { return related_sym.isSetField(tag) ? related_sym.getField(tag) : std::string(); };
+      auto const tick_size = field(FIX::FIELD::MinPriceIncrement);
+      this->m_instruments.push_back({
+          field(FIX::FIELD::Symbol),
+          field(FIX::FIELD::SecurityType),
+          field(FIX::FIELD::Currency),
+          field(FIX::FIELD::MaturityDate),
+          tick_size.empty() ? 0 : std::stod(tick_size),
+      });
+    }
+
+    // Long lists come in fragments, the last one completes the list
+    if (message.isSetField(FIX::FIELD::LastFragment) && message.getField(FIX::FIELD::LastFragment) == "N")
+      return;
+
+    auto instruments = std::move(this->m_instruments);
+    this->m_instruments.clear();
+    if (this->m_instruments_handler)
+      this->m_instruments_handler(instruments);
   }
 } // namespace Deribit
@@ -3,24 +3,113 @@
 
 #include <quickfix/Application.h>
 #include <quickfix/FileLog.h>
+#include <quickfix/Log.h>
 #include <quickfix/FileStore.h>
 #include <quickfix/Initiator.h>
 #include <quickfix/MessageCracker.h>
 #include <quickfix/Field.h>
 #include <sys/_types/_int64_t.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../symbol_table.h"
 #include "./datasource.h"
+#include "./journal.h"
+#include "./subscription_queue.h"
 
 namespace Deribit
 {
+  // Wraps another log factory and hands every raw inbound message to a callback
+  // before QuickFIX parses it, while still logging it through the wrapped log.
+  class TapLogFactory : public FIX::LogFactory
+  {
+  private:
+    class TapLog : public FIX::Log
+    {
+    private:
+      FIX::Log *m_log;
+      std::function<void(std::string const &)> const &m_tap;
+
+    public:
+      TapLog(FIX::Log *, std::function<void(std::string const &)> const &);
+
+      FIX::Log *log() const;
+
+      void clear() override;
+      void backup() override;
+      void onIncoming(std::string const &) override;
+      void onOutgoing(std::string const &) override;
+      void onEvent(std::string const &) override;
+    };
+
+    FIX::LogFactory &m_log_factory;
+    std::function<void(std::string const &)> m_tap;
+
+  public:
+    TapLogFactory(FIX::LogFactory &, std::function<void(std::string const &)>);
+
+    FIX::Log *create() override;
+    FIX::Log *create(FIX::SessionID const &) override;
+    void destroy(FIX::Log *) override;
+  };
+
+  // An instrument listed in a SecurityList (35=y).
+  typedef struct
+  {
+    std::string symbol;
+    // SecurityType (167), like FUT, OPT or SPOT
+    std::string kind;
+    // Currency (15)
+    std::string currency;
+    // MaturityDate (541) as YYYYMMDD, empty for perpetuals and spot
+    std::string expiry;
+    // MinPriceIncrement (969)
+    double tick_size;
+  } Instrument;
+
+  // Selects the instruments matching each of its fields which is not empty.
+  typedef struct
+  {
+    std::string currency;
+    std::string kind;
+    std::string expiry;
+  } InstrumentFilter;
+
+  bool matches(InstrumentFilter const &, Instrument const &);
+
   class Fix : public FIX::Application, public FIX::MessageCracker
   {
   private:
     // To identify the FIX session
     FIX::SessionID m_session_id;
 
-    // To identify each request sent from the client
-    int64_t m_request_id;
+    // To identify each request sent from the client, requests are sent from
+    // the request thread as well as the callers
+    std::atomic<int64_t> m_request_id;
+
+    // Subscriptions wait in `m_subscriptions` for the request thread, which
+    // packs them into requests of up to `MaxSymbolsPerRequest` symbols and
+    // sends at most `MaxRequestRate` messages a second. It only sends while
+    // logged on, every logon queues every subscription again.
+    std::mutex m_subscriptions_mutex;
+    std::condition_variable m_subscriptions_changed;
+    bool m_logged_on;
+    bool m_stopping;
+    SubscriptionQueue m_subscriptions;
+    double m_max_request_rate;
+    std::thread m_request_thread;
+
+    // Instruments of the SecurityList being received, it may come in several
+    // fragments
+    std::vector<Instrument> m_instruments;
 
     // To identify each order sent from the client
     // TODO: Perhaps need something truly random
@@ -30,12 +119,54 @@ namespace Deribit
     FIX::Initiator *m_initiator;
     std::unique_ptr<FIX::SessionSettings> m_settings;
     std::unique_ptr<FIX::SynchronizedApplication> m_synch;
-    std::unique_ptr<FIX::FileStoreFactory> m_store_factory;
-    std::unique_ptr<FIX::FileLogFactory> m_log_factory;
+    // Messages, logs and sequence numbers go through a background writer
+    // unless `AsyncStore=N`, in which case QuickFIX's file factories are used.
+    std::unique_ptr<Journal::Writer> m_journal_writer;
+    std::unique_ptr<FIX::MessageStoreFactory> m_store_factory;
+    std::unique_ptr<FIX::LogFactory> m_log_factory;
+    std::unique_ptr<TapLogFactory> m_tap_log_factory;
+
+    // Market data messages are decoded straight from the raw message captured
+    // by the log tap unless `FastDecoding=N`. With `DifferentialDecoding=Y`
+    // both decoders run and any mismatch is reported.
+    bool m_fast_decoding;
+    bool m_differential_decoding;
+    std::string m_raw_message;
+    uint64_t m_decode_mismatches;
+
+    // Number of times the session logged on, subscriptions have to be renewed
+    // on every logon after the first.
+    uint64_t m_logons;
+
+    // Market data is handed on keyed by the id of its symbol in this table,
+    // looked up straight from the message. Messages for symbols missing from
+    // it are dropped.
+    SymbolTable const *m_symbols;
 
     // Handler callbacks
-    std::function<void(std::string const &symbol, BidAskSnapshot const &)> m_bid_ask_snapshot_handler;
-    std::function<void(std::string const &symbol, BidAskDelta const &)> m_bid_ask_delta_handler;
+    std::function<void(SymbolId, BidAskSnapshot const &)> m_bid_ask_snapshot_handler;
+    std::function<void(SymbolId, BidAskDelta const &)> m_bid_ask_delta_handler;
+    std::function<void()> m_resync_handler;
+    std::function<void()> m_logon_handler;
+    std::function<void(std::string const &symbol, std::string const &reason)> m_reject_handler;
+    std::function<void(std::vector<Instrument> const &)> m_instruments_handler;
+
+    // Records how long a market data message took to reach us, from the
+    // exchange's timestamps in the raw message.
+    void trace_exchange_latency(std::string_view raw);
+
+    // Sends the queued subscriptions until stopped.
+    void send_requests();
+    void send_order_book_request(std::vector<std::string> const &symbols, Subscription,
+                                 std::string const &request_id);
+    void send_order_book_cancel(std::vector<std::string> const &symbols, std::string const &request_id);
+
+    // Id of `symbol` in the attached table.
+    std::optional<SymbolId> resolve(std::string_view symbol) const;
+
+    // Decodes and dispatches the message from its raw form, returns false if it
+    // has to go through the cracker instead.
+    bool on_raw_message(FIX::Message const &);
 
   public:
     const static DatasourceID datasource_id = DatasourceID::Deribit;
@@ -48,11 +179,42 @@ namespace Deribit
 
     /* Actions */
     void run() EXCEPT(std::runtime_error);
-    void attach_bid_ask_snapshot_handler(std::function<void(std::string const &symbol, BidAskSnapshot const &)>);
-    void attach_bid_ask_delta_handler(std::function<void(std::string const &symbol, BidAskDelta const &)>);
+    // Resolves the symbols of market data through `symbols`, which has to
+    // outlive the session. Symbols may be added to it while running.
+    void attach_symbols(SymbolTable const &symbols);
+    void attach_bid_ask_snapshot_handler(std::function<void(SymbolId, BidAskSnapshot const &)>);
+    void attach_bid_ask_delta_handler(std::function<void(SymbolId, BidAskDelta const &)>);
+    // Called when market data may have been lost for every subscription, after
+    // a reconnect or a sequence reset. Books have to be rebuilt from new
+    // snapshots as Deribit does not number its market data per instrument.
+    void attach_resync_handler(std::function<void()>);
+    // Called on every logon, once the subscriptions waiting for it were handed
+    // to the request thread.
+    void attach_logon_handler(std::function<void()>);
+    // Called when Deribit rejected the subscription to a book, which is then
+    // not sent again after a reconnect. A rejected request rejects every book
+    // it held.
+    void attach_reject_handler(std::function<void(std::string const &symbol, std::string const &reason)>);
     void request_test();
-    void request_order_book(std::string const &symbol);
+    // Subscribes to the book of `symbol`, replacing any earlier subscription
+    // to it so that a book can switch between full refreshes and incremental
+    // updates without receiving both. Before the session logged on the
+    // request is queued and sent on logon, so books can be subscribed to
+    // before `run`. Requests are sent from a thread of their own.
+    void request_order_book(std::string const &symbol, Subscription subscription = {});
+    // Subscribes to the books of `symbols` at once, they go out in as few
+    // requests as the limits allow.
+    void request_order_books(std::vector<std::string> const &symbols, Subscription subscription = {});
+    // Requests the list of instruments, which is handed to the instruments
+    // handler once complete.
     void request_symbol_info();
+    void attach_instruments_handler(std::function<void(std::vector<Instrument> const &)>);
+
+    // Whether the session is logged on, subscriptions are sent right away.
+    bool logged_on();
+
+    // Number of messages on which the fast and QuickFIX decoders disagreed.
+    uint64_t decode_mismatches() const;
 
     /* Implementing Application interface */
     void onCreate(FIX::SessionID const &) override;
@@ -68,9 +230,15 @@ namespace Deribit
         EXCEPT(FieldNotFound, IncorrectDataFormat,
                IncorrectTagValue, UnsupportedMessageType) override;
 
+    /* Decoding market data through QuickFIX */
+    static void decode(FIX44::MarketDataSnapshotFullRefresh const &, BidAskSnapshot &);
+    static void decode(FIX44::MarketDataIncrementalRefresh const &, BidAskDelta &);
+
     /* Implementing MessageCracker interface */
     virtual void onMessage(FIX44::MarketDataSnapshotFullRefresh const &, FIX::SessionID const &) override;
     virtual void onMessage(FIX44::MarketDataIncrementalRefresh const &, FIX::SessionID const &) override;
+    virtual void onMessage(FIX44::MarketDataRequestReject const &, FIX::SessionID const &) override;
+    virtual void onMessage(FIX44::SecurityList const &, FIX::SessionID const &) override;
 
     // // Following are the custom fields that Deribit uses, these can be found in their FIX documentation.
     // // https://docs.deribit.com/#market-data-request-v
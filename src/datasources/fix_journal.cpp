@@ -0,0 +1,190 @@
+#include "fix_journal.h"
+
+#include <chrono>
+#include <ctime>
+
+namespace FixJournal
+{
+  namespace
+  {
+    // Files of a session are named like those of QuickFIX's file store.
+    std::string session_prefix(std::string const &directory, FIX::SessionID const &session_id)
+    {
+      std::string prefix = session_id.getBeginString().getValue() + "-" +
+                           session_id.getSenderCompID().getValue() + "-" +
+                           session_id.getTargetCompID().getValue();
+      if (!session_id.getSessionQualifier().empty())
+        prefix += "-" + session_id.getSessionQualifier();
+      return directory + "/" + prefix;
+    }
+
+    int64_t seconds_since_epoch()
+    {
+      return std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+  } // namespace
+
+  Store::Store(Journal::Writer &writer, std::string const &prefix)
+      : m_writer(writer), m_path(prefix + ".journal"), m_journal(nullptr),
+        m_sequences(prefix + ".seqnums"), m_messages()
+  {
+    load();
+    this->m_journal = this->m_writer.open(this->m_path);
+  }
+
+  void Store::load()
+  {
+    // The journal is truncated on every reset so it only holds messages of
+    // the current session
+    this->m_messages.clear();
+    Journal::Reader reader(this->m_path);
+    Journal::Record record;
+    while (reader.next(record))
+      if (record.kind == Journal::RecordKind::Stored)
+        this->m_messages[record.sequence] = std::string(record.data);
+  }
+
+  bool Store::set(int sequence, std::string const &message) EXCEPT(FIX::IOException)
+  {
+    this->m_messages[sequence] = message;
+    this->m_writer.append(this->m_journal, Journal::RecordKind::Stored, sequence, message);
+    return true;
+  }
+
+  void Store::get(int begin, int end, std::vector<std::string> &messages) const EXCEPT(FIX::IOException)
+  {
+    messages.clear();
+    for (auto it = this->m_messages.lower_bound(begin);
+         it != this->m_messages.end() && it->first <= end; it++)
+      messages.push_back(it->second);
+  }
+
+  int Store::getNextSenderMsgSeqNum() const EXCEPT(FIX::IOException)
+  {
+    return this->m_sequences.next_sender();
+  }
+
+  int Store::getNextTargetMsgSeqNum() const EXCEPT(FIX::IOException)
+  {
+    return this->m_sequences.next_target();
+  }
+
+  void Store::setNextSenderMsgSeqNum(int sequence) EXCEPT(FIX::IOException)
+  {
+    this->m_sequences.set_next_sender(sequence);
+  }
+
+  void Store::setNextTargetMsgSeqNum(int sequence) EXCEPT(FIX::IOException)
+  {
+    this->m_sequences.set_next_target(sequence);
+  }
+
+  void Store::incrNextSenderMsgSeqNum() EXCEPT(FIX::IOException)
+  {
+    this->m_sequences.set_next_sender(this->m_sequences.next_sender() + 1);
+  }
+
+  void Store::incrNextTargetMsgSeqNum() EXCEPT(FIX::IOException)
+  {
+    this->m_sequences.set_next_target(this->m_sequences.next_target() + 1);
+  }
+
+  FIX::UtcTimeStamp Store::getCreationTime() const EXCEPT(FIX::IOException)
+  {
+    return FIX::UtcTimeStamp(static_cast<time_t>(this->m_sequences.creation_time()));
+  }
+
+  void Store::reset() EXCEPT(FIX::IOException)
+  {
+    this->m_messages.clear();
+    this->m_writer.truncate(this->m_journal);
+    this->m_sequences.reset(seconds_since_epoch());
+  }
+
+  void Store::refresh() EXCEPT(FIX::IOException)
+  {
+    // Sequence numbers are read straight from the mapping, only the messages
+    // have to be read back once everything queued is written
+    try
+    {
+      this->m_writer.flush();
+      load();
+    }
+    catch (std::exception const &exception)
+    {
+      throw FIX::IOException(exception.what());
+    }
+  }
+
+  StoreFactory::StoreFactory(FIX::SessionSettings const &settings, Journal::Writer &writer)
+      : m_settings(settings), m_writer(writer) {}
+
+  FIX::MessageStore *StoreFactory::create(FIX::SessionID const &session_id)
+  {
+    auto const &settings = this->m_settings.get(session_id);
+    try
+    {
+      return new Store(this->m_writer,
+                       session_prefix(settings.getString(FIX::FILE_STORE_PATH), session_id));
+    }
+    catch (std::exception const &exception)
+    {
+      throw FIX::ConfigError(exception.what());
+    }
+  }
+
+  void StoreFactory::destroy(FIX::MessageStore *store)
+  {
+    delete store;
+  }
+
+  Log::Log(Journal::Writer &writer, std::string const &prefix)
+      : m_writer(writer), m_file(writer.open(prefix + ".log")) {}
+
+  void Log::clear()
+  {
+    this->m_writer.truncate(this->m_file);
+  }
+
+  void Log::backup()
+  {
+    this->m_writer.backup(this->m_file);
+  }
+
+  void Log::onIncoming(std::string const &message)
+  {
+    this->m_writer.append(this->m_file, Journal::RecordKind::Incoming, 0, message);
+  }
+
+  void Log::onOutgoing(std::string const &message)
+  {
+    this->m_writer.append(this->m_file, Journal::RecordKind::Outgoing, 0, message);
+  }
+
+  void Log::onEvent(std::string const &event)
+  {
+    this->m_writer.append(this->m_file, Journal::RecordKind::Event, 0, event);
+  }
+
+  LogFactory::LogFactory(FIX::SessionSettings const &settings, Journal::Writer &writer)
+      : m_settings(settings), m_writer(writer) {}
+
+  FIX::Log *LogFactory::create()
+  {
+    return new Log(this->m_writer, this->m_settings.get().getString(FIX::FILE_LOG_PATH) + "/GLOBAL");
+  }
+
+  FIX::Log *LogFactory::create(FIX::SessionID const &session_id)
+  {
+    auto const &settings = this->m_settings.get(session_id);
+    return new Log(this->m_writer,
+                   session_prefix(settings.getString(FIX::FILE_LOG_PATH), session_id));
+  }
+
+  void LogFactory::destroy(FIX::Log *log)
+  {
+    delete log;
+  }
+} // namespace FixJournal
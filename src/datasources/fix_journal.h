@@ -0,0 +1,101 @@
+#ifndef fix_journal
+#define fix_journal
+
+#include <quickfix/Log.h>
+#include <quickfix/MessageStore.h>
+#include <quickfix/SessionSettings.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./journal.h"
+
+// QuickFIX message stores and logs backed by journals, in place of
+// `FIX::FileStoreFactory` and `FIX::FileLogFactory` which write every message
+// as text on the thread that receives it.
+//
+// Both read the same `FileStorePath` and `FileLogPath` settings as the file
+// based factories. Writes go through a `Journal::Writer` shared by every
+// session, only the sequence numbers are updated in place.
+namespace FixJournal
+{
+  // Keeps the messages sent in a session for resending, in memory and in
+  // `<prefix>.journal`, and the sequence numbers in `<prefix>.seqnums`.
+  class Store : public FIX::MessageStore
+  {
+  private:
+    Journal::Writer &m_writer;
+    std::string m_path;
+    Journal::File *m_journal;
+    Journal::Sequences m_sequences;
+    std::map<int, std::string> m_messages;
+
+    void load();
+
+  public:
+    Store(Journal::Writer &, std::string const &prefix);
+
+    bool set(int, std::string const &) EXCEPT(FIX::IOException) override;
+    void get(int, int, std::vector<std::string> &) const EXCEPT(FIX::IOException) override;
+
+    int getNextSenderMsgSeqNum() const EXCEPT(FIX::IOException) override;
+    int getNextTargetMsgSeqNum() const EXCEPT(FIX::IOException) override;
+    void setNextSenderMsgSeqNum(int) EXCEPT(FIX::IOException) override;
+    void setNextTargetMsgSeqNum(int) EXCEPT(FIX::IOException) override;
+    void incrNextSenderMsgSeqNum() EXCEPT(FIX::IOException) override;
+    void incrNextTargetMsgSeqNum() EXCEPT(FIX::IOException) override;
+
+    FIX::UtcTimeStamp getCreationTime() const EXCEPT(FIX::IOException) override;
+
+    void reset() EXCEPT(FIX::IOException) override;
+    void refresh() EXCEPT(FIX::IOException) override;
+  };
+
+  class StoreFactory : public FIX::MessageStoreFactory
+  {
+  private:
+    FIX::SessionSettings m_settings;
+    Journal::Writer &m_writer;
+
+  public:
+    StoreFactory(FIX::SessionSettings const &, Journal::Writer &);
+
+    FIX::MessageStore *create(FIX::SessionID const &) override;
+    void destroy(FIX::MessageStore *) override;
+  };
+
+  // Appends everything logged to `<prefix>.log`, see `Journal::RecordKind`
+  // for how incoming and outgoing messages and events are told apart.
+  class Log : public FIX::Log
+  {
+  private:
+    Journal::Writer &m_writer;
+    Journal::File *m_file;
+
+  public:
+    Log(Journal::Writer &, std::string const &prefix);
+
+    void clear() override;
+    void backup() override;
+    void onIncoming(std::string const &) override;
+    void onOutgoing(std::string const &) override;
+    void onEvent(std::string const &) override;
+  };
+
+  class LogFactory : public FIX::LogFactory
+  {
+  private:
+    FIX::SessionSettings m_settings;
+    Journal::Writer &m_writer;
+
+  public:
+    LogFactory(FIX::SessionSettings const &, Journal::Writer &);
+
+    FIX::Log *create() override;
+    FIX::Log *create(FIX::SessionID const &) override;
+    void destroy(FIX::Log *) override;
+  };
+} // namespace FixJournal
+
+#endif // fix_journal
@@ -0,0 +1,656 @@
+#include "fix_scanner.h"
+
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace FixScanner
+{
+  namespace
+  {
+    // Largest number of integer digits that fits the fixed point range.
+    constexpr size_t MAX_INTEGER_DIGITS = 10;
+    constexpr size_t MAX_DECIMALS = 8;
+
+    // Size of the blocks the SOH scan works on.
+    constexpr size_t BLOCK_SIZE = 64;
+
+    // Returns a mask with a bit set for every SOH in the 64 bytes at `block`.
+    uint64_t soh_mask(char const *block)
+    {
+#if defined(__AVX2__)
+      __m256i const soh = _mm256_set1_epi8(SOH);
+      uint32_t lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<__m256i const *>(block)), soh));
+      uint32_t hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<__m256i const *>(block + 32)), soh));
+      return uint64_t(hi) << 32 | lo;
+#elif defined(__SSE2__)
+      __m128i const soh = _mm_set1_epi8(SOH);
+      uint64_t mask = 0;
+      for (size_t i = 0; i < BLOCK_SIZE; i += 16)
+      {
+        uint32_t bits = _mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(block + i)), soh));
+        mask |= uint64_t(bits) << i;
+      }
+      return mask;
+#else
+      uint64_t mask = 0;
+      for (size_t i = 0; i < BLOCK_SIZE; i++)
+        mask |= uint64_t(block[i] == SOH) << i;
+      return mask;
+#endif
+    }
+
+    // Walks the fields of a raw message. SOHs are located a whole 64 byte block
+    // at a time, so a block of short repeating group fields costs one vector
+    // compare and a bit scan per field.
+    class FieldCursor
+    {
+    private:
+      std::string_view m_raw;
+      size_t m_pos;
+      // Start of the block `m_mask` covers, the mask only holds the SOHs in
+      // that block which have not been consumed yet.
+      size_t m_block;
+      uint64_t m_mask;
+
+      void load(size_t block)
+      {
+        m_block = block;
+        if (block + BLOCK_SIZE <= m_raw.size())
+        {
+          m_mask = soh_mask(m_raw.data() + block);
+          return;
+        }
+        m_mask = 0;
+        for (size_t i = block; i < m_raw.size(); i++)
+          m_mask |= uint64_t(m_raw[i] == SOH) << (i - block);
+      }
+
+      size_t next_soh(size_t from)
+      {
+        while (m_block < m_raw.size())
+        {
+          if (from < m_block + BLOCK_SIZE)
+          {
+            // `from` is before the block once the scan moved past its own
+            size_t skip = from > m_block ? from - m_block : 0;
+            uint64_t mask = m_mask & (~uint64_t(0) << skip);
+            if (mask != 0)
+              return m_block + std::countr_zero(mask);
+          }
+          load(m_block + BLOCK_SIZE);
+        }
+        return m_raw.size();
+      }
+
+    public:
+      FieldCursor(std::string_view raw) : m_raw(raw), m_pos(0)
+      {
+        load(0);
+      }
+
+      // Reads the next field, returns false at the end of the buffer or on a
+      // malformed field.
+      bool next(int &tag, std::string_view &value)
+      {
+        if (m_pos >= m_raw.size())
+          return false;
+
+        tag = 0;
+        while (m_pos < m_raw.size() && m_raw[m_pos] != '=')
+        {
+          char c = m_raw[m_pos++];
+          if (c < '0' || c > '9')
+            return false;
+          tag = tag * 10 + (c - '0');
+        }
+        if (m_pos == m_raw.size())
+          return false;
+        m_pos++;
+
+        size_t end = next_soh(m_pos);
+        value = m_raw.substr(m_pos, end - m_pos);
+        m_pos = end + 1;
+        return true;
+      }
+    };
+
+#if defined(__SSE4_1__)
+    // Shuffles moving the integer digits before a decimal point at index `d` to
+    // the end of the first 8 bytes and the decimals to the start of the last 8,
+    // indices with the top bit set produce zeros.
+    struct DigitShuffles
+    {
+      alignas(16) int8_t table[9][16];
+
+      constexpr DigitShuffles() : table()
+      {
+        for (int d = 0; d <= 8; d++)
+          for (int j = 0; j < 16; j++)
+          {
+            int source = j < 8 ? j - (8 - d) : d + 1 + (j - 8);
+            table[d][j] = source < 0 || source > 15 ? int8_t(0x80) : int8_t(source);
+          }
+      }
+    };
+    constexpr DigitShuffles DIGIT_SHUFFLES;
+
+    // Parses values of up to 16 characters with at most 8 integer digits and
+    // 8 decimals in a single 16 byte register, anything else is left to the
+    // scalar parser. Reads up to 16 bytes from the start of the value, which
+    // stays within the page the value starts in.
+    __attribute__((no_sanitize("address")))
+    std::optional<int64_t> parse_fixed_simd(std::string_view value)
+    {
+      constexpr uintptr_t PAGE_SIZE = 4096;
+      size_t length = value.size();
+      if (length == 0 || length > 16)
+        return std::nullopt;
+
+      __m128i raw;
+      if ((reinterpret_cast<uintptr_t>(value.data()) & (PAGE_SIZE - 1)) <= PAGE_SIZE - 16)
+      {
+        raw = _mm_loadu_si128(reinterpret_cast<__m128i const *>(value.data()));
+      }
+      else
+      {
+        alignas(16) char buffer[16] = {};
+        std::memcpy(buffer, value.data(), length);
+        raw = _mm_load_si128(reinterpret_cast<__m128i const *>(buffer));
+      }
+
+      __m128i const iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+      __m128i const inside = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(length)), iota);
+      uint32_t inside_mask = _mm_movemask_epi8(inside);
+
+      uint32_t dots = _mm_movemask_epi8(_mm_cmpeq_epi8(raw, _mm_set1_epi8('.'))) & inside_mask;
+      size_t dot = dots == 0 ? length : std::countr_zero(dots);
+      size_t decimals = dots == 0 ? 0 : length - dot - 1;
+      if (dot > 8 || decimals > 8 || dot + decimals == 0)
+        return std::nullopt;
+
+      // Everything but the decimal point has to be a digit
+      __m128i digits = _mm_and_si128(_mm_sub_epi8(raw, _mm_set1_epi8('0')), inside);
+      __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+      if ((_mm_movemask_epi8(valid) | (dots & -dots)) != 0xFFFF)
+        return std::nullopt;
+
+      __m128i v = _mm_shuffle_epi8(
+          digits, _mm_load_si128(reinterpret_cast<__m128i const *>(DIGIT_SHUFFLES.table[dot])));
+
+      // Combine pairs of digits, then pairs of pairs and so on
+      v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                             10, 1, 10, 1, 10, 1, 10, 1));
+      v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+      v = _mm_packus_epi32(v, v);
+      v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+      int64_t integer = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+      int64_t fraction = static_cast<uint32_t>(_mm_extract_epi32(v, 1));
+      return integer * FIXED_SCALE + fraction;
+    }
+#endif
+
+    // An entry of the NoMDEntries group being decoded.
+    typedef struct
+    {
+      char action;
+      char type;
+      // Side (54) of a trade.
+      char side;
+      std::optional<int64_t> price;
+      std::optional<int64_t> size;
+    } Entry;
+
+    bool parse_field(std::string_view value, std::optional<int64_t> &field)
+    {
+      field = parse_fixed(value);
+      return field.has_value();
+    }
+
+    bool parse_sequence(std::string_view value, uint64_t &first, uint64_t &last)
+    {
+      uint64_t rpt_seq;
+      auto const result = std::from_chars(value.data(), value.data() + value.size(), rpt_seq);
+      return result.ec == std::errc() && result.ptr == value.data() + value.size() &&
+             add_sequence(rpt_seq, first, last);
+    }
+
+    int64_t to_fixed(double value)
+    {
+      return std::llround(value * FIXED_SCALE);
+    }
+
+    bool same(Offer const &a, Offer const &b)
+    {
+      return to_fixed(a.price) == to_fixed(b.price) &&
+             to_fixed(a.quantity) == to_fixed(b.quantity);
+    }
+  } // namespace
+
+  bool add_sequence(uint64_t rpt_seq, uint64_t &first, uint64_t &last)
+  {
+    if (last == 0)
+    {
+      first = rpt_seq;
+      last = rpt_seq;
+      return true;
+    }
+    if (rpt_seq != last + 1)
+      return false;
+    last = rpt_seq;
+    return true;
+  }
+
+  std::optional<int64_t> parse_fixed(std::string_view value)
+  {
+#if defined(__SSE4_1__)
+    if (auto fixed = parse_fixed_simd(value); fixed.has_value())
+      return fixed;
+#endif
+    return parse_fixed_scalar(value);
+  }
+
+  std::optional<int64_t> parse_fixed_scalar(std::string_view value)
+  {
+    size_t i = 0;
+    bool negative = false;
+    if (i < value.size() && value[i] == '-')
+    {
+      negative = true;
+      i++;
+    }
+
+    int64_t integer = 0;
+    size_t integer_digits = 0;
+    for (; i < value.size() && value[i] != '.'; i++, integer_digits++)
+    {
+      char c = value[i];
+      if (c < '0' || c > '9' || integer_digits == MAX_INTEGER_DIGITS)
+        return std::nullopt;
+      integer = integer * 10 + (c - '0');
+    }
+
+    int64_t fraction = 0;
+    size_t decimals = 0;
+    if (i < value.size())
+    {
+      // Skip the decimal point
+      for (i++; i < value.size(); i++)
+      {
+        char c = value[i];
+        if (c < '0' || c > '9')
+          return std::nullopt;
+        if (decimals == MAX_DECIMALS)
+        {
+          // Only trailing zeros are allowed past the precision we keep
+          if (c != '0')
+            return std::nullopt;
+          continue;
+        }
+        fraction = fraction * 10 + (c - '0');
+        decimals++;
+      }
+    }
+
+    if (integer_digits == 0 && decimals == 0)
+      return std::nullopt;
+
+    for (; decimals < MAX_DECIMALS; decimals++)
+      fraction *= 10;
+
+    int64_t fixed = integer * FIXED_SCALE + fraction;
+    return negative ? -fixed : fixed;
+  }
+
+  double to_double(int64_t fixed)
+  {
+    // Below 2^53, about 9e7 once scaled, both operands are exact so this is the
+    // correctly rounded decimal value, the same double a correctly rounding
+    // string conversion gives
+    constexpr int64_t EXACT_LIMIT = int64_t(1) << 53;
+    if (fixed > -EXACT_LIMIT && fixed < EXACT_LIMIT)
+      return static_cast<double>(fixed) / FIXED_SCALE;
+
+    // Larger values are converted from their decimal form
+    char buffer[32];
+    char *end = buffer;
+    if (fixed < 0)
+      *end++ = '-';
+    uint64_t magnitude = fixed < 0 ? 0 - static_cast<uint64_t>(fixed) : fixed;
+    end = std::to_chars(end, buffer + sizeof(buffer), magnitude / FIXED_SCALE).ptr;
+    *end++ = '.';
+    uint64_t fraction = magnitude % FIXED_SCALE;
+    for (size_t i = MAX_DECIMALS; i > 0; i--, fraction /= 10)
+      end[i - 1] = '0' + fraction % 10;
+    end += MAX_DECIMALS;
+
+    double value = 0;
+    std::from_chars(buffer, end, value);
+    return value;
+  }
+
+  std::optional<int64_t> parse_timestamp(std::string_view value)
+  {
+    // Fixed width digits starting at `pos`, -1 if any of them is not a digit
+    auto digits = [value](size_t pos, size_t count) -> int
+    {
+      int number = 0;
+      for (size_t i = pos; i < pos + count; i++)
+      {
+        if (value[i] < '0' || value[i] > '9')
+          return -1;
+        number = number * 10 + (value[i] - '0');
+      }
+      return number;
+    };
+
+    constexpr size_t SECONDS_END = 17;
+    if (value.size() < SECONDS_END || value[8] != '-' || value[11] != ':' ||
+        value[14] != ':')
+      return std::nullopt;
+
+    int year = digits(0, 4), month = digits(4, 2), day = digits(6, 2);
+    int hours = digits(9, 2), minutes = digits(12, 2), seconds = digits(15, 2);
+    if (year < 0 || month < 0 || day < 0 || hours < 0 || minutes < 0 || seconds < 0)
+      return std::nullopt;
+
+    std::chrono::year_month_day date{std::chrono::year(year),
+                                     std::chrono::month(month),
+                                     std::chrono::day(day)};
+    if (!date.ok() || hours > 23 || minutes > 59 || seconds > 60)
+      return std::nullopt;
+
+    int64_t nanoseconds = 0;
+    size_t decimals = 0;
+    if (value.size() > SECONDS_END)
+    {
+      if (value[SECONDS_END] != '.' || value.size() == SECONDS_END + 1 ||
+          value.size() > SECONDS_END + 10)
+        return std::nullopt;
+      for (size_t i = SECONDS_END + 1; i < value.size(); i++, decimals++)
+      {
+        int digit = digits(i, 1);
+        if (digit < 0)
+          return std::nullopt;
+        nanoseconds = nanoseconds * 10 + digit;
+      }
+    }
+    for (; decimals < 9; decimals++)
+      nanoseconds *= 10;
+
+    auto time = std::chrono::sys_days(date) + std::chrono::hours(hours) +
+                std::chrono::minutes(minutes) + std::chrono::seconds(seconds);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count() +
+           nanoseconds;
+  }
+
+  size_t find_soh(std::string_view raw, size_t pos)
+  {
+    for (; pos + BLOCK_SIZE <= raw.size(); pos += BLOCK_SIZE)
+      if (uint64_t mask = soh_mask(raw.data() + pos); mask != 0)
+        return pos + std::countr_zero(mask);
+    return find_soh_scalar(raw, pos);
+  }
+
+  size_t find_soh_scalar(std::string_view raw, size_t pos)
+  {
+    for (; pos < raw.size(); pos++)
+      if (raw[pos] == SOH)
+        return pos;
+    return raw.size();
+  }
+
+  std::optional<std::string_view> find_field(std::string_view raw, int tag)
+  {
+    FieldCursor cursor(raw);
+    int field_tag;
+    std::string_view value;
+    while (cursor.next(field_tag, value))
+      if (field_tag == tag)
+        return value;
+    return std::nullopt;
+  }
+
+  std::optional<std::string_view> message_type(std::string_view raw)
+  {
+    // MsgType is the third field of every message
+    FieldCursor cursor(raw);
+    int tag;
+    std::string_view value;
+    for (int i = 0; i < 3; i++)
+      if (!cursor.next(tag, value))
+        return std::nullopt;
+    if (tag != 35)
+      return std::nullopt;
+    return value;
+  }
+
+  bool decode_snapshot(std::string_view raw, std::string_view &symbol,
+                       BidAskSnapshot &snapshot)
+  {
+    if (message_type(raw) != "W")
+      return false;
+
+    bool has_symbol = false;
+    uint64_t first_sequence = 0;
+    uint64_t last_sequence = 0;
+    bool in_group = false;
+    Entry entry = {};
+
+    auto flush = [&]()
+    {
+      if (entry.type != '0' && entry.type != '1')
+        return true;
+      if (!entry.price.has_value() || !entry.size.has_value())
+        return false;
+
+      Offer offer = {to_double(*entry.price), to_double(*entry.size)};
+      if (entry.type == '0')
+        snapshot.bids.push_back(offer);
+      else
+        snapshot.asks.push_back(offer);
+      return true;
+    };
+
+    FieldCursor cursor(raw);
+    int tag;
+    std::string_view value;
+    while (cursor.next(tag, value))
+    {
+      switch (tag)
+      {
+      case 55: // Symbol
+        if (!in_group)
+        {
+          symbol = value;
+          has_symbol = true;
+        }
+        break;
+      case 268: // NoMDEntries
+        in_group = true;
+        break;
+      case 269: // MDEntryType, first field of every entry
+        if (!in_group || value.size() != 1 || !flush())
+          return false;
+        entry = {.action = 0, .type = value[0], .side = 0, .price = {}, .size = {}};
+        break;
+      case 270: // MDEntryPx
+        if (in_group && !parse_field(value, entry.price))
+          return false;
+        break;
+      case 271: // MDEntrySize
+        if (in_group && !parse_field(value, entry.size))
+          return false;
+        break;
+      case 83: // RptSeq
+        if (!parse_sequence(value, first_sequence, last_sequence))
+          return false;
+        break;
+      }
+    }
+
+    snapshot.sequence = last_sequence;
+    return has_symbol && flush();
+  }
+
+  bool decode_delta(std::string_view raw, std::string_view &symbol,
+                    BidAskDelta &delta)
+  {
+    if (message_type(raw) != "X")
+      return false;
+
+    bool has_symbol = false;
+    uint64_t first_sequence = 0;
+    uint64_t last_sequence = 0;
+    bool in_group = false;
+    bool in_entry = false;
+    Entry entry = {};
+
+    auto flush = [&]()
+    {
+      if (!in_entry)
+        return true;
+      // MDEntryType is required to tell bids from asks
+      if (entry.type == 0)
+        return false;
+      if (entry.type != '0' && entry.type != '1' && entry.type != '2')
+        return true;
+      if (!entry.price.has_value() || !entry.size.has_value())
+        return false;
+
+      if (entry.type == '2')
+      {
+        Aggressor aggressor = entry.side == '1'   ? Aggressor::Buyer
+                              : entry.side == '2' ? Aggressor::Seller
+                                                  : Aggressor::Unknown;
+        delta.trades.push_back(
+            {aggressor, {to_double(*entry.price), to_double(*entry.size)}});
+        return true;
+      }
+
+      OfferAction action;
+      switch (entry.action)
+      {
+      case '0':
+        action = OfferAction::Add;
+        break;
+      case '1':
+        action = OfferAction::Update;
+        break;
+      case '2':
+        action = OfferAction::Remove;
+        break;
+      default:
+        return false;
+      }
+
+      OfferChange change = {
+          action, {to_double(*entry.price), to_double(*entry.size)}};
+      if (entry.type == '0')
+        delta.bids.push_back(change);
+      else
+        delta.asks.push_back(change);
+      return true;
+    };
+
+    FieldCursor cursor(raw);
+    int tag;
+    std::string_view value;
+    while (cursor.next(tag, value))
+    {
+      switch (tag)
+      {
+      case 55: // Symbol
+        if (!in_group)
+        {
+          symbol = value;
+          has_symbol = true;
+        }
+        break;
+      case 268: // NoMDEntries
+        in_group = true;
+        break;
+      case 279: // MDUpdateAction, first field of every entry
+        if (!in_group || value.size() != 1 || !flush())
+          return false;
+        entry = {.action = value[0], .type = 0, .side = 0, .price = {}, .size = {}};
+        in_entry = true;
+        break;
+      case 269: // MDEntryType
+        if (in_entry && value.size() == 1)
+          entry.type = value[0];
+        break;
+      case 270: // MDEntryPx
+        if (in_entry && !parse_field(value, entry.price))
+          return false;
+        break;
+      case 271: // MDEntrySize
+        if (in_entry && !parse_field(value, entry.size))
+          return false;
+        break;
+      case 54: // Side
+        if (in_entry && value.size() == 1)
+          entry.side = value[0];
+        break;
+      case 83: // RptSeq
+        if (!parse_sequence(value, first_sequence, last_sequence))
+          return false;
+        break;
+      }
+    }
+
+    delta.sequence = last_sequence;
+    delta.first_sequence = first_sequence != last_sequence ? first_sequence : 0;
+    return has_symbol && flush();
+  }
+
+  bool same(BidAskSnapshot const &a, BidAskSnapshot const &b)
+  {
+    if (a.sequence != b.sequence)
+      return false;
+    if (a.bids.size() != b.bids.size() || a.asks.size() != b.asks.size())
+      return false;
+    for (size_t i = 0; i < a.bids.size(); i++)
+      if (!same(a.bids[i], b.bids[i]))
+        return false;
+    for (size_t i = 0; i < a.asks.size(); i++)
+      if (!same(a.asks[i], b.asks[i]))
+        return false;
+    return true;
+  }
+
+  bool same(BidAskDelta const &a, BidAskDelta const &b)
+  {
+    if (a.sequence != b.sequence || a.first_sequence != b.first_sequence)
+      return false;
+    if (a.bids.size() != b.bids.size() || a.asks.size() != b.asks.size())
+      return false;
+    for (size_t i = 0; i < a.bids.size(); i++)
+      if (a.bids[i].action != b.bids[i].action ||
+          !same(a.bids[i].offer, b.bids[i].offer))
+        return false;
+    for (size_t i = 0; i < a.asks.size(); i++)
+      if (a.asks[i].action != b.asks[i].action ||
+          !same(a.asks[i].offer, b.asks[i].offer))
+        return false;
+    if (a.trades.size() != b.trades.size())
+      return false;
+    for (size_t i = 0; i < a.trades.size(); i++)
+      if (a.trades[i].aggressor != b.trades[i].aggressor ||
+          !same(a.trades[i].offer, b.trades[i].offer))
+        return false;
+    return true;
+  }
+} // namespace FixScanner
@@ -0,0 +1,73 @@
+#ifndef fix_scanner
+#define fix_scanner
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "./datasource.h"
+
+// A decoder for market data messages which scans the raw tag=value buffer once
+// instead of going through QuickFIX's field maps and repeating group copies.
+// Only the fields the order book needs are looked at, everything else is
+// skipped.
+namespace FixScanner
+{
+  // Prices and sizes are parsed into integers with 8 decimal places.
+  constexpr int64_t FIXED_SCALE = 100000000;
+
+  // Field separator of the tag=value encoding.
+  constexpr char SOH = '\x01';
+
+  // Parses a decimal FIX value into a fixed point integer, returns nothing if it
+  // is malformed or has more than 8 decimal places. Uses SSE4.1 when the build
+  // targets it and falls back to `parse_fixed_scalar` otherwise.
+  std::optional<int64_t> parse_fixed(std::string_view value);
+  std::optional<int64_t> parse_fixed_scalar(std::string_view value);
+  // Converts a fixed point value into the double nearest to its decimal value.
+  double to_double(int64_t fixed);
+
+  // Parses a UTCTIMESTAMP (YYYYMMDD-HH:MM:SS with up to 9 fractional digits)
+  // into nanoseconds since the epoch.
+  std::optional<int64_t> parse_timestamp(std::string_view value);
+
+  // Returns the position of the first SOH at or after `pos`, or the size of the
+  // buffer if there is none.
+  size_t find_soh(std::string_view raw, size_t pos);
+  size_t find_soh_scalar(std::string_view raw, size_t pos);
+
+  // Returns the value of the first occurence of `tag`, the buffer must start at
+  // a field boundary.
+  std::optional<std::string_view> find_field(std::string_view raw, int tag);
+
+  // Returns the MsgType (35) of a raw message.
+  std::optional<std::string_view> message_type(std::string_view raw);
+
+  // Numbers a message by the RptSeq (83) fields it carries, on the body or on
+  // each of its entries: `first` and `last` become the first and the last of
+  // them. Returns false if `rpt_seq` does not follow `last`, the entries of a
+  // message are numbered one after the other. Both decoders go through this
+  // so that they hand the same sequences on.
+  bool add_sequence(uint64_t rpt_seq, uint64_t &first, uint64_t &last);
+
+  // Decodes a MarketDataSnapshotFullRefresh (35=W) into `snapshot`, `symbol`
+  // points into `raw`. The last RptSeq (83) of the message, if any, becomes the
+  // snapshot's sequence, see `add_sequence`. Returns false if the message could
+  // not be decoded, in which case the outputs should be ignored.
+  bool decode_snapshot(std::string_view raw, std::string_view &symbol,
+                       BidAskSnapshot &snapshot);
+
+  // Decodes a MarketDataIncrementalRefresh (35=X) into `delta`, see
+  // `decode_snapshot`. The first RptSeq also becomes the delta's
+  // `first_sequence` when there are several. Trade entries (269=2) become the
+  // delta's trades.
+  bool decode_delta(std::string_view raw, std::string_view &symbol,
+                    BidAskDelta &delta);
+
+  // Compares updates decoded by different decoders, prices and sizes are
+  // compared on the fixed point grid so both decoders may round differently.
+  bool same(BidAskSnapshot const &a, BidAskSnapshot const &b);
+  bool same(BidAskDelta const &a, BidAskDelta const &b);
+} // namespace FixScanner
+
+#endif // fix_scanner
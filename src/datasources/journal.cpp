@@ -0,0 +1,394 @@
+#include "journal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace Journal
+{
+  namespace
+  {
+    constexpr size_t ALIGNMENT = 8;
+    // Each journal buffers this much before the background thread has to
+    // hand it to the kernel.
+    constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    size_t padded(size_t size)
+    {
+      return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    template <typename T>
+    T read(char const *data)
+    {
+      T value;
+      std::memcpy(&value, data, sizeof(T));
+      return value;
+    }
+
+    int64_t now()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    std::FILE *open_file(std::string const &path)
+    {
+      auto directory = std::filesystem::path(path).parent_path();
+      if (!directory.empty())
+        std::filesystem::create_directories(directory);
+
+      std::FILE *file = std::fopen(path.c_str(), "ab+");
+      if (file == nullptr)
+        throw std::runtime_error("Could not open journal " + path);
+      std::setvbuf(file, nullptr, _IOFBF, BUFFER_SIZE);
+
+      std::fseek(file, 0, SEEK_END);
+      if (std::ftell(file) == 0)
+      {
+        FileHeader header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.header_size = sizeof(FileHeader);
+        std::fwrite(&header, sizeof(header), 1, file);
+        return file;
+      }
+
+      // Appending to an existing journal, make sure it is one
+      FileHeader header;
+      std::rewind(file);
+      if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+          std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+      {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a journal");
+      }
+      std::fseek(file, 0, SEEK_END);
+      return file;
+    }
+  } // namespace
+
+  Writer::Writer(size_t queue_size)
+      : m_queue(queue_size), m_overflows(0), m_stopping(false), m_sleeping(false), m_wakeups(0),
+        m_flush_requests(0), m_flushes(0), m_mutex(), m_files(), m_thread()
+  {
+    this->m_thread = std::thread(&Writer::run, this);
+  }
+
+  Writer::~Writer()
+  {
+    this->m_stopping = true;
+    this->m_wakeups.fetch_add(1, std::memory_order_release);
+    this->m_wakeups.notify_one();
+    this->m_thread.join();
+    for (auto &file : this->m_files)
+      if (file->file != nullptr)
+        std::fclose(file->file);
+  }
+
+  File *Writer::open(std::string const &path)
+  {
+    auto file = std::make_unique<File>(File{path, open_file(path)});
+    std::lock_guard<std::mutex> lock(this->m_mutex);
+    this->m_files.push_back(std::move(file));
+    return this->m_files.back().get();
+  }
+
+  void Writer::append(File *file, RecordKind kind, uint64_t sequence, std::string_view data)
+  {
+    RecordHeader header = {};
+    header.size = sizeof(RecordHeader) + padded(data.size());
+    header.data_size = data.size();
+    header.kind = kind;
+    header.sequence = sequence;
+    header.timestamp = now();
+
+    Command command = {Operation::Append, file, std::string()};
+    command.bytes.reserve(header.size);
+    command.bytes.append(reinterpret_cast<char const *>(&header), sizeof(header));
+    command.bytes.append(data);
+    command.bytes.append(padded(data.size()) - data.size(), '\0');
+    push(std::move(command));
+  }
+
+  void Writer::truncate(File *file)
+  {
+    push({Operation::Truncate, file, std::string()});
+  }
+
+  void Writer::backup(File *file)
+  {
+    push({Operation::Backup, file, std::string()});
+  }
+
+  void Writer::flush()
+  {
+    // Flushes are carried out in the order they were asked for, and any flush
+    // carried out after ours was pushed covers everything appended before it
+    uint64_t const request = this->m_flush_requests.fetch_add(1, std::memory_order_acq_rel) + 1;
+    push({Operation::Flush, nullptr, std::string()});
+
+    uint64_t flushes = this->m_flushes.load(std::memory_order_acquire);
+    while (flushes < request)
+    {
+      this->m_flushes.wait(flushes, std::memory_order_acquire);
+      flushes = this->m_flushes.load(std::memory_order_acquire);
+    }
+  }
+
+  uint64_t Writer::overflows() const
+  {
+    return this->m_overflows.load(std::memory_order_relaxed);
+  }
+
+  void Writer::push(Command &&command)
+  {
+    if (!this->m_queue.try_push(std::move(command)))
+    {
+      // The disk is falling behind, the store has to keep every message so we
+      // wait for room rather than dropping any
+      this->m_overflows.fetch_add(1, std::memory_order_relaxed);
+      do
+        std::this_thread::yield();
+      while (!this->m_queue.try_push(std::move(command)));
+    }
+    wake();
+  }
+
+  void Writer::wake()
+  {
+    // Pairs with the fence in `run`, either the background thread sees the
+    // new command or we see that it is about to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->m_sleeping.load(std::memory_order_relaxed))
+    {
+      this->m_wakeups.fetch_add(1, std::memory_order_release);
+      this->m_wakeups.notify_one();
+    }
+  }
+
+  void Writer::execute(Command &command)
+  {
+    // A journal which could not be reopened is left closed and its records are
+    // dropped
+    if (command.operation == Operation::Flush)
+    {
+      std::lock_guard<std::mutex> lock(this->m_mutex);
+      for (auto &file : this->m_files)
+        if (file->file != nullptr)
+          std::fflush(file->file);
+      this->m_flushes.fetch_add(1, std::memory_order_release);
+      this->m_flushes.notify_all();
+      return;
+    }
+    if (command.file->file == nullptr)
+      return;
+
+    switch (command.operation)
+    {
+    case Operation::Append:
+      std::fwrite(command.bytes.data(), 1, command.bytes.size(), command.file->file);
+      return;
+    case Operation::Truncate:
+      std::fflush(command.file->file);
+      if (ftruncate(fileno(command.file->file), 0) != 0)
+        return;
+      break;
+    case Operation::Backup:
+    {
+      std::fflush(command.file->file);
+      std::string backup;
+      for (int i = 1;; i++)
+      {
+        backup = command.file->path + "." + std::to_string(i);
+        if (!std::filesystem::exists(backup))
+          break;
+      }
+      std::error_code error;
+      std::filesystem::rename(command.file->path, backup, error);
+      if (error)
+        return;
+      break;
+    }
+    case Operation::Flush:
+      return;
+    }
+
+    // Start over with a fresh header
+    std::fclose(command.file->file);
+    command.file->file = nullptr;
+    try
+    {
+      command.file->file = open_file(command.file->path);
+    }
+    catch (std::exception const &exception)
+    {
+      std::cerr << exception.what() << std::endl;
+    }
+  }
+
+  void Writer::run()
+  {
+    Command command;
+    bool dirty = false;
+
+    while (true)
+    {
+      if (this->m_queue.try_pop(command))
+      {
+        execute(command);
+        dirty = command.operation != Operation::Flush;
+        continue;
+      }
+
+      // Out of work, hand whatever piled up to the kernel before sleeping
+      if (dirty)
+      {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        for (auto &file : this->m_files)
+          if (file->file != nullptr)
+            std::fflush(file->file);
+        dirty = false;
+      }
+
+      if (this->m_stopping.load(std::memory_order_acquire) && this->m_queue.empty())
+        return;
+
+      uint32_t seen = this->m_wakeups.load(std::memory_order_acquire);
+      this->m_sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (this->m_queue.empty() && !this->m_stopping.load(std::memory_order_acquire))
+        this->m_wakeups.wait(seen, std::memory_order_acquire);
+      this->m_sleeping.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  Reader::Reader(std::string const &path) : m_data(), m_offset(0)
+  {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      return;
+    this->m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (this->m_data.size() < sizeof(FileHeader))
+      throw std::runtime_error(path + " is not a journal");
+    auto header = read<FileHeader>(this->m_data.data());
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.header_size < sizeof(FileHeader) || header.header_size > this->m_data.size())
+      throw std::runtime_error(path + " is not a journal");
+    this->m_offset = header.header_size;
+  }
+
+  bool Reader::next(Record &record)
+  {
+    if (this->m_data.size() - this->m_offset < sizeof(RecordHeader))
+      return false;
+
+    char const *data = this->m_data.data() + this->m_offset;
+    auto header = read<RecordHeader>(data);
+    if (header.kind > RecordKind::Event ||
+        header.size != sizeof(RecordHeader) + padded(header.data_size) ||
+        header.size > this->m_data.size() - this->m_offset)
+      return false;
+
+    record.kind = header.kind;
+    record.sequence = header.sequence;
+    record.timestamp = header.timestamp;
+    record.data = std::string_view(data + sizeof(RecordHeader), header.data_size);
+
+    this->m_offset += header.size;
+    return true;
+  }
+
+  Sequences::Sequences(std::string const &path) : m_layout(nullptr)
+  {
+    auto directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty())
+      std::filesystem::create_directories(directory);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+      throw std::runtime_error("Could not open sequence numbers " + path);
+
+    struct stat info;
+    bool created = fstat(fd, &info) == 0 && info.st_size == 0;
+    if (created && ftruncate(fd, sizeof(Layout)) != 0)
+    {
+      close(fd);
+      throw std::runtime_error("Could not size sequence numbers " + path);
+    }
+    if (!created && static_cast<size_t>(info.st_size) != sizeof(Layout))
+    {
+      close(fd);
+      throw std::runtime_error(path + " does not hold sequence numbers");
+    }
+
+    void *data = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      throw std::runtime_error("Could not map sequence numbers " + path);
+    this->m_layout = static_cast<Layout *>(data);
+
+    if (created)
+    {
+      std::memcpy(this->m_layout->magic, MAGIC, sizeof(MAGIC));
+      this->m_layout->version = VERSION;
+      reset(std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+    }
+    else if (std::memcmp(this->m_layout->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+             this->m_layout->version != VERSION)
+    {
+      munmap(data, sizeof(Layout));
+      throw std::runtime_error(path + " does not hold sequence numbers");
+    }
+  }
+
+  Sequences::~Sequences()
+  {
+    munmap(this->m_layout, sizeof(Layout));
+  }
+
+  uint64_t Sequences::next_sender() const
+  {
+    return this->m_layout->next_sender;
+  }
+
+  uint64_t Sequences::next_target() const
+  {
+    return this->m_layout->next_target;
+  }
+
+  int64_t Sequences::creation_time() const
+  {
+    return this->m_layout->creation_time;
+  }
+
+  void Sequences::set_next_sender(uint64_t sequence)
+  {
+    this->m_layout->next_sender = sequence;
+  }
+
+  void Sequences::set_next_target(uint64_t sequence)
+  {
+    this->m_layout->next_target = sequence;
+  }
+
+  void Sequences::reset(int64_t creation_time)
+  {
+    this->m_layout->next_sender = 1;
+    this->m_layout->next_target = 1;
+    this->m_layout->creation_time = creation_time;
+  }
+} // namespace Journal
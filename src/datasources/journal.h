@@ -0,0 +1,206 @@
+#ifndef journal
+#define journal
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../mpsc_queue.h"
+
+// Append only binary files written by a background thread, used to keep the
+// FIX session's messages, logs and sequence numbers off the thread which
+// receives market data.
+//
+// A journal starts with a `FileHeader` followed by records. Each record is a
+// `RecordHeader` followed by the raw message padded to 8 bytes. A record cut
+// short by a crash marks the end of the journal.
+namespace Journal
+{
+  constexpr char MAGIC[8] = {'O', 'B', 'J', 'R', 'N', 'L', 0, 0};
+  constexpr uint32_t VERSION = 1;
+
+  // Number of writes that can be waiting for the background thread.
+  constexpr size_t DEFAULT_QUEUE_SIZE = 1 << 14;
+
+  enum class RecordKind : uint8_t
+  {
+    // A message kept for resending, `sequence` is its MsgSeqNum.
+    Stored,
+    Incoming,
+    Outgoing,
+    Event,
+  };
+
+  typedef struct
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+  } FileHeader;
+
+  typedef struct
+  {
+    // Size of the whole record including this header and padding.
+    uint32_t size;
+    uint32_t data_size;
+    RecordKind kind;
+    uint8_t reserved[7];
+    uint64_t sequence;
+    // When the record was written, in nanoseconds since the epoch.
+    int64_t timestamp;
+  } RecordHeader;
+
+  // A record read back from a journal, `data` points into the reader.
+  typedef struct
+  {
+    RecordKind kind;
+    uint64_t sequence;
+    int64_t timestamp;
+    std::string_view data;
+  } Record;
+
+  // A journal open for writing, owned by the `Writer` which opened it.
+  typedef struct
+  {
+    std::string path;
+    std::FILE *file;
+  } File;
+
+  // Writes to any number of journals from a single background thread.
+  //
+  // Any thread can append, the record is encoded on the calling thread and
+  // handed over through a lock-free queue, so appending costs a copy of the
+  // message. The background thread lets writes pile up in large stdio buffers
+  // while it is busy and hands them to the kernel whenever it runs out of
+  // work. Nothing is synced to disk, which covers a crash of the process but
+  // not of the machine.
+  class Writer
+  {
+  private:
+    enum class Operation : uint8_t
+    {
+      Append,
+      Truncate,
+      Backup,
+      Flush,
+    };
+
+    typedef struct
+    {
+      Operation operation;
+      File *file;
+      std::string bytes;
+    } Command;
+
+    MpscQueue<Command> m_queue;
+    std::atomic<uint64_t> m_overflows;
+    std::atomic<bool> m_stopping;
+
+    // Lets the background thread sleep until something is pushed.
+    std::atomic<bool> m_sleeping;
+    std::atomic<uint32_t> m_wakeups;
+
+    // Flushes asked for and carried out, callers of `flush` wait for the
+    // second to catch up with their request.
+    std::atomic<uint64_t> m_flush_requests;
+    std::atomic<uint64_t> m_flushes;
+
+    // Journals are only opened and closed under the lock, the records are
+    // written without it.
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<File>> m_files;
+
+    std::thread m_thread;
+
+    void push(Command &&);
+    void wake();
+    void execute(Command &);
+    void run();
+
+  public:
+    Writer(size_t queue_size = DEFAULT_QUEUE_SIZE);
+    // Writes everything still queued before returning.
+    ~Writer();
+
+    Writer(Writer const &) = delete;
+    Writer &operator=(Writer const &) = delete;
+
+    // Opens the journal at `path` for appending, creating it and its directory
+    // if needed. The journal stays open as long as the writer.
+    File *open(std::string const &path);
+
+    /* Safe to call from any thread */
+    void append(File *, RecordKind, uint64_t sequence, std::string_view data);
+    // Drops every record of the journal.
+    void truncate(File *);
+    // Moves the journal aside to the first free `<path>.<n>` and starts an
+    // empty one.
+    void backup(File *);
+    // Blocks until everything appended so far has been handed to the kernel.
+    void flush();
+
+    // Number of times the queue was full and an append had to wait.
+    uint64_t overflows() const;
+  };
+
+  // Reads a journal back, the whole file is loaded up front.
+  class Reader
+  {
+  private:
+    std::string m_data;
+    size_t m_offset;
+
+  public:
+    // Throws if the file exists but is not a journal, a missing file reads as
+    // an empty journal.
+    Reader(std::string const &path);
+
+    // Returns false once there are no complete records left.
+    bool next(Record &);
+  };
+
+  // The next sender and target sequence numbers of a FIX session and when it
+  // was created, kept in a small memory mapped file. Updates are plain stores
+  // into the mapping, the kernel writes them back on its own.
+  class Sequences
+  {
+  private:
+    typedef struct
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t reserved;
+      uint64_t next_sender;
+      uint64_t next_target;
+      // In seconds since the epoch.
+      int64_t creation_time;
+    } Layout;
+
+    Layout *m_layout;
+
+  public:
+    // Opens the file at `path`, a new file starts both sequences at 1.
+    Sequences(std::string const &path);
+    ~Sequences();
+
+    Sequences(Sequences const &) = delete;
+    Sequences &operator=(Sequences const &) = delete;
+
+    uint64_t next_sender() const;
+    uint64_t next_target() const;
+    int64_t creation_time() const;
+
+    void set_next_sender(uint64_t);
+    void set_next_target(uint64_t);
+    // Starts both sequences over at 1, created at `creation_time`.
+    void reset(int64_t creation_time);
+  };
+} // namespace Journal
+
+#endif // journal
@@ -0,0 +1,89 @@
+#include "replay.h"
+
+#include <chrono>
+#include <utility>
+
+#include "../latency_trace.h"
+
+Replay::Replay(std::string path, bool paced)
+    : m_path(std::move(path)), m_paced(paced), m_thread(), m_stop(false), m_done(false),
+      m_symbols(nullptr) {}
+
+Replay::~Replay()
+{
+  this->m_stop = true;
+  if (this->m_thread.joinable())
+    this->m_thread.join();
+}
+
+void Replay::attach_symbols(SymbolTable const &symbols)
+{
+  this->m_symbols = &symbols;
+}
+
+void Replay::attach_bid_ask_snapshot_handler(std::function<void(SymbolId, BidAskSnapshot const &)> handler)
+{
+  this->m_bid_ask_snapshot_handler = handler;
+}
+
+void Replay::attach_bid_ask_delta_handler(std::function<void(SymbolId, BidAskDelta const &)> handler)
+{
+  this->m_bid_ask_delta_handler = handler;
+}
+
+void Replay::run()
+{
+  // Open the file up front so that a bad path is reported to the caller
+  Capture::Reader reader(this->m_path);
+  this->m_thread = std::thread(
+      [this]()
+      {
+        replay_all();
+        this->m_done = true;
+      });
+}
+
+uint64_t Replay::replay_all()
+{
+  Capture::Reader reader(this->m_path);
+  Capture::Record record;
+  BidAskSnapshot snapshot;
+  BidAskDelta delta;
+
+  uint64_t count = 0;
+  int64_t first_timestamp = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  while (!this->m_stop && reader.next(record, snapshot, delta))
+  {
+    if (this->m_paced)
+    {
+      if (count == 0)
+        first_timestamp = record.timestamp;
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timestamp - first_timestamp));
+    }
+
+    // Replayed messages are received the moment they are read back
+    LatencyTrace::received(LatencyTrace::now());
+    count++;
+    auto const id = this->m_symbols != nullptr ? this->m_symbols->find(record.symbol) : std::nullopt;
+    if (!id.has_value())
+      continue;
+
+    if (record.kind == Capture::RecordKind::Snapshot)
+    {
+      if (this->m_bid_ask_snapshot_handler)
+        this->m_bid_ask_snapshot_handler(*id, snapshot);
+    }
+    else if (this->m_bid_ask_delta_handler)
+    {
+      this->m_bid_ask_delta_handler(*id, delta);
+    }
+  }
+  return count;
+}
+
+bool Replay::done() const
+{
+  return this->m_done;
+}
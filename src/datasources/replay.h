@@ -0,0 +1,58 @@
+#ifndef replay
+#define replay
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "../symbol_table.h"
+#include "./capture.h"
+#include "./datasource.h"
+
+// A datasource that feeds the updates of a capture file to the same handlers
+// the live datasources use, so books can be driven without a network.
+class Replay
+{
+private:
+  std::string m_path;
+  // Sleep between updates to reproduce the gaps between their receive times,
+  // otherwise updates are delivered as fast as the handlers take them.
+  bool m_paced;
+  std::thread m_thread;
+  std::atomic<bool> m_stop;
+  std::atomic<bool> m_done;
+
+  // Updates are handed on keyed by the id of their symbol in this table,
+  // those for symbols missing from it are skipped.
+  SymbolTable const *m_symbols;
+
+  // Handler callbacks
+  std::function<void(SymbolId, BidAskSnapshot const &)> m_bid_ask_snapshot_handler;
+  std::function<void(SymbolId, BidAskDelta const &)> m_bid_ask_delta_handler;
+
+public:
+  const static DatasourceID datasource_id = DatasourceID::Replay;
+
+  Replay(std::string path, bool paced);
+  ~Replay();
+
+  /* Actions */
+  // Resolves the symbols of the capture through `symbols`, which has to
+  // outlive the replay.
+  void attach_symbols(SymbolTable const &symbols);
+  void attach_bid_ask_snapshot_handler(std::function<void(SymbolId, BidAskSnapshot const &)>);
+  void attach_bid_ask_delta_handler(std::function<void(SymbolId, BidAskDelta const &)>);
+
+  // Replays the file on a background thread, like the live datasources do.
+  void run();
+
+  // Replays the file on the calling thread, returns the number of updates.
+  uint64_t replay_all();
+
+  // True once a background replay reached the end of the file.
+  bool done() const;
+};
+
+#endif // replay
@@ -0,0 +1,171 @@
+#ifndef small_vector
+#define small_vector
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Recycles the heap blocks that small vectors spill into. Blocks are kept in
+// one free list per power of two capacity and each thread has its own pool,
+// so once a thread has seen its largest message it stops allocating.
+template <typename T>
+class SpillPool
+{
+private:
+    static constexpr size_t CLASSES = 48;
+
+    std::vector<T *> free_lists[CLASSES];
+
+public:
+    ~SpillPool()
+    {
+        for (size_t i = 0; i < CLASSES; i++)
+            for (T *block : free_lists[i])
+                std::allocator<T>().deallocate(block, size_t(1) << i);
+    }
+
+    static SpillPool &local()
+    {
+        static thread_local SpillPool pool;
+        return pool;
+    }
+
+    // Returns a block of at least `capacity` items, `capacity` is updated to
+    // the actual size of the block.
+    T *acquire(size_t &capacity)
+    {
+        capacity = std::bit_ceil(capacity);
+        auto &free_list = free_lists[std::countr_zero(capacity)];
+        if (free_list.empty())
+            return std::allocator<T>().allocate(capacity);
+
+        T *block = free_list.back();
+        free_list.pop_back();
+        return block;
+    }
+
+    void release(T *block, size_t capacity)
+    {
+        free_lists[std::countr_zero(capacity)].push_back(block);
+    }
+};
+
+// A vector of trivially copyable items with inline storage for `N` of them.
+// Larger vectors spill into blocks from the thread's `SpillPool`, which get
+// returned to the pool when the vector is destroyed.
+template <typename T, size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+private:
+    T *m_items;
+    size_t m_size;
+    size_t m_capacity;
+    T m_inline[N];
+
+    bool spilled() const { return m_items != m_inline; }
+
+    void release()
+    {
+        if (spilled())
+            SpillPool<T>::local().release(m_items, m_capacity);
+        m_items = m_inline;
+        m_capacity = N;
+    }
+
+    void grow(size_t capacity)
+    {
+        T *items = SpillPool<T>::local().acquire(capacity);
+        std::memcpy(items, m_items, m_size * sizeof(T));
+        if (spilled())
+            SpillPool<T>::local().release(m_items, m_capacity);
+        m_items = items;
+        m_capacity = capacity;
+    }
+
+public:
+    SmallVector() : m_items(m_inline), m_size(0), m_capacity(N) {}
+
+    SmallVector(std::initializer_list<T> items) : SmallVector()
+    {
+        reserve(items.size());
+        for (auto const &item : items)
+            push_back(item);
+    }
+
+    SmallVector(SmallVector const &other) : SmallVector() { *this = other; }
+
+    SmallVector(SmallVector &&other) : SmallVector() { *this = std::move(other); }
+
+    ~SmallVector() { release(); }
+
+    SmallVector &operator=(SmallVector const &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            reserve(other.m_size);
+            std::memcpy(m_items, other.m_items, other.m_size * sizeof(T));
+            m_size = other.m_size;
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other)
+    {
+        if (this == &other)
+            return *this;
+
+        release();
+        if (other.spilled())
+        {
+            // Steal the spilled block
+            m_items = other.m_items;
+            m_capacity = other.m_capacity;
+            other.m_items = other.m_inline;
+            other.m_capacity = N;
+        }
+        else
+        {
+            std::memcpy(m_items, other.m_items, other.m_size * sizeof(T));
+        }
+        m_size = other.m_size;
+        other.m_size = 0;
+        return *this;
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+
+    T *begin() { return m_items; }
+    T *end() { return m_items + m_size; }
+    T const *begin() const { return m_items; }
+    T const *end() const { return m_items + m_size; }
+
+    T &operator[](size_t i) { return m_items[i]; }
+    T const &operator[](size_t i) const { return m_items[i]; }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_capacity)
+            grow(capacity);
+    }
+
+    void push_back(T const &item)
+    {
+        if (m_size == m_capacity)
+            grow(m_capacity * 2);
+        m_items[m_size++] = item;
+    }
+
+    // Keeps the spilled block around so that the vector can be reused.
+    void clear() { m_size = 0; }
+};
+
+#endif // small_vector
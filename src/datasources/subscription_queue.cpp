@@ -0,0 +1,108 @@
+#include "subscription_queue.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace Deribit
+{
+  SubscriptionQueue::SubscriptionQueue(size_t max_symbols_per_request)
+      : m_max_symbols_per_request(std::max<size_t>(max_symbols_per_request, 1)) {}
+
+  void SubscriptionQueue::queue(std::string const &symbol, Subscription subscription)
+  {
+    auto &state = this->m_subscriptions[symbol];
+    state.subscription = subscription;
+    if (!state.pending)
+      this->m_pending.push_back(symbol);
+    state.pending = true;
+  }
+
+  bool SubscriptionQueue::pending() const
+  {
+    return !this->m_pending.empty();
+  }
+
+  void SubscriptionQueue::forget_request(std::string const &request_id, std::string const &symbol)
+  {
+    auto it = this->m_requests.find(request_id);
+    if (it == this->m_requests.end())
+      return;
+    auto &symbols = it->second.symbols;
+    if (auto found = std::find(symbols.begin(), symbols.end(), symbol); found != symbols.end())
+      symbols.erase(found);
+    if (symbols.empty())
+      this->m_requests.erase(it);
+  }
+
+  std::optional<Request> SubscriptionQueue::next(std::string const &request_id)
+  {
+    auto const same = [](Subscription const &a, Subscription const &b)
+    { return a.depth == b.depth && a.trades == b.trades; };
+
+    Request request = {request_id, {}, {}, {}};
+    size_t kept = 0;
+    for (size_t i = 0; i < this->m_pending.size(); i++)
+    {
+      auto it = this->m_subscriptions.find(this->m_pending[i]);
+      // Rejected since it was queued
+      if (it == this->m_subscriptions.end())
+        continue;
+
+      auto &state = it->second;
+      if (request.symbols.size() == this->m_max_symbols_per_request ||
+          (!request.symbols.empty() && !same(request.subscription, state.subscription)))
+      {
+        if (kept != i)
+          this->m_pending[kept] = std::move(this->m_pending[i]);
+        kept++;
+        continue;
+      }
+
+      request.subscription = state.subscription;
+      if (!state.request_id.empty())
+      {
+        request.cancels[state.request_id].push_back(it->first);
+        this->forget_request(state.request_id, it->first);
+      }
+      state.request_id = request_id;
+      state.pending = false;
+      request.symbols.push_back(it->first);
+    }
+    this->m_pending.resize(kept);
+    if (request.symbols.empty())
+      return std::nullopt;
+
+    this->m_requests[request_id] = {request.subscription, request.symbols};
+    return request;
+  }
+
+  void SubscriptionQueue::renew()
+  {
+    this->m_requests.clear();
+    for (auto &[symbol, state] : this->m_subscriptions)
+    {
+      state.request_id.clear();
+      if (!state.pending)
+        this->m_pending.push_back(symbol);
+      state.pending = true;
+    }
+  }
+
+  std::vector<std::string> SubscriptionQueue::reject(std::string const &request_id)
+  {
+    std::vector<std::string> rejected;
+    auto it = this->m_requests.find(request_id);
+    if (it == this->m_requests.end())
+      return rejected;
+    for (auto const &symbol : it->second.symbols)
+    {
+      auto subscription = this->m_subscriptions.find(symbol);
+      if (subscription == this->m_subscriptions.end() || subscription->second.pending)
+        continue;
+      this->m_subscriptions.erase(subscription);
+      rejected.push_back(symbol);
+    }
+    this->m_requests.erase(it);
+    return rejected;
+  }
+} // namespace Deribit
@@ -0,0 +1,87 @@
+#ifndef subscription_queue
+#define subscription_queue
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Deribit
+{
+  // How a book is subscribed to. With a `depth` of 0 the whole book comes as a
+  // snapshot followed by incremental updates, otherwise every change to the
+  // book sends its best `depth` levels again as a full refresh, which Deribit
+  // only does for a depth of 1, 10 or 20. Trades are only sent with `trades`.
+  typedef struct
+  {
+    size_t depth;
+    bool trades;
+  } Subscription;
+
+  // A MarketDataRequest (35=V) to send for the books of `symbols`.
+  typedef struct
+  {
+    std::string request_id;
+    Subscription subscription;
+    std::vector<std::string> symbols;
+    // Symbols subscribed to before by the id of the request they were sent
+    // with, which have to be cancelled before this request goes out.
+    std::unordered_map<std::string, std::vector<std::string>> cancels;
+  } Request;
+
+  // Every book subscribed to, with the id of the request it was last sent with
+  // so that it can be cancelled when the symbol is subscribed to again.
+  // Subscriptions are queued until packed into a request, those with the same
+  // depth and trades go into one request of up to `max_symbols_per_request`
+  // symbols. Not thread safe, the datasource keeps it under its own lock.
+  class SubscriptionQueue
+  {
+  private:
+    typedef struct
+    {
+      Subscription subscription;
+      // Empty while the subscription was not sent in this session
+      std::string request_id;
+      bool pending;
+    } SubscriptionState;
+
+    // The symbols of a request which were not subscribed to again since.
+    typedef struct
+    {
+      Subscription subscription;
+      std::vector<std::string> symbols;
+    } RequestState;
+
+    size_t m_max_symbols_per_request;
+    std::unordered_map<std::string, SubscriptionState> m_subscriptions;
+    std::unordered_map<std::string, RequestState> m_requests;
+    std::vector<std::string> m_pending;
+
+    // Removes `symbol` from the state of the request `request_id`.
+    void forget_request(std::string const &request_id, std::string const &symbol);
+
+  public:
+    SubscriptionQueue(size_t max_symbols_per_request);
+
+    // Queues the subscription of `symbol`, replacing any earlier one. A book
+    // subscribed to again before its request went out is only sent once.
+    void queue(std::string const &symbol, Subscription subscription);
+    bool pending() const;
+
+    // Packs the oldest queued subscriptions which share the subscription of
+    // the first one into a request with id `request_id`, the others stay queued
+    // in order. Returns nothing if no subscription is queued.
+    std::optional<Request> next(std::string const &request_id);
+
+    // Queues every subscription again, for a new session in which none of the
+    // earlier requests hold.
+    void renew();
+
+    // Forgets the books of the rejected request `request_id` and returns them,
+    // those subscribed to again since are kept.
+    std::vector<std::string> reject(std::string const &request_id);
+  };
+} // namespace Deribit
+
+#endif // subscription_queue
@@ -0,0 +1,38 @@
+#include "fenwick_tree.h"
+
+#include <algorithm>
+
+FenwickTree::FenwickTree(size_t size) : nodes(size + 1, Node{0, 0, 0}) {}
+
+Depth FenwickTree::to_depth(Node const& node) {
+  return {size_t(node.levels), node.quantity, node.notional};
+}
+
+size_t FenwickTree::size() const {
+  return nodes.size() - 1;
+}
+
+void FenwickTree::clear() {
+  std::fill(nodes.begin(), nodes.end(), Node{0, 0, 0});
+}
+
+void FenwickTree::add(size_t slot,
+                      int64_t levels,
+                      double quantity,
+                      double price) {
+  for (size_t i = slot + 1; i < nodes.size(); i += i & -i) {
+    nodes[i].levels += levels;
+    nodes[i].quantity += quantity;
+    nodes[i].notional += quantity * price;
+  }
+}
+
+Depth FenwickTree::prefix(size_t count) const {
+  Node sum = {0, 0, 0};
+  for (size_t i = count; i > 0; i -= i & -i) {
+    sum.levels += nodes[i].levels;
+    sum.quantity += nodes[i].quantity;
+    sum.notional += nodes[i].notional;
+  }
+  return to_depth(sum);
+}
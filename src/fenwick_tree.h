@@ -0,0 +1,67 @@
+#ifndef fenwick_tree
+#define fenwick_tree
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "level_storage.h"
+
+// Running totals of the levels in a fixed range of slots, as a Fenwick tree so
+// that changing a slot and summing the first slots both take O(log n).
+//
+// Quantities are summed as doubles, levels that come and go leave rounding
+// errors behind until the tree is cleared.
+class FenwickTree {
+ private:
+  typedef struct {
+    int64_t levels;
+    double quantity;
+    double notional;
+  } Node;
+
+  // One based, `nodes[0]` is unused.
+  std::vector<Node> nodes;
+
+  static Depth to_depth(Node const& node);
+
+ public:
+  FenwickTree(size_t size);
+
+  size_t size() const;
+
+  void clear();
+  // Adds `levels` levels with `quantity` at `price` to the slot, negative
+  // values take them away.
+  void add(size_t slot, int64_t levels, double quantity, double price);
+  // Totals of the first `count` slots.
+  Depth prefix(size_t count) const;
+
+  // Returns the largest `count` for which `accept(prefix(count))` holds and
+  // stores that prefix in `total`. `accept` must hold for every shorter prefix
+  // as well, e.g. "less than 100 contracts".
+  template <typename F>
+  size_t search(F&& accept, Depth& total) const;
+};
+
+template <typename F>
+size_t FenwickTree::search(F&& accept, Depth& total) const {
+  size_t count = 0;
+  Node sum = {0, 0, 0};
+  for (size_t step = std::bit_floor(size()); step > 0; step >>= 1) {
+    if (count + step >= nodes.size())
+      continue;
+    Node const& node = nodes[count + step];
+    Node candidate = {sum.levels + node.levels, sum.quantity + node.quantity,
+                      sum.notional + node.notional};
+    if (accept(to_depth(candidate))) {
+      count += step;
+      sum = candidate;
+    }
+  }
+  total = to_depth(sum);
+  return count;
+}
+
+#endif  // fenwick_tree
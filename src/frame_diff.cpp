@@ -0,0 +1,90 @@
+#include "frame_diff.h"
+
+#include <charconv>
+
+NumberCell::NumberCell(int precision, size_t width)
+    : precision(precision), width(width), blank(false), value(0), text() {
+  clear();
+}
+
+std::string const& NumberCell::format(double value) {
+  if (!blank && value == this->value)
+    return text;
+
+  // Wider numbers overflow the cell rather than being cut
+  char buffer[64];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                              std::chars_format::fixed, precision);
+  size_t size = result.ec == std::errc() ? result.ptr - buffer : 0;
+  text.assign(width > size ? width - size : 0, ' ');
+  text.append(buffer, size);
+
+  blank = false;
+  this->value = value;
+  return text;
+}
+
+std::string const& NumberCell::clear() {
+  if (!blank)
+    text.assign(width, ' ');
+  blank = true;
+  return text;
+}
+
+Frame::Frame() : rows(), dirty(), redraw(true) {}
+
+void Frame::update(std::string_view text) {
+  size_t row = 0;
+  while (true) {
+    size_t end = text.find('\n');
+    std::string_view line = text.substr(0, end);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+
+    if (row == rows.size()) {
+      rows.emplace_back(line);
+      dirty.push_back(true);
+    } else if (rows[row] != line) {
+      rows[row].assign(line);
+      dirty[row] = true;
+    }
+    row++;
+
+    if (end == std::string_view::npos)
+      break;
+    text.remove_prefix(end + 1);
+  }
+
+  // Rows the new frame no longer has are cleared
+  if (row < rows.size()) {
+    rows.resize(row);
+    dirty.resize(row);
+    redraw = true;
+  }
+}
+
+void Frame::invalidate() {
+  redraw = true;
+}
+
+size_t Frame::flush(std::string& out) {
+  if (redraw) {
+    // Hide the cursor and clear the screen
+    out += "\x1b[?25l\x1b[2J";
+    dirty.assign(rows.size(), true);
+    redraw = false;
+  }
+
+  size_t written = 0;
+  for (size_t row = 0; row < rows.size(); row++) {
+    if (!dirty[row])
+      continue;
+    out += "\x1b[";
+    out += std::to_string(row + 1);
+    out += ";1H";
+    out += rows[row];
+    dirty[row] = false;
+    written++;
+  }
+  return written;
+}
@@ -0,0 +1,54 @@
+#ifndef frame_diff
+#define frame_diff
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A number formatted into a fixed width, right aligned cell. The text is only
+// formatted again when the number changes, so cells of levels which did not
+// move cost a comparison per frame.
+class NumberCell {
+ private:
+  int precision;
+  size_t width;
+  bool blank;
+  double value;
+  std::string text;
+
+ public:
+  NumberCell(int precision, size_t width);
+
+  std::string const& format(double value);
+  // Spaces the width of the cell, for levels which do not exist.
+  std::string const& clear();
+};
+
+// Keeps what is on the terminal and writes only the rows which changed.
+//
+// Frames are taken as rendered text, one row per line. Rows are compared with
+// the previous frame and only those which differ are written, each prefixed
+// with a cursor move, so an unchanged screen costs no output at all.
+class Frame {
+ private:
+  std::vector<std::string> rows;
+  std::vector<bool> dirty;
+  bool redraw;
+
+ public:
+  Frame();
+
+  // Takes the next frame, rows are separated by "\r\n" or "\n".
+  void update(std::string_view text);
+
+  // Forgets what is on the terminal, the next flush clears it and writes
+  // every row. Needed when the terminal was resized or written to by others.
+  void invalidate();
+
+  // Appends the output which brings the terminal up to date to `out`, returns
+  // the number of rows written.
+  size_t flush(std::string& out);
+};
+
+#endif  // frame_diff
@@ -0,0 +1,101 @@
+#ifndef hdr_histogram
+#define hdr_histogram
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// A high dynamic range histogram of non-negative values with a relative error
+// of at most 1/64 over the whole uint64_t range.
+//
+// Values below 128 get a bucket each, above that every power of two is split
+// into 64 equal buckets. Counts are written by a single thread with relaxed
+// stores, so other threads can read them at any time without locks and see a
+// slightly stale but consistent enough view for reporting.
+class HdrHistogram {
+ public:
+  static constexpr size_t SUB_BUCKET_BITS = 7;
+  static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+  static constexpr size_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+  static constexpr size_t BUCKETS =
+      SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * HALF_SUB_BUCKETS;
+
+  static size_t index_of(uint64_t value) {
+    if (value < SUB_BUCKETS)
+      return value;
+    size_t shift = std::bit_width(value) - SUB_BUCKET_BITS;
+    return SUB_BUCKETS + (shift - 1) * HALF_SUB_BUCKETS +
+           ((value >> shift) - HALF_SUB_BUCKETS);
+  }
+
+  // Largest value that falls into the bucket at `index`.
+  static uint64_t highest_equivalent(size_t index) {
+    if (index < SUB_BUCKETS)
+      return index;
+    size_t shift = (index - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+    uint64_t sub = (index - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, BUCKETS> counts;
+  std::atomic<uint64_t> total;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> maximum;
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+ public:
+  HdrHistogram() : counts(), total(0), sum(0), maximum(0) {}
+
+  // Only one thread may record into a histogram.
+  void record(uint64_t value) {
+    add(counts[index_of(value)], 1);
+    add(total, 1);
+    add(sum, value);
+    if (value > maximum.load(std::memory_order_relaxed))
+      maximum.store(value, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const { return total.load(std::memory_order_relaxed); }
+  uint64_t max() const { return maximum.load(std::memory_order_relaxed); }
+
+  double mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0 : double(sum.load(std::memory_order_relaxed)) / n;
+  }
+
+  // Returns the value below which `percentile` percent of the values fall.
+  uint64_t value_at(double percentile) const {
+    uint64_t n = count();
+    if (n == 0)
+      return 0;
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(percentile / 100 * n + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += counts[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+        return std::min(highest_equivalent(i), max());
+    }
+    return max();
+  }
+
+  // Adds the values of `other` to this histogram, `other` may be recorded into
+  // while this runs. Like `record`, only one thread may merge into a histogram.
+  void merge(HdrHistogram const& other) {
+    for (size_t i = 0; i < BUCKETS; i++)
+      add(counts[i], other.counts[i].load(std::memory_order_relaxed));
+    add(total, other.count());
+    add(sum, other.sum.load(std::memory_order_relaxed));
+    if (other.max() > max())
+      maximum.store(other.max(), std::memory_order_relaxed);
+  }
+};
+
+#endif  // hdr_histogram
@@ -0,0 +1,255 @@
+#include "ladder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Slots summed together in one node of `sums`, one word of the bitmap.
+static constexpr int64_t BLOCK_SIZE = 64;
+
+Ladder::Ladder(Side side, double tick_size, size_t capacity)
+    : side(side),
+      tick_size(tick_size),
+      capacity(std::max<int64_t>(BLOCK_SIZE, (capacity + BLOCK_SIZE - 1) /
+                                                   BLOCK_SIZE * BLOCK_SIZE)),
+      base(0),
+      best_tick(0),
+      window_count(0),
+      occupied(this->capacity),
+      sums(this->capacity / BLOCK_SIZE) {
+  slots = std::vector<Level>(this->capacity);
+  scratch.reserve(this->capacity);
+}
+
+int64_t Ladder::to_ticks(double price) const {
+  return std::llround(price / tick_size);
+}
+
+size_t Ladder::size() const {
+  return window_count + overflow.size();
+}
+
+bool Ladder::empty() const {
+  return size() == 0;
+}
+
+std::optional<Level> Ladder::best() const {
+  if (window_count == 0)
+    return std::nullopt;
+  return slots[best_tick - base];
+}
+
+void Ladder::clear() {
+  sums.clear();
+  occupied.clear();
+  window_count = 0;
+  overflow.clear();
+}
+
+void Ladder::set(Level level) {
+  int64_t tick = to_ticks(level.price);
+
+  if (empty()) {
+    recenter(tick);
+  } else if (!in_window(tick)) {
+    // Anything outside of the window that does not improve the touch belongs
+    // to the far side, which is kept in the overflow map.
+    if (!better(tick, best_tick)) {
+      overflow[tick] = level;
+      return;
+    }
+    recenter(tick);
+  }
+
+  int64_t index = tick - base;
+  if (!occupied.test(index)) {
+    occupied.set(index);
+    window_count++;
+    add_sum(index, 1, level.quantity, level.price);
+  } else {
+    add_sum(index, 0, level.quantity - slots[index].quantity,
+            slots[index].price);
+  }
+  slots[index] = level;
+
+  if (window_count == 1 || better(tick, best_tick))
+    best_tick = tick;
+}
+
+void Ladder::erase(double price) {
+  int64_t tick = to_ticks(price);
+
+  if (!in_window(tick)) {
+    overflow.erase(tick);
+    return;
+  }
+
+  int64_t index = tick - base;
+  if (!occupied.test(index))
+    return;
+
+  occupied.reset(index);
+  window_count--;
+  add_sum(index, -1, -slots[index].quantity, slots[index].price);
+
+  if (tick != best_tick)
+    return;
+
+  if (auto next = next_worse(index); next.has_value()) {
+    best_tick = base + *next;
+    maybe_recenter();
+  } else if (!overflow.empty()) {
+    recenter(side == Side::Bid ? overflow.rbegin()->first
+                               : overflow.begin()->first);
+  }
+}
+
+bool Ladder::better(int64_t a, int64_t b) const {
+  return side == Side::Bid ? a > b : a < b;
+}
+
+bool Ladder::in_window(int64_t tick) const {
+  return tick >= base && tick < base + capacity;
+}
+
+std::optional<int64_t> Ladder::next_worse(int64_t index) const {
+  // Worse bids live at lower indices and worse asks at higher ones.
+  return side == Side::Bid ? occupied.prev(index) : occupied.next(index);
+}
+
+std::optional<int64_t> Ladder::first_best() const {
+  return next_worse(side == Side::Bid ? capacity : -1);
+}
+
+void Ladder::recenter(int64_t center) {
+  scratch.clear();
+  occupied.for_each([this](int64_t index) {
+    scratch.emplace_back(base + index, slots[index]);
+  });
+
+  sums.clear();
+  occupied.clear();
+  window_count = 0;
+  base = center - capacity / 2;
+
+  auto place = [this](int64_t tick, Level const& level) {
+    int64_t index = tick - base;
+    occupied.set(index);
+    slots[index] = level;
+    window_count++;
+    add_sum(index, 1, level.quantity, level.price);
+  };
+
+  for (auto const& [tick, level] : scratch)
+    if (in_window(tick))
+      place(tick, level);
+    else
+      overflow.emplace(tick, level);
+
+  auto first = overflow.lower_bound(base);
+  auto last = overflow.lower_bound(base + capacity);
+  for (auto it = first; it != last; it++)
+    place(it->first, it->second);
+  overflow.erase(first, last);
+
+  if (window_count > 0)
+    best_tick = base + *first_best();
+}
+
+size_t Ladder::rank(int64_t index) const {
+  return side == Side::Bid ? capacity - 1 - index : index;
+}
+
+void Ladder::add_sum(int64_t index,
+                     int64_t levels,
+                     double quantity,
+                     double price) {
+  sums.add(rank(index) / BLOCK_SIZE, levels, quantity, price);
+}
+
+Depth Ladder::depth(size_t levels) const {
+  Depth total = {0, 0, 0};
+  if (levels == 0)
+    return total;
+
+  auto take = [&](Level const& level) {
+    total.levels++;
+    total.quantity += level.quantity;
+    total.notional += level.price * level.quantity;
+    return total.levels < levels;
+  };
+
+  // The block holding the last level, if it is in the window
+  size_t block = sums.search(
+      [levels](Depth const& depth) { return depth.levels < levels; }, total);
+  if (block < sums.size())
+    for_each_position(block * BLOCK_SIZE, (block + 1) * BLOCK_SIZE, take);
+  else
+    for_each_overflow(take);
+  return total;
+}
+
+Depth Ladder::depth_to(double price) const {
+  // Prices between ticks round towards the best price, which is on the safe
+  // side of the limit
+  double ticks = price / tick_size;
+  int64_t tick = side == Side::Bid ? std::llround(std::ceil(ticks - 1e-9))
+                                   : std::llround(std::floor(ticks + 1e-9));
+  Depth total = {0, 0, 0};
+  auto take = [&total](Level const& level) {
+    total.levels++;
+    total.quantity += level.quantity;
+    total.notional += level.price * level.quantity;
+    return true;
+  };
+
+  if (in_window(tick)) {
+    size_t position = rank(tick - base);
+    size_t block = position / BLOCK_SIZE;
+    total = sums.prefix(block);
+    for_each_position(block * BLOCK_SIZE, position + 1, take);
+    return total;
+  }
+
+  // Outside of the window there are only levels on the far side, all of them
+  // worse than those in the window
+  if (side == Side::Bid ? tick >= base + capacity : tick < base)
+    return total;
+  total = sums.prefix(sums.size());
+  for_each_overflow([&](Level const& level) {
+    return !better(tick, to_ticks(level.price)) && take(level);
+  });
+  return total;
+}
+
+Depth Ladder::fill(double quantity) const {
+  Depth total = {0, 0, 0};
+  if (quantity <= 0)
+    return total;
+
+  auto take = [&](Level const& level) {
+    double part = std::min(level.quantity, quantity - total.quantity);
+    total.levels++;
+    total.quantity += part;
+    total.notional += level.price * part;
+    return total.quantity < quantity;
+  };
+
+  // The block which completes the fill, if it is in the window
+  size_t block = sums.search(
+      [quantity](Depth const& depth) { return depth.quantity < quantity; },
+      total);
+  if (block < sums.size())
+    for_each_position(block * BLOCK_SIZE, (block + 1) * BLOCK_SIZE, take);
+  else
+    for_each_overflow(take);
+  return total;
+}
+
+void Ladder::maybe_recenter() {
+  // Keep the touch away from the far edge of the window so that levels just
+  // behind it stay in the array rather than in the overflow map.
+  int64_t distance = side == Side::Bid ? best_tick - base
+                                       : base + capacity - 1 - best_tick;
+  if (distance < capacity / 4)
+    recenter(best_tick);
+}
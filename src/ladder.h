@@ -0,0 +1,133 @@
+#ifndef ladder
+#define ladder
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "bitmap.h"
+#include "fenwick_tree.h"
+#include "level_storage.h"
+
+// One side of the order book stored as a contiguous array of levels indexed by
+// price in integer ticks.
+//
+// The array only covers a window of `capacity` ticks centered around the touch,
+// levels that fall outside of it (always on the far side) are kept in an
+// ordered overflow map. The window is re-centered when the touch moves out of
+// it or drifts too close to its far edge, so updates near the touch never
+// allocate. Occupied slots are tracked by a two-level bitmap which makes
+// finding the next best level after a removal a couple of bit scans.
+//
+// Running totals of the window are kept per block of 64 slots in a Fenwick tree
+// ordered from the best edge of the window to the far one, small enough to stay
+// in cache while the touch churns. The depth down to a price, a number of
+// levels or a quantity sums whole blocks in O(log n) and walks the slots of at
+// most one block. Only queries that run past the window walk the overflow map.
+class Ladder {
+ private:
+  Side side;
+  double tick_size;
+  int64_t capacity;
+
+  // Tick of the first slot in the window.
+  int64_t base;
+  // Tick of the best level, only meaningful when the ladder is not empty.
+  int64_t best_tick;
+  // Number of occupied slots in the window.
+  size_t window_count;
+
+  std::vector<Level> slots;
+  LevelBitmap occupied;
+  std::map<int64_t, Level> overflow;
+  FenwickTree sums;
+
+  // Reused while re-centering to avoid allocating.
+  std::vector<std::pair<int64_t, Level>> scratch;
+
+  bool better(int64_t a, int64_t b) const;
+  bool in_window(int64_t tick) const;
+
+  std::optional<int64_t> next_worse(int64_t index) const;
+  std::optional<int64_t> first_best() const;
+
+  // Position of a slot counted from the best edge of the window, `sums` holds
+  // the totals of positions [64 * block, 64 * block + 64) in `block`. Mapping a
+  // position back to its slot is the same operation.
+  size_t rank(int64_t index) const;
+  void add_sum(int64_t index, int64_t levels, double quantity, double price);
+  // Calls `f` for each level in positions [first, last) from the best to the
+  // worst until it returns false.
+  template <typename F>
+  void for_each_position(size_t first, size_t last, F&& f) const;
+  // Calls `f` for each level of the overflow map from the best to the worst
+  // until it returns false.
+  template <typename F>
+  void for_each_overflow(F&& f) const;
+
+  void recenter(int64_t center);
+  void maybe_recenter();
+
+ public:
+  Ladder(Side side, double tick_size, size_t capacity);
+
+  int64_t to_ticks(double price) const;
+
+  size_t size() const;
+  bool empty() const;
+
+  std::optional<Level> best() const;
+
+  void clear();
+  void set(Level level);
+  void erase(double price);
+
+  // Totals of the best `levels` levels.
+  Depth depth(size_t levels) const;
+  // Totals of the levels at `price` or better.
+  Depth depth_to(double price) const;
+  // Totals of the best levels needed to fill `quantity`, the worst of which is
+  // only taken in part. Less than `quantity` if the side is too thin.
+  Depth fill(double quantity) const;
+
+  // Calls `f` for each level from the best to the worst until it returns false.
+  template <typename F>
+  void for_each(F&& f) const;
+};
+
+template <typename F>
+void Ladder::for_each(F&& f) const {
+  if (window_count > 0) {
+    for (std::optional<int64_t> index = best_tick - base; index.has_value();
+         index = next_worse(*index))
+      if (!f(slots[*index]))
+        return;
+  }
+
+  for_each_overflow(f);
+}
+
+template <typename F>
+void Ladder::for_each_position(size_t first, size_t last, F&& f) const {
+  for (size_t position = first; position < last; position++) {
+    int64_t index = rank(position);
+    if (occupied.test(index) && !f(slots[index]))
+      return;
+  }
+}
+
+template <typename F>
+void Ladder::for_each_overflow(F&& f) const {
+  if (side == Side::Bid) {
+    for (auto it = overflow.rbegin(); it != overflow.rend(); it++)
+      if (!f(it->second))
+        return;
+  } else {
+    for (auto it = overflow.begin(); it != overflow.end(); it++)
+      if (!f(it->second))
+        return;
+  }
+}
+
+#endif  // ladder
@@ -0,0 +1,143 @@
+#include "latency_trace.h"
+
+namespace LatencyTrace {
+
+char const* name(Stage stage) {
+  switch (stage) {
+    case Stage::Wire:
+      return "wire";
+    case Stage::Exchange:
+      return "exchange";
+    case Stage::Decode:
+      return "decode";
+    case Stage::Queue:
+      return "queue";
+    case Stage::TickToBook:
+      return "tick-to-book";
+  }
+  return "unknown";
+}
+
+}  // namespace LatencyTrace
+
+#ifdef ORDERBOOK_LATENCY_TRACE
+
+#include <array>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "hdr_histogram.h"
+
+namespace LatencyTrace {
+
+namespace {
+
+typedef std::array<HdrHistogram, STAGES> Histograms;
+
+// Owns the histograms of every thread which recorded something. They outlive
+// their threads so that nothing recorded is lost when a thread exits.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Histograms>> histograms;
+};
+
+Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+Histograms& thread_histograms() {
+  thread_local Histograms* histograms = [] {
+    auto owned = std::make_unique<Histograms>();
+    Histograms* histograms = owned.get();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().histograms.push_back(std::move(owned));
+    return histograms;
+  }();
+  return *histograms;
+}
+
+volatile std::sig_atomic_t dump_requested = 0;
+
+void request_dump(int) {
+  dump_requested = 1;
+}
+
+}  // namespace
+
+void record(Stage stage, int64_t ns) {
+  thread_histograms()[size_t(stage)].record(ns > 0 ? uint64_t(ns) : 0);
+}
+
+void dump(std::ostream& out) {
+  auto total = std::make_unique<Histograms>();
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (auto const& histograms : registry().histograms)
+      for (size_t i = 0; i < STAGES; i++)
+        (*total)[i].merge((*histograms)[i]);
+  }
+
+  auto us = [](double ns) { return ns / 1000; };
+  out << std::left << std::setw(14) << "stage (us)" << std::right
+      << std::setw(12) << "count" << std::setw(10) << "mean" << std::setw(10)
+      << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+      << std::setw(10) << "p99.9" << std::setw(10) << "max" << '\n'
+      << std::fixed << std::setprecision(1);
+  for (size_t i = 0; i < STAGES; i++) {
+    HdrHistogram const& histogram = (*total)[i];
+    out << std::left << std::setw(14) << name(Stage(i)) << std::right
+        << std::setw(12) << histogram.count() << std::setw(10)
+        << us(histogram.mean()) << std::setw(10) << us(histogram.value_at(50))
+        << std::setw(10) << us(histogram.value_at(90)) << std::setw(10)
+        << us(histogram.value_at(99)) << std::setw(10)
+        << us(histogram.value_at(99.9)) << std::setw(10) << us(histogram.max())
+        << '\n';
+  }
+  out << std::flush;
+}
+
+Reporter::Reporter(std::string path, double interval)
+    : path(std::move(path)), interval(interval), stopping(false) {
+  std::signal(SIGUSR1, request_dump);
+  thread = std::thread(&Reporter::run, this);
+}
+
+Reporter::~Reporter() {
+  stopping = true;
+  thread.join();
+  std::signal(SIGUSR1, SIG_DFL);
+}
+
+void Reporter::run() {
+  using namespace std::chrono;
+
+  // Polls for SIGUSR1 since a signal handler cannot dump by itself
+  auto const poll = milliseconds(100);
+  auto next = steady_clock::now() + duration_cast<steady_clock::duration>(
+                                        duration<double>(interval));
+  while (!stopping) {
+    std::this_thread::sleep_for(poll);
+
+    bool due = interval > 0 && steady_clock::now() >= next;
+    if (!due && !dump_requested)
+      continue;
+    if (due)
+      next += duration_cast<steady_clock::duration>(duration<double>(interval));
+    dump_requested = 0;
+
+    std::ofstream out(path, std::ios::app);
+    out << "# " << duration_cast<seconds>(system_clock::now().time_since_epoch())
+                       .count()
+        << '\n';
+    dump(out);
+  }
+}
+
+}  // namespace LatencyTrace
+
+#endif
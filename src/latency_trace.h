@@ -0,0 +1,153 @@
+#ifndef latency_trace
+#define latency_trace
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Tick to book latency instrumentation, built with `ORDERBOOK_LATENCY_TRACE`.
+//
+// The datasource stamps every message when its raw form is received, the
+// stamp follows the message through decoding and the book manager's queues
+// until the last of its changes is applied. Each stage is recorded into a
+// histogram owned by the recording thread, so recording never takes a lock
+// nor shares a cache line with another thread.
+//
+// Without the definition stamps are empty and every call is an empty inline
+// function, so none of it is left in the binary.
+namespace LatencyTrace {
+
+enum class Stage {
+  // SendingTime (52) of the message until it was received.
+  Wire,
+  // MDEntryDate (272) of the first entry until the message was received.
+  Exchange,
+  // Received until handed to the handlers, covers QuickFIX and decoding.
+  Decode,
+  // Handed to the book manager until the last change was applied.
+  Queue,
+  // Received until the last change was applied to the book.
+  TickToBook,
+};
+
+constexpr size_t STAGES = 5;
+
+char const* name(Stage stage);
+
+#ifdef ORDERBOOK_LATENCY_TRACE
+
+constexpr bool ENABLED = true;
+
+// A point on the steady clock, in nanoseconds.
+typedef struct {
+  int64_t ns;
+} Stamp;
+
+inline Stamp now() {
+  return {std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count()};
+}
+
+// Records a latency of the calling thread, negative latencies from clock skew
+// are recorded as 0.
+void record(Stage stage, int64_t ns);
+
+inline void since(Stage stage, Stamp from) {
+  record(stage, now().ns - from.ns);
+}
+
+// Records the latency from a UTC timestamp set by the exchange, in
+// nanoseconds since the epoch.
+inline void since_utc(Stage stage, int64_t utc_ns) {
+  record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                        .count() -
+                    utc_ns);
+}
+
+// When the message the calling thread is handling was received, set by the
+// datasource and picked up by the book manager.
+inline thread_local Stamp current_received = {0};
+
+inline void received(Stamp stamp) {
+  current_received = stamp;
+}
+
+inline Stamp received() {
+  return current_received;
+}
+
+// Stamps carried by the changes of a message queued for a book.
+typedef struct {
+  Stamp received;
+  Stamp enqueued;
+} QueueStamps;
+
+inline QueueStamps queued() {
+  return {received(), now()};
+}
+
+// Records the queue and tick to book stages of a message that was applied.
+inline void applied(QueueStamps stamps) {
+  since(Stage::Queue, stamps.enqueued);
+  since(Stage::TickToBook, stamps.received);
+}
+
+// Writes the percentiles of every stage recorded so far by all threads.
+void dump(std::ostream& out);
+
+// Dumps to `path` every `interval` seconds, 0 for never, and whenever the
+// process gets SIGUSR1.
+class Reporter {
+ private:
+  std::string path;
+  double interval;
+  std::atomic<bool> stopping;
+  std::thread thread;
+
+  void run();
+
+ public:
+  Reporter(std::string path, double interval);
+  ~Reporter();
+};
+
+#else
+
+constexpr bool ENABLED = false;
+
+typedef struct {
+} Stamp;
+
+inline Stamp now() {
+  return {};
+}
+
+inline void record(Stage, int64_t) {}
+inline void since(Stage, Stamp) {}
+inline void since_utc(Stage, int64_t) {}
+inline void received(Stamp) {}
+
+inline Stamp received() {
+  return {};
+}
+
+typedef struct {
+} QueueStamps;
+
+inline QueueStamps queued() {
+  return {};
+}
+
+inline void applied(QueueStamps) {}
+
+#endif
+
+}  // namespace LatencyTrace
+
+#endif  // latency_trace
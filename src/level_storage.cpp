@@ -0,0 +1,200 @@
+#include "level_storage.h"
+
+#include <algorithm>
+#include <cmath>
+
+MapLevels::MapLevels(Side side, double, size_t) : side(side) {}
+
+size_t MapLevels::size() const {
+  return levels.size();
+}
+
+bool MapLevels::empty() const {
+  return levels.empty();
+}
+
+std::optional<Level> MapLevels::best() const {
+  if (levels.empty())
+    return std::nullopt;
+  return side == Side::Bid ? levels.rbegin()->second : levels.begin()->second;
+}
+
+void MapLevels::clear() {
+  levels.clear();
+}
+
+void MapLevels::set(Level level) {
+  levels[level.price] = level;
+}
+
+void MapLevels::erase(double price) {
+  levels.erase(price);
+}
+
+FlatLevels::FlatLevels(Side side, double, size_t capacity) : side(side) {
+  levels.reserve(capacity);
+}
+
+size_t FlatLevels::size() const {
+  return levels.size();
+}
+
+bool FlatLevels::empty() const {
+  return levels.empty();
+}
+
+std::optional<Level> FlatLevels::best() const {
+  if (levels.empty())
+    return std::nullopt;
+  return levels.back();
+}
+
+void FlatLevels::clear() {
+  levels.clear();
+}
+
+void FlatLevels::set(Level level) {
+  if (levels.empty() || worse(levels.back().price, level.price)) {
+    levels.push_back(level);
+    return;
+  }
+
+  auto it = search(level.price);
+  if (it != levels.end() && it->price == level.price)
+    *it = level;
+  else
+    levels.insert(it, level);
+}
+
+void FlatLevels::erase(double price) {
+  auto it = search(price);
+  if (it != levels.end() && it->price == price)
+    levels.erase(it);
+}
+
+bool FlatLevels::worse(double a, double b) const {
+  return side == Side::Bid ? a < b : a > b;
+}
+
+std::vector<Level>::iterator FlatLevels::search(double price) {
+  // Most updates land near the touch, gallop from the back to bound the range
+  // before binary searching it.
+  size_t n = levels.size();
+  size_t bound = 1;
+  while (bound < n && worse(price, levels[n - bound].price))
+    bound *= 2;
+
+  auto first = levels.begin() + (bound < n ? n - bound : 0);
+  auto last = levels.end() - bound / 2;
+  return std::lower_bound(first, last, price,
+                          [this](Level const& level, double price) {
+                            return worse(level.price, price);
+                          });
+}
+
+RadixLevels::Page::Page() : occupied(PAGE_SIZE), slots(PAGE_SIZE), count(0) {}
+
+RadixLevels::RadixLevels(Side side, double tick_size, size_t)
+    : side(side), tick_size(tick_size), count(0), best_tick(0) {}
+
+int64_t RadixLevels::to_ticks(double price) const {
+  return std::llround(price / tick_size);
+}
+
+size_t RadixLevels::size() const {
+  return count;
+}
+
+bool RadixLevels::empty() const {
+  return count == 0;
+}
+
+std::optional<Level> RadixLevels::best() const {
+  if (count == 0)
+    return std::nullopt;
+  return pages.find(best_tick >> PAGE_BITS)
+      ->second->slots[best_tick & (PAGE_SIZE - 1)];
+}
+
+void RadixLevels::clear() {
+  for (auto& [_, page] : pages) {
+    page->occupied.clear();
+    page->count = 0;
+    spare.push_back(std::move(page));
+  }
+  pages.clear();
+  count = 0;
+}
+
+void RadixLevels::set(Level level) {
+  int64_t tick = to_ticks(level.price);
+  int64_t index = tick & (PAGE_SIZE - 1);
+
+  auto& page = pages[tick >> PAGE_BITS];
+  if (page == nullptr) {
+    if (spare.empty()) {
+      page = std::make_unique<Page>();
+    } else {
+      page = std::move(spare.back());
+      spare.pop_back();
+    }
+  }
+
+  if (!page->occupied.test(index)) {
+    page->occupied.set(index);
+    page->count++;
+    count++;
+  }
+  page->slots[index] = level;
+
+  if (count == 1 || better(tick, best_tick))
+    best_tick = tick;
+}
+
+void RadixLevels::erase(double price) {
+  int64_t tick = to_ticks(price);
+  int64_t index = tick & (PAGE_SIZE - 1);
+
+  auto it = pages.find(tick >> PAGE_BITS);
+  if (it == pages.end() || !it->second->occupied.test(index))
+    return;
+
+  Page& page = *it->second;
+  page.occupied.reset(index);
+  page.count--;
+  count--;
+
+  if (tick == best_tick && page.count > 0)
+    best_tick = (it->first << PAGE_BITS) + *next_worse(page, index);
+
+  if (page.count > 0)
+    return;
+
+  // The page is empty, recycle it and move the touch to the next page.
+  spare.push_back(std::move(it->second));
+  it = pages.erase(it);
+
+  if (tick != best_tick || count == 0)
+    return;
+
+  if (side == Side::Bid) {
+    auto next = std::prev(it);
+    best_tick = (next->first << PAGE_BITS) + *first_best(*next->second);
+  } else {
+    best_tick = (it->first << PAGE_BITS) + *first_best(*it->second);
+  }
+}
+
+bool RadixLevels::better(int64_t a, int64_t b) const {
+  return side == Side::Bid ? a > b : a < b;
+}
+
+std::optional<int64_t> RadixLevels::next_worse(Page const& page,
+                                               int64_t index) const {
+  return side == Side::Bid ? page.occupied.prev(index)
+                           : page.occupied.next(index);
+}
+
+std::optional<int64_t> RadixLevels::first_best(Page const& page) const {
+  return next_worse(page, side == Side::Bid ? PAGE_SIZE : -1);
+}
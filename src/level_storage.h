@@ -0,0 +1,196 @@
+#ifndef level_storage
+#define level_storage
+
+#include <concepts>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "bitmap.h"
+
+// Determines whether it is a bid or ask level.
+enum class Side { Bid, Ask };
+
+// Represents a level in the order book.
+typedef struct {
+  double price;
+  double quantity;
+} Level;
+
+// Totals over a run of levels starting at the best one.
+typedef struct {
+  size_t levels;
+  double quantity;
+  // Sum of price times quantity, `notional / quantity` is the average price.
+  double notional;
+} Depth;
+
+// Storage for the levels on one side of the order book, it is constructed with
+// the side, the instrument's tick size and a capacity hint. Besides the
+// requirements below a storage provides a `for_each(f)` which calls `f` with
+// each level from the best to the worst until it returns false.
+template <typename T>
+concept LevelStorage =
+    std::constructible_from<T, Side, double, size_t> &&
+    requires(T storage, T const& const_storage, Level level, double price) {
+      { const_storage.size() } -> std::convertible_to<size_t>;
+      { const_storage.best() } -> std::same_as<std::optional<Level>>;
+      storage.clear();
+      storage.set(level);
+      storage.erase(price);
+    };
+
+// Storages which keep running totals answer depth queries themselves, the
+// order book walks the levels of the others.
+template <typename T>
+concept DepthQueries = requires(T const& storage, size_t levels, double value) {
+  { storage.depth(levels) } -> std::same_as<Depth>;
+  { storage.depth_to(value) } -> std::same_as<Depth>;
+  { storage.fill(value) } -> std::same_as<Depth>;
+};
+
+// Levels kept in an ordered map keyed by price.
+class MapLevels {
+ private:
+  Side side;
+  std::map<double, Level> levels;
+
+ public:
+  MapLevels(Side side, double tick_size, size_t capacity);
+
+  size_t size() const;
+  bool empty() const;
+
+  std::optional<Level> best() const;
+
+  void clear();
+  void set(Level level);
+  void erase(double price);
+
+  // Calls `f` for each level from the best to the worst until it returns false.
+  template <typename F>
+  void for_each(F&& f) const;
+};
+
+// Levels kept in a vector sorted from the worst to the best price, so that the
+// touch sits at the back where inserts and removals move the fewest elements.
+// Lookups gallop from the back before binary searching.
+class FlatLevels {
+ private:
+  Side side;
+  std::vector<Level> levels;
+
+  bool worse(double a, double b) const;
+  std::vector<Level>::iterator search(double price);
+
+ public:
+  FlatLevels(Side side, double tick_size, size_t capacity);
+
+  size_t size() const;
+  bool empty() const;
+
+  std::optional<Level> best() const;
+
+  void clear();
+  void set(Level level);
+  void erase(double price);
+
+  // Calls `f` for each level from the best to the worst until it returns false.
+  template <typename F>
+  void for_each(F&& f) const;
+};
+
+// Levels kept in a sparse radix tree over the price in integer ticks. The upper
+// bits of a tick select a page from an ordered map and the lower bits index
+// into the page, which tracks its occupied slots in a two-level bitmap. Unlike
+// the ladder there is no window to re-center, pages are only allocated the
+// first time a price range is touched and are recycled once they empty.
+class RadixLevels {
+ private:
+  static constexpr int64_t PAGE_BITS = 10;
+  static constexpr int64_t PAGE_SIZE = int64_t(1) << PAGE_BITS;
+
+  struct Page {
+    LevelBitmap occupied;
+    std::vector<Level> slots;
+    size_t count;
+
+    Page();
+  };
+
+  Side side;
+  double tick_size;
+  size_t count;
+  // Tick of the best level, only meaningful when not empty.
+  int64_t best_tick;
+
+  std::map<int64_t, std::unique_ptr<Page>> pages;
+  std::vector<std::unique_ptr<Page>> spare;
+
+  bool better(int64_t a, int64_t b) const;
+  std::optional<int64_t> next_worse(Page const& page, int64_t index) const;
+  std::optional<int64_t> first_best(Page const& page) const;
+
+ public:
+  RadixLevels(Side side, double tick_size, size_t capacity);
+
+  int64_t to_ticks(double price) const;
+
+  size_t size() const;
+  bool empty() const;
+
+  std::optional<Level> best() const;
+
+  void clear();
+  void set(Level level);
+  void erase(double price);
+
+  // Calls `f` for each level from the best to the worst until it returns false.
+  template <typename F>
+  void for_each(F&& f) const;
+};
+
+template <typename F>
+void MapLevels::for_each(F&& f) const {
+  if (side == Side::Bid) {
+    for (auto it = levels.rbegin(); it != levels.rend(); it++)
+      if (!f(it->second))
+        return;
+  } else {
+    for (auto it = levels.begin(); it != levels.end(); it++)
+      if (!f(it->second))
+        return;
+  }
+}
+
+template <typename F>
+void FlatLevels::for_each(F&& f) const {
+  for (auto it = levels.rbegin(); it != levels.rend(); it++)
+    if (!f(*it))
+      return;
+}
+
+template <typename F>
+void RadixLevels::for_each(F&& f) const {
+  auto visit = [&](Page const& page) {
+    for (auto index = first_best(page); index.has_value();
+         index = next_worse(page, *index))
+      if (!f(page.slots[*index]))
+        return false;
+    return true;
+  };
+
+  if (side == Side::Bid) {
+    for (auto it = pages.rbegin(); it != pages.rend(); it++)
+      if (!visit(*it->second))
+        return;
+  } else {
+    for (auto it = pages.begin(); it != pages.end(); it++)
+      if (!visit(*it->second))
+        return;
+  }
+}
+
+#endif  // level_storage
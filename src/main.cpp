@@ -1,113 +1,313 @@
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "ftxui/dom/elements.hpp"
 #include "ftxui/screen/screen.hpp"
 #include "ftxui/screen/string.hpp"
+#include "ftxui/screen/terminal.hpp"
 
+#include "book_manager.h"
+#include "dashboard.h"
+#include "datasources/capture.h"
 #include "datasources/deribit.h"
-#include "orderbook.h"
+#include "datasources/replay.h"
+#include "frame_diff.h"
+#include "latency_trace.h"
+#include "shared_books.h"
+
+// Parses a list of books like "BTC-PERPETUAL:0.5,ETH-PERPETUAL:0.05".
+static std::vector<std::pair<std::string, double>> parse_books(
+    std::string const& list) {
+  std::vector<std::pair<std::string, double>> books;
+  std::istringstream entries(list);
+  std::string entry;
+  while (std::getline(entries, entry, ',')) {
+    size_t colon = entry.rfind(':');
+    if (colon == std::string::npos)
+      throw std::runtime_error("Book " + entry + " has no tick size");
+    books.emplace_back(entry.substr(0, colon),
+                       std::stod(entry.substr(colon + 1)));
+  }
+  return books;
+}
+
+// Parses a list of symbols like "BTC-PERPETUAL,ETH-PERPETUAL".
+static std::set<std::string> parse_symbols(std::string const& list) {
+  std::set<std::string> symbols;
+  std::istringstream entries(list);
+  std::string symbol;
+  while (std::getline(entries, symbol, ','))
+    symbols.insert(symbol);
+  return symbols;
+}
+
+// Parses a list of instrument filters like "BTC:OPT:20250328,ETH:FUT", each
+// a currency, a security type and a maturity date of which any may be empty.
+static std::vector<Deribit::InstrumentFilter> parse_filters(
+    std::string const& list) {
+  std::vector<Deribit::InstrumentFilter> filters;
+  std::istringstream entries(list);
+  std::string entry;
+  while (std::getline(entries, entry, ',')) {
+    std::istringstream fields(entry);
+    Deribit::InstrumentFilter filter;
+    std::getline(fields, filter.currency, ':');
+    std::getline(fields, filter.kind, ':');
+    std::getline(fields, filter.expiry, ':');
+    filters.push_back(filter);
+  }
+  return filters;
+}
 
 int main() {
   using namespace ftxui;
 
-  OrderBook ob = OrderBook();
-
   try {
     FIX::SessionSettings settings("fix_settings.cfg");
+
+    // With `SharedMemory` set the books are mirrored into that POSIX shared
+    // memory region for other processes, it outlives the shards writing to it
+    std::unique_ptr<SharedBooks::Publisher> publisher;
+
+    // Books are sharded across `BookWorkers` threads, one by default
+    auto const& defaults = settings.get();
+    BookManager books(defaults.has("BookWorkers")
+                          ? defaults.getInt("BookWorkers")
+                          : 1);
+
+    // With `CaptureFile` set every update is also appended to that file
+    std::unique_ptr<Capture::Writer> recorder;
+    if (defaults.has("CaptureFile"))
+      recorder =
+          std::make_unique<Capture::Writer>(defaults.getString("CaptureFile"));
+
+#ifdef ORDERBOOK_LATENCY_TRACE
+    // Latency percentiles are appended to `LatencyReportFile` every
+    // `LatencyReportInterval` seconds and whenever we get SIGUSR1
+    LatencyTrace::Reporter latency_reporter(
+        defaults.has("LatencyReportFile")
+            ? defaults.getString("LatencyReportFile")
+            : "latency.log",
+        defaults.has("LatencyReportInterval")
+            ? defaults.getDouble("LatencyReportInterval")
+            : 10);
+#endif
+
+    // Outlives the session, whose handlers report to it
+    Dashboard dashboard(books);
     Deribit::Fix application(settings);
 
-    // Attach handlers
-    application.attach_bid_ask_snapshot_handler(
-        [&ob](std::string const& symbol, BidAskSnapshot const& snapshot) {
-          for (auto const& bid : snapshot.bids)
-            ob.add_level({bid.price, bid.quantity}, Side::Bid);
-          for (auto const& ask : snapshot.asks)
-            ob.add_level({ask.price, ask.quantity}, Side::Ask);
-        });
-
-    application.attach_bid_ask_delta_handler(
-        [&ob](std::string const& symbol, BidAskDelta const& delta) {
-          for (auto const& bid : delta.bids)
-            switch (bid.action) {
-              case OfferAction::Add:
-              case OfferAction::Update:
-                ob.add_level({bid.offer.price, bid.offer.quantity}, Side::Bid);
-                break;
-              case OfferAction::Remove:
-                ob.remove_level(bid.offer.price, Side::Bid);
-                break;
-            }
-
-          for (auto const& ask : delta.asks)
-            switch (ask.action) {
-              case OfferAction::Add:
-              case OfferAction::Update:
-                ob.add_level({ask.offer.price, ask.offer.quantity}, Side::Ask);
-                break;
-              case OfferAction::Remove:
-                ob.remove_level(ask.offer.price, Side::Ask);
-                break;
-            }
-        });
-
-    // Run the FIX engine
-    application.run();
-
-    // Wait for FIX to logon
-    std::this_thread::sleep_for(std::chrono::seconds(3));
-
-    /*     // Request symbol info */
-    /*     application.request_symbol_info(); */
-
-    // Request market data
-    application.request_order_book("BTC-PERPETUAL");
-
-    std::string reset_position;
+    // `Books` lists the instruments to follow with their tick sizes, each
+    // shown with `BookDepth` levels a side. Those also listed in `QueueBooks`
+    // subscribe to trades and track queue positions. Those listed in
+    // `ConflatedBooks` only get refreshes of their best `ConflatedDepth`
+    // levels until they refresh more than `PromoteRate` times a second
+    size_t depth = defaults.has("BookDepth") ? defaults.getInt("BookDepth") : 5;
+    auto queue_books = parse_symbols(
+        defaults.has("QueueBooks") ? defaults.getString("QueueBooks") : "");
+    auto conflated_books =
+        parse_symbols(defaults.has("ConflatedBooks")
+                          ? defaults.getString("ConflatedBooks")
+                          : "");
+    size_t conflated_depth = defaults.has("ConflatedDepth")
+                                 ? defaults.getInt("ConflatedDepth")
+                                 : 10;
+    if (conflated_depth != 1 && conflated_depth != 10 && conflated_depth != 20)
+      throw std::runtime_error("ConflatedDepth has to be 1, 10 or 20");
+    double promote_rate =
+        defaults.has("PromoteRate") ? defaults.getDouble("PromoteRate") : 0;
+    for (auto const& [symbol, tick_size] : parse_books(
+             defaults.has("Books") ? defaults.getString("Books")
+                                   : "BTC-PERPETUAL:0.5")) {
+      BookOptions options = {
+          .depth = conflated_books.contains(symbol) ? conflated_depth : 0,
+          .queues = queue_books.contains(symbol),
+          .promote_rate = promote_rate,
+      };
+      dashboard.add(books.add_book(symbol, tick_size, options), depth,
+                    tick_size);
+    }
+
+    if (defaults.has("SharedMemory")) {
+      publisher = std::make_unique<SharedBooks::Publisher>(
+          defaults.getString("SharedMemory"),
+          std::max(books.size(), SharedBooks::DEFAULT_CAPACITY));
+      for (SymbolId id = 0; id < books.size(); id++)
+        publisher->add(id, books.symbol(id));
+      books.attach_top_of_book_handler(
+          [&publisher](SymbolId id, TopOfBook const& top) {
+            publisher->publish(id, top);
+          });
+    }
+
+    // With `CheckpointFile` set the books start from the levels saved there,
+    // marked stale until their snapshots come in, and are saved to it every
+    // `CheckpointInterval` seconds
+    std::string checkpoint_file = defaults.has("CheckpointFile")
+                                      ? defaults.getString("CheckpointFile")
+                                      : "";
+    auto const checkpoint_interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(
+                defaults.has("CheckpointInterval")
+                    ? defaults.getDouble("CheckpointInterval")
+                    : 10));
+    if (!checkpoint_file.empty() && std::filesystem::exists(checkpoint_file))
+      books.restore(checkpoint_file);
+
+    // Attach handlers, updates for symbols without a book are dropped
+    auto attach = [&books, &recorder](auto& source) {
+      source.attach_symbols(books.interned_symbols());
+      source.attach_bid_ask_snapshot_handler(
+          [&books, &recorder](SymbolId id, BidAskSnapshot const& snapshot) {
+            if (recorder)
+              recorder->write(books.symbol(id), snapshot);
+            books.on_snapshot(id, snapshot);
+          });
+
+      source.attach_bid_ask_delta_handler(
+          [&books, &recorder](SymbolId id, BidAskDelta const& delta) {
+            if (recorder)
+              recorder->write(books.symbol(id), delta);
+            books.on_delta(id, delta);
+          });
+    };
+
+    // With `ReplayFile` set the books are fed from a capture instead of FIX
+    std::unique_ptr<Replay> replayer;
+    if (defaults.has("ReplayFile")) {
+      replayer = std::make_unique<Replay>(
+          defaults.getString("ReplayFile"),
+          defaults.has("ReplayPaced") && defaults.getBool("ReplayPaced"));
+      attach(*replayer);
+      replayer->run();
+    } else {
+      attach(application);
+
+      // Books which lost track of their stream or changed depth subscribe
+      // again, after a reconnect every book does
+      auto subscription = [&books](SymbolId id) {
+        return Deribit::Subscription{books.depth(id), books.has_queues(id)};
+      };
+      books.attach_recovery_handler(
+          [&books, &application, subscription](SymbolId id) {
+            application.request_order_book(books.symbol(id),
+                                           subscription(id));
+          });
+      application.attach_resync_handler([&books] {
+        for (SymbolId id = 0; id < books.size(); id++)
+          books.invalidate(id);
+      });
+      application.attach_reject_handler(
+          [&dashboard](std::string const& symbol, std::string const& reason) {
+            dashboard.report("Subscription to " + symbol +
+                             " was rejected: " + reason);
+          });
+
+      // With `Instruments` set every instrument matching one of its filters
+      // also gets a book, with the tick size Deribit lists for it. The list is
+      // fetched on every logon and new instruments are subscribed to in
+      // batches. These books are not shown on the dashboard but published
+      // like the others
+      auto filters = parse_filters(
+          defaults.has("Instruments") ? defaults.getString("Instruments") : "");
+      if (!filters.empty()) {
+        application.attach_instruments_handler(
+            [&books, &application, &publisher, &dashboard, filters](
+                std::vector<Deribit::Instrument> const& instruments) {
+              std::vector<std::string> symbols;
+              for (auto const& instrument : instruments) {
+                if (instrument.tick_size <= 0 ||
+                    books.find(instrument.symbol).has_value() ||
+                    std::none_of(filters.begin(), filters.end(),
+                                 [&instrument](auto const& filter) {
+                                   return Deribit::matches(filter, instrument);
+                                 }))
+                  continue;
+
+                SymbolId id;
+                try {
+                  id = books.add_book(instrument.symbol, instrument.tick_size);
+                } catch (std::runtime_error const& e) {
+                  dashboard.report("Not following " + instrument.symbol +
+                                   ": " + e.what());
+                  break;
+                }
+                if (publisher && id < publisher->capacity())
+                  publisher->add(id, instrument.symbol);
+                symbols.push_back(instrument.symbol);
+              }
+              application.request_order_books(symbols);
+            });
+        application.attach_logon_handler(
+            [&application] { application.request_symbol_info(); });
+      }
+
+      // Request market data for every book, the requests go out as soon as
+      // the session logged on
+      for (SymbolId id = 0; id < books.size(); id++)
+        application.request_order_book(books.symbol(id), subscription(id));
+
+      // Run the FIX engine
+      application.run();
+    }
+
+    // A frame is drawn whenever a book changed or 250ms passed without an
+    // update, at most `RefreshRate` times a second, which keeps the ages and
+    // rates current and picks up terminal resizes. Only the rows which changed
+    // are written to the terminal
+    double refresh_rate =
+        defaults.has("RefreshRate") ? defaults.getDouble("RefreshRate") : 30;
+    auto const frame_interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1 / std::max(refresh_rate, 1.0)));
+    auto const idle_timeout = std::chrono::milliseconds(250);
+
+    Frame frame;
+    std::string output;
+    auto screen = Screen::Create(Dimension::Full());
+    uint64_t seen = 0;
+
+    auto next_checkpoint =
+        std::chrono::steady_clock::now() + checkpoint_interval;
+
     while (true) {
-      auto [bids, asks] = ob.top_n(5);
-      if (bids.size() < 5 || asks.size() < 5)
-        continue;
-
-      auto document = vbox({
-                          text(L"Orderbook for BTC-PERPETUAL"),
-                          separator(),
-                          text(std::to_string(asks[4].price) + " " +
-                               std::to_string(asks[4].quantity)),
-                          text(std::to_string(asks[3].price) + " " +
-                               std::to_string(asks[3].quantity)),
-                          text(std::to_string(asks[2].price) + " " +
-                               std::to_string(asks[2].quantity)),
-                          text(std::to_string(asks[1].price) + " " +
-                               std::to_string(asks[1].quantity)),
-                          text(std::to_string(asks[0].price) + " " +
-                               std::to_string(asks[0].quantity)),
-                          separator(),
-                          text(std::to_string(bids[0].price) + " " +
-                               std::to_string(bids[0].quantity)),
-                          text(std::to_string(bids[1].price) + " " +
-                               std::to_string(bids[1].quantity)),
-                          text(std::to_string(bids[2].price) + " " +
-                               std::to_string(bids[2].quantity)),
-                          text(std::to_string(bids[3].price) + " " +
-                               std::to_string(bids[3].quantity)),
-                          text(std::to_string(bids[4].price) + " " +
-                               std::to_string(bids[4].quantity)),
-                      }) |
-                      border;
-
-      document = vbox(filler(), document);
-
-      auto screen = Screen::Create(Dimension::Full());
-      Render(screen, document);
-      std::cout << reset_position;
-      screen.Print();
-      reset_position = screen.ResetPosition();
-
-      using namespace std::chrono_literals;
-      std::this_thread::sleep_for(0.01s);  // Rerender every 0.01s.
+      seen = books.wait_for_updates(seen, idle_timeout);
+      auto next_frame = std::chrono::steady_clock::now() + frame_interval;
+
+      if (!checkpoint_file.empty() &&
+          std::chrono::steady_clock::now() >= next_checkpoint) {
+        books.save(checkpoint_file);
+        next_checkpoint =
+            std::chrono::steady_clock::now() + checkpoint_interval;
+      }
+
+      auto size = Terminal::Size();
+      bool resized = size.dimx != screen.dimx() || size.dimy != screen.dimy();
+      if (resized) {
+        screen = Screen::Create(Dimension::Full());
+        frame.invalidate();
+      }
+
+      screen.Clear();
+      Render(screen, dashboard.render());
+      frame.update(screen.ToString());
+
+      output.clear();
+      if (frame.flush(output) > 0)
+        std::cout << output << std::flush;
+
+      std::this_thread::sleep_until(next_frame);
     }
 
     return 0;
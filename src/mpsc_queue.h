@@ -0,0 +1,119 @@
+#ifndef mpsc_queue
+#define mpsc_queue
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "cache_line.h"
+
+// A bounded lock-free queue for any number of producer threads and exactly one
+// consumer thread.
+//
+// Every slot carries a sequence number which tells whose turn it is. Producers
+// claim a slot by bumping the tail, fill it and then hand it to the consumer
+// through the slot's sequence, so producers only ever contend on the tail and
+// never wait for each other to finish writing.
+template <typename T>
+class MpscQueue {
+ private:
+  typedef struct {
+    std::atomic<size_t> sequence;
+    T item;
+  } Slot;
+
+  size_t capacity;
+  size_t mask;
+  std::unique_ptr<Slot[]> slots;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+
+ public:
+  // Capacity is rounded up to a power of two.
+  MpscQueue(size_t capacity);
+
+  size_t max_size() const;
+  // Number of items in the queue, an estimate while producers are pushing.
+  size_t size() const;
+  bool empty() const;
+
+  /* Producer side */
+  // Moves from `item` only if there was room, so a failed push can be retried
+  // with the same item.
+  bool try_push(T&& item);
+
+  /* Consumer side */
+  bool try_pop(T& item);
+};
+
+template <typename T>
+MpscQueue<T>::MpscQueue(size_t capacity)
+    : capacity(std::bit_ceil(std::max<size_t>(capacity, 2))),
+      mask(this->capacity - 1),
+      slots(std::make_unique<Slot[]>(this->capacity)),
+      tail(0),
+      head(0) {
+  for (size_t i = 0; i < this->capacity; i++)
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+size_t MpscQueue<T>::max_size() const {
+  return capacity;
+}
+
+template <typename T>
+size_t MpscQueue<T>::size() const {
+  size_t h = head.load(std::memory_order_acquire);
+  size_t t = tail.load(std::memory_order_acquire);
+  return t > h ? t - h : 0;
+}
+
+template <typename T>
+bool MpscQueue<T>::empty() const {
+  return size() == 0;
+}
+
+template <typename T>
+bool MpscQueue<T>::try_push(T&& item) {
+  size_t t = tail.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots[t & mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto turn = static_cast<intptr_t>(sequence - t);
+    if (turn == 0) {
+      if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed))
+        break;
+    } else if (turn < 0) {
+      // The slot still holds an item from the previous lap
+      return false;
+    } else {
+      t = tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->item = std::move(item);
+  slot->sequence.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool MpscQueue<T>::try_pop(T& item) {
+  size_t h = head.load(std::memory_order_relaxed);
+  Slot& slot = slots[h & mask];
+  if (slot.sequence.load(std::memory_order_acquire) != h + 1)
+    return false;
+
+  item = std::move(slot.item);
+  slot.sequence.store(h + capacity, std::memory_order_release);
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+#endif  // mpsc_queue
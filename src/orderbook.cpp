@@ -1,25 +1,71 @@
 #include "orderbook.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
-OrderBook::OrderBook() {
-  bids = std::map<double, Level>();
-  asks = std::map<double, Level>();
+// Adds `quantity` of a level to `depth`.
+static void take(Depth& depth, Level const& level, double quantity) {
+  depth.levels++;
+  depth.quantity += quantity;
+  depth.notional += level.price * quantity;
 }
 
-std::optional<Level> OrderBook::best_bid() {
-  if (bids.empty())
-    return std::nullopt;
-  return bids.rbegin()->second;
+/* Depth queries of storages without running totals, walking their levels */
+
+template <LevelStorage Levels>
+static Depth walk_depth(Levels const& levels, size_t count) {
+  Depth depth = {0, 0, 0};
+  levels.for_each([&](Level const& level) {
+    if (depth.levels == count)
+      return false;
+    take(depth, level, level.quantity);
+    return true;
+  });
+  return depth;
 }
 
-std::optional<Level> OrderBook::best_ask() {
-  if (asks.empty())
-    return std::nullopt;
-  return asks.begin()->second;
+template <LevelStorage Levels>
+static Depth walk_depth_to(Levels const& levels, Side side, double price) {
+  Depth depth = {0, 0, 0};
+  levels.for_each([&](Level const& level) {
+    if (side == Side::Bid ? level.price < price : level.price > price)
+      return false;
+    take(depth, level, level.quantity);
+    return true;
+  });
+  return depth;
+}
+
+template <LevelStorage Levels>
+static Depth walk_fill(Levels const& levels, double quantity) {
+  Depth depth = {0, 0, 0};
+  if (quantity <= 0)
+    return depth;
+  levels.for_each([&](Level const& level) {
+    take(depth, level, std::min(level.quantity, quantity - depth.quantity));
+    return depth.quantity < quantity;
+  });
+  return depth;
+}
+
+template <LevelStorage Levels>
+BasicOrderBook<Levels>::BasicOrderBook(double tick_size, size_t ladder_size)
+    : bids(Side::Bid, tick_size, ladder_size),
+      asks(Side::Ask, tick_size, ladder_size) {}
+
+template <LevelStorage Levels>
+std::optional<Level> BasicOrderBook<Levels>::best_bid() {
+  return bids.best();
 }
 
-double OrderBook::spread() {
+template <LevelStorage Levels>
+std::optional<Level> BasicOrderBook<Levels>::best_ask() {
+  return asks.best();
+}
+
+template <LevelStorage Levels>
+double BasicOrderBook<Levels>::spread() {
   auto best_bid = this->best_bid();
   auto best_ask = this->best_ask();
   if (!best_bid.has_value() || !best_ask.has_value())
@@ -27,23 +73,31 @@ double OrderBook::spread() {
   return best_ask.value().price - best_bid.value().price;
 }
 
-void OrderBook::reset() {
+template <LevelStorage Levels>
+size_t BasicOrderBook<Levels>::size(Side side) {
+  return levels_of(side).size();
+}
+
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::reset() {
   bids.clear();
   asks.clear();
 }
 
-void OrderBook::add_level(Level level, Side side) {
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::add_level(Level level, Side side) {
   switch (side) {
     case Side::Bid:
-      bids[level.price] = level;
+      bids.set(level);
       break;
     case Side::Ask:
-      asks[level.price] = level;
+      asks.set(level);
       break;
   }
 }
 
-void OrderBook::remove_level(double price, Side side) {
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::remove_level(double price, Side side) {
   switch (side) {
     case Side::Bid:
       bids.erase(price);
@@ -54,19 +108,246 @@ void OrderBook::remove_level(double price, Side side) {
   }
 }
 
-std::pair<std::vector<Level>, std::vector<Level>> OrderBook::top_n(
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::apply(BidAskDelta const& delta) {
+  apply(bids, Side::Bid, delta.bids);
+  apply(asks, Side::Ask, delta.asks);
+}
+
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::replace(BidAskSnapshot const& snapshot) {
+  replace(bids, Side::Bid, snapshot.bids);
+  replace(asks, Side::Ask, snapshot.asks);
+}
+
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::replace(
+    Levels& levels,
+    Side side,
+    SmallVector<Offer, INLINE_OFFERS> const& offers) {
+  auto better = [side](Offer const& a, Offer const& b) {
+    return side == Side::Bid ? a.price > b.price : a.price < b.price;
+  };
+  // Exchanges send the levels of a refresh best first, like the book walks
+  // its levels, so the two are merged rather than searched
+  bool best_first = std::is_sorted(offers.begin(), offers.end(), better);
+  auto next = offers.begin();
+  auto find = [&](Level const& level) {
+    Offer key = {level.price, 0};
+    if (!best_first)
+      return std::find_if(offers.begin(), offers.end(),
+                          [&](Offer const& offer) {
+                            return offer.price == level.price;
+                          });
+    while (next != offers.end() && better(*next, key))
+      next++;
+    return next != offers.end() && next->price == level.price ? next
+                                                              : offers.end();
+  };
+
+  // Most refreshes repeat all but a level or two of the last one, the levels
+  // they repeat exactly are left alone
+  stale.clear();
+  unchanged.assign(offers.size(), false);
+  levels.for_each([&](Level const& level) {
+    auto it = find(level);
+    if (it == offers.end())
+      stale.push_back(level.price);
+    else if (it->quantity == level.quantity)
+      unchanged[it - offers.begin()] = true;
+    return true;
+  });
+
+  // Erasing first, a storage keying levels by tick could otherwise erase a
+  // level it was just given at a price which is not exactly the same
+  for (double price : stale)
+    levels.erase(price);
+  for (size_t i = 0; i < offers.size(); i++)
+    if (!unchanged[i])
+      levels.set({offers[i].price, offers[i].quantity});
+}
+
+template <LevelStorage Levels>
+void BasicOrderBook<Levels>::apply(
+    Levels& levels,
+    Side side,
+    SmallVector<OfferChange, INLINE_OFFERS> const& changes) {
+  auto apply_in_order = [&]() {
+    for (auto const& change : changes)
+      if (change.action == OfferAction::Remove)
+        levels.erase(change.offer.price);
+      else
+        levels.set({change.offer.price, change.offer.quantity});
+  };
+
+  // Most messages change a single level on each side
+  if (changes.size() <= 1)
+    return apply_in_order();
+
+  // Asks are keyed by their negated price so both sides sort worst first
+  double sign = side == Side::Bid ? 1 : -1;
+  pending.clear();
+  for (uint32_t i = 0; i < changes.size(); i++)
+    pending.push_back({sign * changes[i].offer.price,
+                       changes[i].offer.quantity,
+                       changes[i].action == OfferAction::Remove, i});
+
+  // Exchanges mostly send the entries of a side in price order, without
+  // repeating a price those only have to be turned around
+  auto not_better = [](PendingChange const& a, PendingChange const& b) {
+    return a.key <= b.key;
+  };
+  auto not_worse = [](PendingChange const& a, PendingChange const& b) {
+    return a.key >= b.key;
+  };
+  bool worst_first = std::adjacent_find(pending.begin(), pending.end(),
+                                        not_worse) == pending.end();
+  bool best_first = !worst_first &&
+                    std::adjacent_find(pending.begin(), pending.end(),
+                                       not_better) == pending.end();
+  if (best_first) {
+    std::reverse(pending.begin(), pending.end());
+  } else if (!worst_first) {
+    // Sorting a large message which is out of order costs more than the
+    // updates it saves on every storage but `MapLevels`
+    if (pending.size() > INLINE_OFFERS)
+      return apply_in_order();
+    std::sort(pending.begin(), pending.end(),
+              [](PendingChange const& a, PendingChange const& b) {
+                return a.key < b.key || (a.key == b.key && a.order < b.order);
+              });
+  }
+
+  auto last = [this](size_t i) {
+    return i + 1 == pending.size() || pending[i + 1].key != pending[i].key;
+  };
+  for (size_t i = 0; i < pending.size(); i++)
+    if (last(i) && !pending[i].remove)
+      levels.set({sign * pending[i].key, pending[i].quantity});
+  // Removing from the worst price up, only the last removal can take out the
+  // best level
+  for (size_t i = 0; i < pending.size(); i++)
+    if (last(i) && pending[i].remove)
+      levels.erase(sign * pending[i].key);
+}
+
+template <LevelStorage Levels>
+Levels& BasicOrderBook<Levels>::levels_of(Side side) {
+  return side == Side::Bid ? bids : asks;
+}
+
+template <LevelStorage Levels>
+Depth BasicOrderBook<Levels>::depth(Side side, size_t levels) {
+  if constexpr (DepthQueries<Levels>)
+    return levels_of(side).depth(levels);
+  else
+    return walk_depth(levels_of(side), levels);
+}
+
+template <LevelStorage Levels>
+Depth BasicOrderBook<Levels>::depth_within(Side side, double bps) {
+  Levels& levels = levels_of(side);
+  auto best = levels.best();
+  if (!best.has_value())
+    return {0, 0, 0};
+
+  double distance = best->price * bps / 10000;
+  double limit =
+      side == Side::Bid ? best->price - distance : best->price + distance;
+  if constexpr (DepthQueries<Levels>)
+    return levels.depth_to(limit);
+  else
+    return walk_depth_to(levels, side, limit);
+}
+
+template <LevelStorage Levels>
+Depth BasicOrderBook<Levels>::fill(Side side, double quantity) {
+  if constexpr (DepthQueries<Levels>)
+    return levels_of(side).fill(quantity);
+  else
+    return walk_fill(levels_of(side), quantity);
+}
+
+template <LevelStorage Levels>
+std::optional<double> BasicOrderBook<Levels>::microprice() {
+  auto bid = bids.best();
+  auto ask = asks.best();
+  if (!bid.has_value() || !ask.has_value())
+    return std::nullopt;
+
+  double size = bid->quantity + ask->quantity;
+  if (size <= 0)
+    return (bid->price + ask->price) / 2;
+  return (bid->price * ask->quantity + ask->price * bid->quantity) / size;
+}
+
+template <LevelStorage Levels>
+std::optional<double> BasicOrderBook<Levels>::imbalance(size_t levels) {
+  double bid_size = depth(Side::Bid, levels).quantity;
+  double ask_size = depth(Side::Ask, levels).quantity;
+  if (bid_size + ask_size <= 0)
+    return std::nullopt;
+  return (bid_size - ask_size) / (bid_size + ask_size);
+}
+
+template <LevelStorage Levels>
+std::optional<double> BasicOrderBook<Levels>::weighted_mid(double bps) {
+  return weighted_mid(depth_within(Side::Bid, bps),
+                      depth_within(Side::Ask, bps));
+}
+
+template <LevelStorage Levels>
+std::optional<double> BasicOrderBook<Levels>::weighted_mid(Depth const& bid,
+                                                           Depth const& ask) {
+  if (bid.quantity <= 0 || ask.quantity <= 0)
+    return std::nullopt;
+  return (bid.notional / bid.quantity + ask.notional / ask.quantity) / 2;
+}
+
+template <LevelStorage Levels>
+std::pair<std::vector<Level>, std::vector<Level>> BasicOrderBook<Levels>::top_n(
     size_t level) {
   std::vector<Level> top_bids, top_asks;
-  auto bid_it = bids.rbegin();
-  auto ask_it = asks.begin();
   auto a = std::min(std::min(bids.size(), level), asks.size());
-  for (size_t i = 0; i < a; i++) {
-    auto bid = bid_it->second;
-    auto ask = ask_it->second;
+  top_bids.reserve(a);
+  top_asks.reserve(a);
+  bids.for_each([&](Level const& bid) {
+    if (top_bids.size() == a)
+      return false;
     top_bids.push_back(bid);
+    return true;
+  });
+  asks.for_each([&](Level const& ask) {
+    if (top_asks.size() == a)
+      return false;
     top_asks.push_back(ask);
-    bid_it++;
-    ask_it++;
-  }
+    return true;
+  });
   return std::make_pair(top_bids, top_asks);
 }
+
+template <LevelStorage Levels>
+size_t BasicOrderBook<Levels>::best_levels(Side side, std::span<Level> levels) {
+  size_t count = 0;
+  auto copy = [&](Level const& level) {
+    if (count == levels.size())
+      return false;
+    levels[count++] = level;
+    return true;
+  };
+
+  switch (side) {
+    case Side::Bid:
+      bids.for_each(copy);
+      break;
+    case Side::Ask:
+      asks.for_each(copy);
+      break;
+  }
+  return count;
+}
+
+template class BasicOrderBook<Ladder>;
+template class BasicOrderBook<MapLevels>;
+template class BasicOrderBook<FlatLevels>;
+template class BasicOrderBook<RadixLevels>;
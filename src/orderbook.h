@@ -1,26 +1,59 @@
 #ifndef orderbook
 #define orderbook
 
-#include <map>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <vector>
 
-// Determines whether it is a bid or ask level.
-enum class Side { Bid, Ask };
+#include "datasources/datasource.h"
+#include "ladder.h"
+#include "level_storage.h"
 
-// Represents a level in the order book.
-typedef struct {
-  double price;
-  double quantity;
-} Level;
+// Tick size used when the instrument's tick size is not known.
+constexpr double DEFAULT_TICK_SIZE = 0.0001;
 
-class OrderBook {
+// Number of ticks each side keeps in its array around the touch.
+constexpr size_t DEFAULT_LADDER_SIZE = 4096;
+
+// An order book over a level storage, the storage is picked at compile time so
+// updates are dispatched without any virtual calls. Pick the storage that suits
+// the instrument, thin books are served well by `FlatLevels` while deep and
+// busy books prefer `Ladder`.
+template <LevelStorage Levels>
+class BasicOrderBook {
  private:
-  std::map<double, Level> bids;
-  std::map<double, Level> asks;
+  Levels bids;
+  Levels asks;
+
+  // A change of a batch, sorted by `key` from the worst price to the best.
+  // `order` keeps changes to the same price in the order they came in.
+  typedef struct {
+    double key;
+    double quantity;
+    bool remove;
+    uint32_t order;
+  } PendingChange;
+
+  // Reused by every batch so that applying one does not allocate.
+  std::vector<PendingChange> pending;
+  // Prices of the levels a refresh no longer has and the offers of a refresh
+  // which the book already has, reused like `pending`.
+  std::vector<double> stale;
+  std::vector<bool> unchanged;
+
+  void apply(Levels& levels,
+             Side side,
+             SmallVector<OfferChange, INLINE_OFFERS> const& changes);
+  void replace(Levels& levels,
+               Side side,
+               SmallVector<Offer, INLINE_OFFERS> const& offers);
+
+  Levels& levels_of(Side side);
 
  public:
-  OrderBook();
+  BasicOrderBook(double tick_size = DEFAULT_TICK_SIZE,
+                 size_t ladder_size = DEFAULT_LADDER_SIZE);
 
   std::optional<Level> best_bid();
   std::optional<Level> best_ask();
@@ -31,7 +64,60 @@ class OrderBook {
 
   void add_level(Level level, Side side);
   void remove_level(double price, Side side);
+
+  // Applies all changes of a message at once. Each side goes from its worst
+  // price to its best with only the last change to each price, additions
+  // before removals, so the best price is looked for at most once per side
+  // however many levels the message removes. Large messages which are not in
+  // price order are applied as they come.
+  void apply(BidAskDelta const& delta);
+  // Makes the book hold exactly the levels of `snapshot`, in place. Levels in
+  // both are only updated and the ones which left are erased, the book is
+  // never cleared. Meant for refreshes of the best few levels of a book, every
+  // level of the book is compared to the refresh.
+  void replace(BidAskSnapshot const& snapshot);
+
+  // Number of levels on a side.
+  size_t size(Side side);
+
   std::pair<std::vector<Level>, std::vector<Level>> top_n(size_t level);
+
+  // Copies the best levels of one side into `levels` without allocating,
+  // returns the number of levels copied.
+  size_t best_levels(Side side, std::span<Level> levels);
+
+  /* Derived metrics, O(log n) over a `Ladder` */
+
+  // Totals of the best `levels` levels of a side.
+  Depth depth(Side side, size_t levels);
+  // Totals of the levels within `bps` basis points of the side's best price.
+  Depth depth_within(Side side, double bps);
+  // Totals of the best levels of a side needed to fill `quantity`, the average
+  // price of the fill is `notional / quantity`.
+  Depth fill(Side side, double quantity);
+
+  // Mid weighted by the sizes at the touch, it leans towards the side with
+  // less size as that one is the likelier to go.
+  std::optional<double> microprice();
+  // Bid size less ask size over their sum, summed over the best `levels`
+  // levels of each side. Ranges from -1 to 1.
+  std::optional<double> imbalance(size_t levels);
+  // Mid of the average prices of the levels within `bps` basis points of the
+  // best price on each side.
+  std::optional<double> weighted_mid(double bps);
+  // The same from the depths of both sides, for callers which need them too.
+  static std::optional<double> weighted_mid(Depth const& bid, Depth const& ask);
 };
 
+// The storages shipped with the order book are instantiated in orderbook.cpp.
+extern template class BasicOrderBook<Ladder>;
+extern template class BasicOrderBook<MapLevels>;
+extern template class BasicOrderBook<FlatLevels>;
+extern template class BasicOrderBook<RadixLevels>;
+
+typedef BasicOrderBook<Ladder> OrderBook;
+typedef BasicOrderBook<MapLevels> MapOrderBook;
+typedef BasicOrderBook<FlatLevels> FlatOrderBook;
+typedef BasicOrderBook<RadixLevels> RadixOrderBook;
+
 #endif  // orderbook
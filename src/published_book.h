@@ -0,0 +1,47 @@
+#ifndef published_book
+#define published_book
+
+#include <cstddef>
+#include <cstdint>
+
+#include "level_storage.h"
+
+// Number of levels per side published for readers.
+constexpr size_t TOP_OF_BOOK_DEPTH = 20;
+
+// Number of levels a side the published imbalance is taken over.
+constexpr size_t METRICS_LEVELS = 5;
+
+// Distance from the best price, in basis points, of the levels counted in the
+// published depth and weighted mid.
+constexpr double METRICS_BPS = 10;
+
+// Metrics derived from a book, published with its best levels. Prices are 0
+// while a side is empty.
+typedef struct {
+  double microprice;
+  double weighted_mid;
+  // See `OrderBook::imbalance`, over `METRICS_LEVELS` levels.
+  double imbalance;
+  // Size within `METRICS_BPS` of the best price on each side.
+  double bid_depth;
+  double ask_depth;
+} BookMetrics;
+
+// The best levels of a book, published after each applied message.
+typedef struct {
+  // Number of messages applied to the book.
+  uint64_t sequence;
+  // When the view was published, in nanoseconds on the steady clock.
+  int64_t timestamp;
+  uint32_t bid_count;
+  uint32_t ask_count;
+  Level bids[TOP_OF_BOOK_DEPTH];
+  Level asks[TOP_OF_BOOK_DEPTH];
+  BookMetrics metrics;
+  // Set while the book holds levels restored from a checkpoint which no
+  // snapshot has confirmed yet.
+  bool stale;
+} TopOfBook;
+
+#endif  // published_book
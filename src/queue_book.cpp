@@ -0,0 +1,272 @@
+#include "queue_book.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Sizes closer than this are taken to be equal and entries smaller than this
+// to be empty, so that rounding never leaves empty entries in a queue.
+constexpr double EPSILON = 1e-9;
+
+QueueBook::QueueBook(double tick_size)
+    : tick_size(tick_size), next_order(1), generation(0), flows() {}
+
+int64_t QueueBook::to_ticks(double price) const {
+  return std::llround(price / tick_size);
+}
+
+bool QueueBook::better(Side side, int64_t a, int64_t b) {
+  return side == Side::Bid ? a > b : a < b;
+}
+
+QueueBook::Node* QueueBook::append(Queue& queue,
+                                   double quantity,
+                                   OrderId order) {
+  Node* node = nodes.acquire();
+  *node = {quantity, order, queue.tail, nullptr};
+  if (queue.tail != nullptr)
+    queue.tail->next = node;
+  else
+    queue.head = node;
+  queue.tail = node;
+  return node;
+}
+
+void QueueBook::unlink(Queue& queue, Node* node) {
+  if (node->prev != nullptr)
+    node->prev->next = node->next;
+  else
+    queue.head = node->next;
+  if (node->next != nullptr)
+    node->next->prev = node->prev;
+  else
+    queue.tail = node->prev;
+  nodes.release(node);
+}
+
+void QueueBook::cancel_size(Queue& queue, double quantity) {
+  // An order leaving whole, the latest event of exactly its size
+  for (Node* node = queue.tail; node != nullptr; node = node->prev) {
+    if (node->order == 0 && std::abs(node->quantity - quantity) < EPSILON) {
+      unlink(queue, node);
+      return;
+    }
+  }
+
+  for (Node* node = queue.tail; node != nullptr && quantity > EPSILON;) {
+    Node* prev = node->prev;
+    if (node->order == 0) {
+      double taken = std::min(node->quantity, quantity);
+      node->quantity -= taken;
+      quantity -= taken;
+      if (node->quantity < EPSILON)
+        unlink(queue, node);
+    }
+    node = prev;
+  }
+}
+
+void QueueBook::remove_market(Queue& queue) {
+  for (Node* node = queue.head; node != nullptr;) {
+    Node* next = node->next;
+    if (node->order == 0)
+      unlink(queue, node);
+    node = next;
+  }
+  queue.quantity = 0;
+}
+
+void QueueBook::fill(Order& order, double quantity) {
+  if (order.node == nullptr)
+    return;
+  double filled = std::min(quantity, order.node->quantity);
+  order.filled += filled;
+  order.node->quantity -= filled;
+  if (order.node->quantity < EPSILON) {
+    unlink(queues[int(order.side)][order.tick], order.node);
+    resting[int(order.side)].erase(order.resting);
+    order.node = nullptr;
+  }
+}
+
+void QueueBook::erase_if_empty(Side side, int64_t tick) {
+  auto& side_queues = queues[int(side)];
+  auto it = side_queues.find(tick);
+  if (it != side_queues.end() && it->second.head == nullptr &&
+      it->second.quantity == 0)
+    side_queues.erase(it);
+}
+
+void QueueBook::set(Side side, double price, double quantity) {
+  auto& side_queues = queues[int(side)];
+  int64_t tick = to_ticks(price);
+
+  if (quantity < EPSILON) {
+    auto it = side_queues.find(tick);
+    if (it == side_queues.end())
+      return;
+    Queue& queue = it->second;
+    remove_market(queue);
+    // Tracked orders keep their place in an empty level
+    if (queue.head == nullptr)
+      side_queues.erase(it);
+    return;
+  }
+
+  Queue& queue = side_queues[tick];
+  queue.generation = generation;
+  if (quantity > queue.quantity + EPSILON)
+    append(queue, quantity - queue.quantity, 0);
+  else if (quantity < queue.quantity - EPSILON)
+    cancel_size(queue, queue.quantity - quantity);
+  queue.quantity = quantity;
+}
+
+void QueueBook::trade(Side side,
+                      double price,
+                      double quantity,
+                      int64_t timestamp) {
+  Flow& flow = flows[int(side)];
+  double elapsed = double(timestamp - flow.timestamp) / 1e9;
+  flow.quantity =
+      flow.quantity * std::exp(-elapsed / TRADE_RATE_WINDOW) + quantity;
+  flow.timestamp = timestamp;
+
+  // Orders at better prices than the trade were traded through. Filling one
+  // erases its entry in `resting`, so step past it first
+  int64_t tick = to_ticks(price);
+  Resting& side_resting = resting[int(side)];
+  auto first = side == Side::Bid ? side_resting.upper_bound(tick)
+                                 : side_resting.begin();
+  auto last = side == Side::Bid ? side_resting.end()
+                                : side_resting.lower_bound(tick);
+  while (first != last) {
+    Order& order = orders[(first++)->second];
+    fill(order, order.quantity);
+    erase_if_empty(side, order.tick);
+  }
+
+  auto it = queues[int(side)].find(tick);
+  if (it == queues[int(side)].end())
+    return;
+  Queue& queue = it->second;
+
+  // The trade takes the size of the market from the front of the queue. Our
+  // orders are not in the market's size, any of the trade left when it gets to
+  // one would have filled it instead of the size behind it
+  double left = quantity;
+  for (Node* node = queue.head; node != nullptr && left > EPSILON;) {
+    Node* next = node->next;
+    if (node->order != 0) {
+      fill(orders[node->order], left);
+    } else {
+      double taken = std::min(node->quantity, left);
+      node->quantity -= taken;
+      left -= taken;
+      if (node->quantity < EPSILON)
+        unlink(queue, node);
+    }
+    node = next;
+  }
+
+  // The level's next update reports the size the trade left, which must not
+  // count as a cancel
+  queue.quantity = std::max(queue.quantity - (quantity - left), 0.0);
+  erase_if_empty(side, tick);
+}
+
+void QueueBook::begin_snapshot() {
+  generation++;
+}
+
+void QueueBook::end_snapshot() {
+  for (auto& side_queues : queues) {
+    for (auto it = side_queues.begin(); it != side_queues.end();) {
+      Queue& queue = it->second;
+      if (queue.generation != generation)
+        remove_market(queue);
+      if (queue.head == nullptr && queue.quantity == 0)
+        it = side_queues.erase(it);
+      else
+        it++;
+    }
+  }
+}
+
+QueueBook::OrderId QueueBook::track(Side side, double price, double quantity) {
+  OrderId id = next_order++;
+  track(id, side, price, quantity);
+  return id;
+}
+
+void QueueBook::track(OrderId id, Side side, double price, double quantity) {
+  int64_t tick = to_ticks(price);
+  Queue& queue = queues[int(side)][tick];
+  queue.generation = generation;
+  orders[id] = {side, tick, quantity, 0, append(queue, quantity, id),
+                resting[int(side)].emplace(tick, id)};
+}
+
+void QueueBook::cancel(OrderId id) {
+  auto it = orders.find(id);
+  if (it == orders.end())
+    return;
+
+  Order& order = it->second;
+  if (order.node != nullptr) {
+    auto& side_queues = queues[int(order.side)];
+    auto queue = side_queues.find(order.tick);
+    unlink(queue->second, order.node);
+    resting[int(order.side)].erase(order.resting);
+    if (queue->second.head == nullptr && queue->second.quantity == 0)
+      side_queues.erase(queue);
+  }
+  orders.erase(it);
+}
+
+std::optional<QueuePosition> QueueBook::position(OrderId id) const {
+  auto it = orders.find(id);
+  if (it == orders.end())
+    return std::nullopt;
+
+  Order const& order = it->second;
+  if (order.node == nullptr)
+    return QueuePosition{0, 0, order.filled};
+
+  // Other tracked orders are not in the market, they are never ahead
+  double ahead = 0;
+  for (Node const* node = order.node->prev; node != nullptr; node = node->prev)
+    if (node->order == 0)
+      ahead += node->quantity;
+  return QueuePosition{ahead, order.node->quantity, order.filled};
+}
+
+double QueueBook::trade_rate(Side side) const {
+  return flows[int(side)].quantity / TRADE_RATE_WINDOW;
+}
+
+double QueueBook::fill_probability(OrderId id, double horizon) const {
+  auto position = this->position(id);
+  if (!position.has_value())
+    return 0;
+  return fill_probability(*position, trade_rate(orders.at(id).side), horizon);
+}
+
+double QueueBook::fill_probability(QueuePosition const& position,
+                                   double trade_rate,
+                                   double horizon) {
+  if (position.remaining < EPSILON)
+    return 1;
+
+  double traded = trade_rate * horizon;
+  if (traded <= 0)
+    return 0;
+  return std::exp(-(position.ahead + position.remaining) / traded);
+}
+
+size_t QueueBook::entries() const {
+  return nodes.size();
+}
+
+size_t QueueBook::levels() const {
+  return queues[0].size() + queues[1].size();
+}
@@ -0,0 +1,148 @@
+#ifndef queue_book
+#define queue_book
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+#include "level_storage.h"
+#include "slab_pool.h"
+
+// Time constant of the trade rate, in seconds.
+constexpr double TRADE_RATE_WINDOW = 60;
+
+// Where a tracked order stands in the queue of its level.
+typedef struct {
+  // Size resting ahead of the order.
+  double ahead;
+  // Size of the order which is still resting.
+  double remaining;
+  double filled;
+} QueuePosition;
+
+// Estimates the queue position of hypothetical orders of ours from the
+// aggregated levels and the trades of an instrument.
+//
+// Every level keeps a FIFO queue of the size events that made it up: an
+// increase of the level joins the back of the queue, a trade takes size from
+// the front and a decrease which no trade explains is taken as a cancel. A
+// cancel removes the latest event of exactly its size if there is one, as that
+// is most likely the same order leaving, and otherwise takes the size from
+// the back of the queue, which never moves an order of ours forward. Orders
+// which are tracked join the back of their level's queue like any other event
+// and are filled by the trades which reach them.
+//
+// Queue entries are intrusive list nodes handed out by a slab pool, so once
+// the pool has grown to the size of the book updates do not allocate.
+class QueueBook {
+ public:
+  typedef uint64_t OrderId;
+
+ private:
+  struct Node {
+    double quantity;
+    // 0 for size of the market, otherwise a tracked order.
+    OrderId order;
+    Node* prev;
+    Node* next;
+  };
+
+  struct Queue {
+    Node* head = nullptr;
+    Node* tail = nullptr;
+    // Size of the level as the market reported it, without tracked orders.
+    double quantity = 0;
+    // Snapshot the level was last seen in, see `begin_snapshot`.
+    uint64_t generation = 0;
+  };
+
+  // Unfilled tracked orders of one side by tick, so that a trade only visits
+  // the orders it traded through.
+  typedef std::multimap<int64_t, OrderId> Resting;
+
+  typedef struct {
+    Side side;
+    int64_t tick;
+    double quantity;
+    double filled;
+    // Null once the order is filled.
+    Node* node;
+    // Entry in `resting`, only valid while `node` is not null.
+    Resting::iterator resting;
+  } Order;
+
+  // Traded size of one side decaying over time, for the trade rate.
+  typedef struct {
+    double quantity;
+    int64_t timestamp;
+  } Flow;
+
+  double tick_size;
+  SlabPool<Node> nodes;
+  std::unordered_map<int64_t, Queue> queues[2];
+  std::unordered_map<OrderId, Order> orders;
+  Resting resting[2];
+  OrderId next_order;
+  uint64_t generation;
+  Flow flows[2];
+
+  int64_t to_ticks(double price) const;
+  // Whether a level at tick `a` is ahead of one at `b` when matching.
+  static bool better(Side side, int64_t a, int64_t b);
+
+  Node* append(Queue& queue, double quantity, OrderId order);
+  void unlink(Queue& queue, Node* node);
+  void cancel_size(Queue& queue, double quantity);
+  // Removes all of the market's size, leaving the tracked orders.
+  void remove_market(Queue& queue);
+  void fill(Order& order, double quantity);
+  // Drops the level's queue once it has neither size nor tracked orders.
+  void erase_if_empty(Side side, int64_t tick);
+
+ public:
+  QueueBook(double tick_size);
+
+  /* Fed from the market data */
+
+  // The level now has `quantity`, 0 removes it.
+  void set(Side side, double price, double quantity);
+  // `quantity` traded against the resting orders of `side` at `price`, at
+  // `timestamp` nanoseconds on any clock the caller keeps using.
+  void trade(Side side, double price, double quantity, int64_t timestamp);
+
+  // A snapshot is applied as a set of every level in it between these two,
+  // levels missing from it are removed. Queues survive a resync this way.
+  void begin_snapshot();
+  void end_snapshot();
+
+  /* Tracked orders */
+
+  // Places an order at the back of the level's queue.
+  OrderId track(Side side, double price, double quantity);
+  // Same under an id of the caller's, which must not be in use. Ids handed
+  // out by the other overload count up from 1, so use only one of them.
+  void track(OrderId id, Side side, double price, double quantity);
+  void cancel(OrderId id);
+  std::optional<QueuePosition> position(OrderId id) const;
+
+  // Size traded a second against a side, decaying with a time constant of
+  // `TRADE_RATE_WINDOW`, as of the last trade.
+  double trade_rate(Side side) const;
+  // Probability that the order is filled within `horizon` seconds. Traded size
+  // over the horizon is taken to be exponentially distributed around the
+  // side's trade rate, so this is the probability that it exceeds the size
+  // ahead of the order plus what is left of it.
+  double fill_probability(OrderId id, double horizon) const;
+  // Same for an order at `position` in a side trading at `trade_rate`.
+  static double fill_probability(QueuePosition const& position,
+                                 double trade_rate,
+                                 double horizon);
+
+  // Number of queue entries in use, for tests and stats.
+  size_t entries() const;
+  // Number of levels with a queue, for tests and stats.
+  size_t levels() const;
+};
+
+#endif  // queue_book
@@ -0,0 +1,92 @@
+#ifndef seqlock
+#define seqlock
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "cache_line.h"
+
+// Publishes a value from a single writer to any number of readers without
+// locks. Readers never block the writer, they retry when they raced with a
+// write instead.
+//
+// The value is stored as relaxed atomic words so that a read racing with a
+// write is a well defined (if torn) read which the version check discards.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ private:
+  static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+  // Odd while a write is in progress.
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> version;
+  std::atomic<uint64_t> words[WORDS];
+
+ public:
+  Seqlock();
+
+  // Number of values stored so far.
+  uint64_t sequence() const;
+
+  /* Writer side */
+  void store(T const& value);
+
+  /* Reader side */
+  // Returns false if a write was in progress or raced with the read.
+  bool try_load(T& value) const;
+  T load() const;
+};
+
+template <typename T>
+Seqlock<T>::Seqlock() : version(0) {
+  for (auto& word : words)
+    word.store(0, std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t Seqlock<T>::sequence() const {
+  return version.load(std::memory_order_acquire) / 2;
+}
+
+template <typename T>
+void Seqlock<T>::store(T const& value) {
+  uint64_t buffer[WORDS] = {};
+  std::memcpy(buffer, &value, sizeof(T));
+
+  uint64_t v = version.load(std::memory_order_relaxed);
+  version.store(v + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < WORDS; i++)
+    words[i].store(buffer[i], std::memory_order_relaxed);
+  version.store(v + 2, std::memory_order_release);
+}
+
+template <typename T>
+bool Seqlock<T>::try_load(T& value) const {
+  uint64_t before = version.load(std::memory_order_acquire);
+  if (before & 1)
+    return false;
+
+  uint64_t buffer[WORDS];
+  for (size_t i = 0; i < WORDS; i++)
+    buffer[i] = words[i].load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (version.load(std::memory_order_relaxed) != before)
+    return false;
+
+  std::memcpy(&value, buffer, sizeof(T));
+  return true;
+}
+
+template <typename T>
+T Seqlock<T>::load() const {
+  T value;
+  while (!try_load(value))
+    ;
+  return value;
+}
+
+#endif  // seqlock
@@ -0,0 +1,192 @@
+#include "shared_books.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace SharedBooks {
+
+static constexpr char MAGIC[8] = {'O', 'B', 'S', 'H', 'A', 'R', 'E', 'D'};
+static constexpr uint32_t VERSION = 1;
+
+static size_t align_up(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+RegionLayout layout_of(size_t capacity) {
+  size_t directory = align_up(sizeof(Header), CACHE_LINE_SIZE);
+  size_t slots = align_up(directory + capacity * sizeof(DirectoryEntry),
+                          alignof(Slot));
+  return {directory, slots, slots + capacity * sizeof(Slot)};
+}
+
+Publisher::Publisher(std::string const& name, size_t capacity)
+    : name(name), layout(layout_of(capacity)), region(nullptr) {
+  // Readers of an earlier region keep their mapping of it, they see it closed
+  // if its publisher went away cleanly
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Could not create shared memory " + name);
+  if (ftruncate(fd, layout.size) != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Could not size shared memory " + name);
+  }
+
+  void* data =
+      mmap(nullptr, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::runtime_error("Could not map shared memory " + name);
+  }
+  region = static_cast<std::byte*>(data);
+
+  for (size_t i = 0; i < capacity; i++)
+    new (&slots()[i]) Slot();
+  Header* header = new (region) Header();
+  header->version = VERSION;
+  header->capacity = capacity;
+  header->slot_size = sizeof(TopOfBook);
+  // Readers check the magic, it goes last
+  std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+Publisher::~Publisher() {
+  header().closed.store(1, std::memory_order_release);
+  munmap(region, layout.size);
+  shm_unlink(name.c_str());
+}
+
+Header& Publisher::header() {
+  return *reinterpret_cast<Header*>(region);
+}
+
+DirectoryEntry* Publisher::directory() {
+  return reinterpret_cast<DirectoryEntry*>(region + layout.directory);
+}
+
+Slot* Publisher::slots() {
+  return reinterpret_cast<Slot*>(region + layout.slots);
+}
+
+size_t Publisher::capacity() const {
+  return (layout.size - layout.slots) / sizeof(Slot);
+}
+
+void Publisher::add(SymbolId id, std::string_view symbol) {
+  if (id >= capacity())
+    throw std::runtime_error("Shared memory " + name + " is full");
+  if (symbol.size() >= SYMBOL_SIZE)
+    throw std::runtime_error("Symbol " + std::string(symbol) +
+                             " is too long for shared memory");
+
+  DirectoryEntry& entry = directory()[id];
+  std::memcpy(entry.symbol, symbol.data(), symbol.size());
+  entry.symbol[symbol.size()] = 0;
+
+  // Publishes the entry along with every one before it
+  uint32_t size = header().size.load(std::memory_order_relaxed);
+  header().size.store(std::max<uint32_t>(size, id + 1),
+                      std::memory_order_release);
+}
+
+void Publisher::publish(SymbolId id, TopOfBook const& top) {
+  if (id < capacity())
+    slots()[id].store(top);
+}
+
+Reader::Reader(std::string const& name) : region(nullptr) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    throw std::runtime_error("Could not open shared memory " + name);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(Header)) {
+    close(fd);
+    throw std::runtime_error(name + " does not hold books");
+  }
+  size_t size = info.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    throw std::runtime_error("Could not map shared memory " + name);
+  region = static_cast<std::byte const*>(data);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  Header const& header = this->header();
+  layout = layout_of(header.capacity);
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION || header.slot_size != sizeof(TopOfBook) ||
+      layout.size != size) {
+    munmap(data, size);
+    throw std::runtime_error(name + " does not hold books");
+  }
+}
+
+Reader::~Reader() {
+  munmap(const_cast<std::byte*>(region), layout.size);
+}
+
+Header const& Reader::header() const {
+  return *reinterpret_cast<Header const*>(region);
+}
+
+DirectoryEntry const* Reader::directory() const {
+  return reinterpret_cast<DirectoryEntry const*>(region + layout.directory);
+}
+
+Slot const* Reader::slots() const {
+  return reinterpret_cast<Slot const*>(region + layout.slots);
+}
+
+size_t Reader::size() const {
+  return header().size.load(std::memory_order_acquire);
+}
+
+bool Reader::closed() const {
+  return header().closed.load(std::memory_order_acquire) != 0;
+}
+
+std::optional<SymbolId> Reader::find(std::string_view symbol) const {
+  for (SymbolId id = 0; id < size(); id++)
+    if (this->symbol(id) == symbol)
+      return id;
+  return std::nullopt;
+}
+
+std::string_view Reader::symbol(SymbolId id) const {
+  if (id >= size())
+    return {};
+  char const* symbol = directory()[id].symbol;
+  return std::string_view(symbol, strnlen(symbol, SYMBOL_SIZE));
+}
+
+uint64_t Reader::sequence(SymbolId id) const {
+  if (id >= size())
+    return 0;
+  return slots()[id].sequence();
+}
+
+bool Reader::try_load(SymbolId id, TopOfBook& top) const {
+  if (id >= size())
+    return false;
+  return slots()[id].try_load(top);
+}
+
+TopOfBook Reader::load(SymbolId id) const {
+  if (id >= size())
+    return {};
+  return slots()[id].load();
+}
+
+}  // namespace SharedBooks
@@ -0,0 +1,132 @@
+#ifndef shared_books
+#define shared_books
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cache_line.h"
+#include "published_book.h"
+#include "seqlock.h"
+#include "symbol_table.h"
+
+// Mirrors the published books into POSIX shared memory, so that other
+// processes on the machine can read them without a FIX session of their own.
+//
+// The region starts with a header, followed by a directory of symbols and a
+// seqlock slot per book, both indexed by the book's symbol id. The publisher
+// writes each slot from the thread of the shard which owns the book, readers
+// map the region read only and load slots without any system call, retrying
+// when they raced with a write.
+namespace SharedBooks {
+
+// Longest symbol the directory holds, including the terminating 0.
+constexpr size_t SYMBOL_SIZE = 64;
+
+// Number of books a region holds unless asked otherwise.
+constexpr size_t DEFAULT_CAPACITY = 1024;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t capacity;
+  // Size of `TopOfBook` as the publisher was built with.
+  uint32_t slot_size;
+  // Number of directory entries readers may look at, only grows.
+  std::atomic<uint32_t> size;
+  // Set once the publisher has gone away, readers have to open the region
+  // again to see a new one.
+  std::atomic<uint32_t> closed;
+} Header;
+
+typedef struct {
+  char symbol[SYMBOL_SIZE];
+} DirectoryEntry;
+
+typedef Seqlock<TopOfBook> Slot;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "Shared memory needs address free atomics");
+
+// Where the parts of a region of `capacity` books start.
+typedef struct {
+  size_t directory;
+  size_t slots;
+  size_t size;
+} RegionLayout;
+
+RegionLayout layout_of(size_t capacity);
+
+// Creates the region `name`, replacing any region left by an earlier
+// publisher, and removes it again when destroyed.
+class Publisher {
+ private:
+  std::string name;
+  RegionLayout layout;
+  std::byte* region;
+
+  Header& header();
+  DirectoryEntry* directory();
+  Slot* slots();
+
+ public:
+  Publisher(std::string const& name, size_t capacity = DEFAULT_CAPACITY);
+  ~Publisher();
+
+  Publisher(Publisher const&) = delete;
+  Publisher& operator=(Publisher const&) = delete;
+
+  size_t capacity() const;
+
+  // Lists a book in the directory, before anything is published for it.
+  // Throws if `id` does not fit or the symbol is too long.
+  void add(SymbolId id, std::string_view symbol);
+  // Only ever called from one thread for each book.
+  void publish(SymbolId id, TopOfBook const& top);
+};
+
+// Maps a region created by a publisher, possibly in another process.
+class Reader {
+ private:
+  RegionLayout layout;
+  std::byte const* region;
+
+  Header const& header() const;
+  DirectoryEntry const* directory() const;
+  Slot const* slots() const;
+
+ public:
+  // Throws if there is no region `name` or it was written by another version.
+  Reader(std::string const& name);
+  ~Reader();
+
+  Reader(Reader const&) = delete;
+  Reader& operator=(Reader const&) = delete;
+
+  // Number of directory entries, books may be added while reading.
+  size_t size() const;
+  bool closed() const;
+
+  // Scans the directory, callers keep the id rather than look it up for
+  // every read.
+  std::optional<SymbolId> find(std::string_view symbol) const;
+  // Empty for ids which have no book.
+  std::string_view symbol(SymbolId id) const;
+
+  // Sequence of the book's last publication, a single load to tell whether
+  // it changed. 0 for ids which have no book.
+  uint64_t sequence(SymbolId id) const;
+  // Returns false if the read raced with a write, see `Seqlock::try_load`, or
+  // if `id` has no book.
+  bool try_load(SymbolId id, TopOfBook& top) const;
+  // An empty book for ids which have no book.
+  TopOfBook load(SymbolId id) const;
+};
+
+}  // namespace SharedBooks
+
+#endif  // shared_books
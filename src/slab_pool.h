@@ -0,0 +1,70 @@
+#ifndef slab_pool
+#define slab_pool
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Hands out objects carved from slabs of `SLAB_SIZE` objects. Released objects
+// go on a free list and are handed out again before a new slab is allocated,
+// slabs themselves are only freed with the pool. Objects never move, so they
+// can be linked to each other by pointer.
+template <typename T, size_t SLAB_SIZE = 1024>
+class SlabPool {
+ private:
+  std::vector<std::unique_ptr<T[]>> slabs;
+  // Objects handed out from the last slab.
+  size_t used;
+  std::vector<T*> released;
+
+ public:
+  SlabPool();
+
+  SlabPool(SlabPool const&) = delete;
+  SlabPool& operator=(SlabPool const&) = delete;
+
+  // Number of objects handed out and not released.
+  size_t size() const;
+  // Number of objects the slabs allocated so far hold.
+  size_t capacity() const;
+
+  // The object keeps whatever it held when it was released, callers assign
+  // all of it.
+  T* acquire();
+  void release(T* item);
+};
+
+template <typename T, size_t SLAB_SIZE>
+SlabPool<T, SLAB_SIZE>::SlabPool() : used(SLAB_SIZE) {}
+
+template <typename T, size_t SLAB_SIZE>
+size_t SlabPool<T, SLAB_SIZE>::size() const {
+  return capacity() - (SLAB_SIZE - used) - released.size();
+}
+
+template <typename T, size_t SLAB_SIZE>
+size_t SlabPool<T, SLAB_SIZE>::capacity() const {
+  return slabs.size() * SLAB_SIZE;
+}
+
+template <typename T, size_t SLAB_SIZE>
+T* SlabPool<T, SLAB_SIZE>::acquire() {
+  if (!released.empty()) {
+    T* item = released.back();
+    released.pop_back();
+    return item;
+  }
+
+  if (used == SLAB_SIZE) {
+    slabs.push_back(std::make_unique<T[]>(SLAB_SIZE));
+    used = 0;
+  }
+  return &slabs.back()[used++];
+}
+
+template <typename T, size_t SLAB_SIZE>
+void SlabPool<T, SLAB_SIZE>::release(T* item) {
+  released.push_back(item);
+}
+
+#endif  // slab_pool
@@ -0,0 +1,103 @@
+#ifndef spsc_queue
+#define spsc_queue
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+#include "cache_line.h"
+
+// A bounded lock-free queue for exactly one producer and one consumer thread.
+//
+// Each side keeps a cached copy of the other side's index and only reloads it
+// when the queue looks full (or empty), so in steady state a push or pop
+// touches no cache line owned by the other thread.
+template <typename T>
+class SpscQueue {
+ private:
+  size_t capacity;
+  size_t mask;
+  std::unique_ptr<T[]> items;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+  size_t cached_tail;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+  size_t cached_head;
+
+ public:
+  // Capacity is rounded up to a power of two.
+  SpscQueue(size_t capacity);
+
+  size_t max_size() const;
+  // Number of items in the queue, exact from either end and an estimate from
+  // any other thread.
+  size_t size() const;
+  bool empty() const;
+
+  /* Producer side */
+  bool try_push(T const& item);
+
+  /* Consumer side */
+  bool try_pop(T& item);
+};
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+    : capacity(std::bit_ceil(std::max<size_t>(capacity, 2))),
+      mask(this->capacity - 1),
+      items(std::make_unique<T[]>(this->capacity)),
+      head(0),
+      cached_tail(0),
+      tail(0),
+      cached_head(0) {}
+
+template <typename T>
+size_t SpscQueue<T>::max_size() const {
+  return capacity;
+}
+
+template <typename T>
+size_t SpscQueue<T>::size() const {
+  // The head never passes the tail, loading it first keeps the result sane.
+  size_t h = head.load(std::memory_order_acquire);
+  size_t t = tail.load(std::memory_order_acquire);
+  return t - h;
+}
+
+template <typename T>
+bool SpscQueue<T>::empty() const {
+  return size() == 0;
+}
+
+template <typename T>
+bool SpscQueue<T>::try_push(T const& item) {
+  size_t t = tail.load(std::memory_order_relaxed);
+  if (t - cached_head == capacity) {
+    cached_head = head.load(std::memory_order_acquire);
+    if (t - cached_head == capacity)
+      return false;
+  }
+
+  items[t & mask] = item;
+  tail.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::try_pop(T& item) {
+  size_t h = head.load(std::memory_order_relaxed);
+  if (h == cached_tail) {
+    cached_tail = tail.load(std::memory_order_acquire);
+    if (h == cached_tail)
+      return false;
+  }
+
+  item = items[h & mask];
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+#endif  // spsc_queue
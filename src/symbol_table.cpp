@@ -0,0 +1,65 @@
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+SymbolTable::SymbolTable(size_t capacity) : capacity(capacity), count(0) {
+  // Keep the load factor at or below a half so probe sequences stay short.
+  size_t slot_count = std::bit_ceil(std::max<size_t>(capacity * 2, 16));
+  names.reserve(capacity);
+  slots = std::make_unique<std::atomic<uint32_t>[]>(slot_count);
+  mask = slot_count - 1;
+}
+
+uint64_t SymbolTable::hash(std::string_view symbol) {
+  // FNV-1a, symbols are short so anything fancier does not pay off.
+  uint64_t h = 14695981039346656037ull;
+  for (char c : symbol) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+size_t SymbolTable::size() const {
+  return count.load(std::memory_order_acquire);
+}
+
+SymbolId SymbolTable::intern(std::string_view symbol) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (auto id = find(symbol); id.has_value())
+    return *id;
+  if (names.size() == capacity)
+    throw std::runtime_error("Symbol table is full");
+
+  // `names` never reallocates since it was reserved up front, so readers can
+  // index into it while we append.
+  SymbolId id = names.size();
+  names.emplace_back(symbol);
+
+  for (size_t i = hash(symbol) & mask;; i = (i + 1) & mask) {
+    if (slots[i].load(std::memory_order_relaxed) == 0) {
+      slots[i].store(id + 1, std::memory_order_release);
+      break;
+    }
+  }
+  count.store(id + 1, std::memory_order_release);
+
+  return id;
+}
+
+std::optional<SymbolId> SymbolTable::find(std::string_view symbol) const {
+  for (size_t i = hash(symbol) & mask;; i = (i + 1) & mask) {
+    uint32_t slot = slots[i].load(std::memory_order_acquire);
+    if (slot == 0)
+      return std::nullopt;
+    if (names[slot - 1] == symbol)
+      return slot - 1;
+  }
+}
+
+std::string const& SymbolTable::name(SymbolId id) const {
+  return names[id];
+}
@@ -0,0 +1,45 @@
+#ifndef symbol_table
+#define symbol_table
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dense identifier of an interned symbol, usable as an index.
+typedef uint32_t SymbolId;
+
+// Interns symbols into dense ids so that symbols are resolved once at the edge
+// and everything downstream is keyed by an index instead of a string.
+//
+// The table has a fixed capacity. Interning takes a lock but lookups are lock
+// free, so symbols can be added while other threads are resolving them.
+class SymbolTable {
+ private:
+  size_t capacity;
+  std::vector<std::string> names;
+  // Open addressed slots holding `id + 1`, zero marks an empty slot.
+  std::unique_ptr<std::atomic<uint32_t>[]> slots;
+  size_t mask;
+  std::atomic<uint32_t> count;
+  std::mutex mutex;
+
+  static uint64_t hash(std::string_view symbol);
+
+ public:
+  SymbolTable(size_t capacity);
+
+  size_t size() const;
+
+  // Returns the id of `symbol`, interning it if it was not seen before. Throws
+  // when the table is full.
+  SymbolId intern(std::string_view symbol);
+  std::optional<SymbolId> find(std::string_view symbol) const;
+  std::string const& name(SymbolId id) const;
+};
+
+#endif  // symbol_table
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/book_checkpoint.h"
+#include "../src/book_manager.h"
+
+static std::string temporary_path(char const* name) {
+  return testing::TempDir() + name + "-" + std::to_string(getpid());
+}
+
+TEST(BookCheckpoint, WritesAndReadsEntries) {
+  std::string path = temporary_path("checkpoint");
+  std::vector<Level> bids = {{100.0, 1}, {99.5, 2}};
+  std::vector<Level> asks = {{100.5, 3}};
+  std::vector<BookCheckpoint::Entry> entries = {
+      {"BTC-PERPETUAL", 7, bids, asks},
+      {"ETH-PERPETUAL", 0, {}, {}},
+  };
+  BookCheckpoint::write(path, entries);
+
+  BookCheckpoint::Reader reader(path);
+  EXPECT_EQ(reader.entries(), 2);
+  EXPECT_GT(reader.timestamp(), 0);
+
+  BookCheckpoint::Entry entry;
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.symbol, "BTC-PERPETUAL");
+  EXPECT_EQ(entry.sequence, 7);
+  ASSERT_EQ(entry.bids.size(), 2);
+  EXPECT_EQ(entry.bids[1].price, 99.5);
+  ASSERT_EQ(entry.asks.size(), 1);
+  EXPECT_EQ(entry.asks[0].quantity, 3);
+  ASSERT_TRUE(reader.next(entry));
+  EXPECT_EQ(entry.symbol, "ETH-PERPETUAL");
+  EXPECT_TRUE(entry.bids.empty());
+  EXPECT_FALSE(reader.next(entry));
+
+  std::remove(path.c_str());
+  EXPECT_THROW(BookCheckpoint::Reader{path}, std::runtime_error);
+}
+
+TEST(BookManager, RestoresStaleBooksFromCheckpoints) {
+  std::string path = temporary_path("books");
+  {
+    auto books = BookManager(2);
+    auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+    books.add_book("ETH-PERPETUAL", 0.05);
+    books.on_snapshot(btc, {.bids = {{100.0, 1}, {99.5, 2}},
+                            .asks = {{100.5, 3}}});
+    books.on_delta(btc, {.bids = {{OfferAction::Add, {99.0, 4}}}, .asks = {}});
+    books.flush();
+    books.save(path);
+  }
+
+  // Books are added in another order after the restart
+  auto books = BookManager(2);
+  auto eth = books.add_book("ETH-PERPETUAL", 0.05);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  // ETH never had anything published
+  EXPECT_EQ(books.restore(path), 1);
+  books.flush();
+
+  auto top = books.top_of_book(btc);
+  EXPECT_TRUE(top.stale);
+  // The restore is the book's first publication in this process
+  EXPECT_EQ(top.sequence, 1);
+  EXPECT_EQ(books.sequence(btc), top.sequence);
+  ASSERT_EQ(top.bid_count, 3);
+  EXPECT_EQ(top.bids[2].price, 99.0);
+  EXPECT_EQ(top.asks[0].quantity, 3);
+  EXPECT_EQ(books.top_of_book(eth).sequence, 0);
+
+  // Deltas are not applied to a restored book, a snapshot replaces it
+  books.on_delta(btc, {.bids = {{OfferAction::Add, {98.5, 1}}}, .asks = {}});
+  books.on_snapshot(btc, {.bids = {{101.0, 1}}, .asks = {}});
+  books.flush();
+  top = books.top_of_book(btc);
+  EXPECT_FALSE(top.stale);
+  EXPECT_EQ(top.bid_count, 1);
+  EXPECT_EQ(books.sync_stats(btc).dropped, 1);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <map>
+
+#include "../src/datasources/capture.h"
+#include "../tools/emulator/book_dynamics.h"
+
+// A book the way a client would keep it, every change has to be consistent
+// with what the client has seen so far.
+class ClientBook {
+ public:
+  std::map<double, double> bids;
+  std::map<double, double> asks;
+
+  void apply(BidAskSnapshot const& snapshot) {
+    for (auto const& offer : snapshot.bids)
+      bids[offer.price] = offer.quantity;
+    for (auto const& offer : snapshot.asks)
+      asks[offer.price] = offer.quantity;
+  }
+
+  void apply(BidAskDelta const& delta) {
+    for (bool bid : {true, false}) {
+      auto& levels = bid ? bids : asks;
+      for (auto const& change : bid ? delta.bids : delta.asks) {
+        EXPECT_EQ(levels.contains(change.offer.price),
+                  change.action != OfferAction::Add);
+        if (change.action == OfferAction::Remove)
+          levels.erase(change.offer.price);
+        else
+          levels[change.offer.price] = change.offer.quantity;
+      }
+    }
+  }
+
+  bool same(BookDynamics const& dynamics) const {
+    ClientBook expected;
+    BidAskSnapshot snapshot;
+    dynamics.snapshot(snapshot);
+    expected.apply(snapshot);
+    return bids == expected.bids && asks == expected.asks;
+  }
+};
+
+TEST(BookDynamics, SyntheticUpdatesAreConsistent) {
+  SyntheticDynamics dynamics(64000, 0.5, 50, 4, 1);
+
+  ClientBook book;
+  BidAskSnapshot snapshot;
+  dynamics.snapshot(snapshot);
+  book.apply(snapshot);
+  EXPECT_EQ(book.bids.size(), 50);
+
+  for (int i = 0; i < 5000; i++) {
+    BidAskDelta delta;
+    dynamics.next(delta);
+    EXPECT_GE(delta.bids.size() + delta.asks.size(), 4);
+    book.apply(delta);
+    ASSERT_LT(book.bids.rbegin()->first, book.asks.begin()->first);
+  }
+  EXPECT_TRUE(book.same(dynamics));
+
+  BidAskSnapshot top;
+  dynamics.snapshot(top, 10);
+  EXPECT_EQ(top.bids.size(), 10);
+  EXPECT_EQ(top.bids[0].price, book.bids.rbegin()->first);
+}
+
+TEST(BookDynamics, RecordedLoopsBackToFirstSnapshot) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "orderbook_book_dynamics.bin")
+                  .string();
+  std::filesystem::remove(path);
+  {
+    Capture::Writer writer(path);
+    writer.write("ETH-PERPETUAL", BidAskSnapshot{{{10, 1}}, {{11, 1}}}, 0);
+    writer.write("BTC-PERPETUAL", BidAskSnapshot{{{100, 1}}, {{101, 1}}}, 0);
+    writer.write("BTC-PERPETUAL",
+                 BidAskDelta{{{OfferAction::Add, {99, 2}}},
+                             {{OfferAction::Remove, {101, 0}},
+                              {OfferAction::Add, {102, 3}}}},
+                 1);
+    writer.write("BTC-PERPETUAL", BidAskSnapshot{{{98, 1}}, {{103, 1}}}, 2);
+  }
+
+  RecordedDynamics dynamics(path, "BTC-PERPETUAL");
+  ClientBook book;
+  BidAskSnapshot snapshot;
+  dynamics.snapshot(snapshot);
+  book.apply(snapshot);
+  EXPECT_EQ(book.bids.size(), 1);
+  EXPECT_EQ(book.bids.begin()->first, 100);
+
+  // The recorded delta, the second snapshot, then back to the first one
+  for (int i = 0; i < 9; i++) {
+    BidAskDelta delta;
+    dynamics.next(delta);
+    book.apply(delta);
+    EXPECT_TRUE(book.same(dynamics));
+    if (i % 3 == 0) {
+      EXPECT_EQ(book.bids.size(), 2);
+    } else if (i % 3 == 1) {
+      EXPECT_EQ(book.bids.begin()->first, 98);
+    }
+  }
+  EXPECT_EQ(book.bids.begin()->first, 100);
+  EXPECT_EQ(book.asks.begin()->first, 101);
+
+  EXPECT_THROW(RecordedDynamics(path, "SOL-PERPETUAL"), std::runtime_error);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,333 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/book_manager.h"
+
+TEST(SymbolTable, Intern) {
+  auto symbols = SymbolTable(4);
+
+  auto btc = symbols.intern("BTC-PERPETUAL");
+  auto eth = symbols.intern("ETH-PERPETUAL");
+
+  EXPECT_NE(btc, eth);
+  EXPECT_EQ(symbols.intern("BTC-PERPETUAL"), btc);
+  EXPECT_EQ(symbols.find("ETH-PERPETUAL"), eth);
+  EXPECT_EQ(symbols.find("SOL-PERPETUAL"), std::nullopt);
+  EXPECT_EQ(symbols.name(btc), "BTC-PERPETUAL");
+}
+
+TEST(SymbolTable, Full) {
+  auto symbols = SymbolTable(1);
+
+  symbols.intern("BTC-PERPETUAL");
+  EXPECT_THROW(symbols.intern("ETH-PERPETUAL"), std::runtime_error);
+}
+
+TEST(BookManager, RoutesUpdatesBySymbol) {
+  auto books = BookManager(2);
+
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  auto eth = books.add_book("ETH-PERPETUAL", 0.05);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {{100.5, 2}}});
+  books.on_snapshot(eth, {.bids = {{10.0, 3}}, .asks = {{10.05, 4}}});
+  books.on_delta(btc, {.bids = {{OfferAction::Add, {100.5, 5}}},
+                       .asks = {{OfferAction::Remove, {100.5, 0}},
+                                {OfferAction::Add, {101.0, 6}}}});
+  books.flush();
+
+  EXPECT_EQ(books.book(btc).best_bid().value().price, 100.5);
+  EXPECT_EQ(books.book(btc).best_ask().value().price, 101.0);
+  EXPECT_EQ(books.book(eth).best_bid().value().price, 10.0);
+  EXPECT_EQ(books.book(eth).best_ask().value().price, 10.05);
+}
+
+TEST(BookManager, AddsBooksFromAnyThread) {
+  auto books = BookManager(2, 64);
+  std::atomic<bool> done = false;
+
+  // Whatever id a reader sees has its book
+  std::thread reader([&] {
+    while (!done.load()) {
+      for (SymbolId id = 0; id < books.size(); id++) {
+        EXPECT_FALSE(books.symbol(id).empty());
+        EXPECT_EQ(books.top_of_book(id).sequence, 0);
+      }
+    }
+  });
+
+  // The adders race for the same symbols
+  std::vector<std::thread> adders;
+  for (int i = 0; i < 4; i++)
+    adders.emplace_back([&] {
+      for (int j = 0; j < 48; j++)
+        books.add_book("BOOK-" + std::to_string(j), 0.5);
+    });
+  for (auto& adder : adders)
+    adder.join();
+  done.store(true);
+  reader.join();
+
+  EXPECT_EQ(books.size(), 48);
+  for (int j = 0; j < 48; j++)
+    EXPECT_EQ(books.symbol(*books.find("BOOK-" + std::to_string(j))),
+              "BOOK-" + std::to_string(j));
+  for (int j = 48; j < 64; j++)
+    books.add_book("BOOK-" + std::to_string(j), 0.5);
+  EXPECT_THROW(books.add_book("BOOK-64", 0.5), std::runtime_error);
+}
+
+TEST(BookManager, QueueOverflow) {
+  auto books = BookManager(1, 16, 4);
+
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  BidAskSnapshot snapshot;
+  for (int i = 0; i < 1000; i++)
+    snapshot.bids.push_back({100.0 - i * 0.5, 1});
+  books.on_snapshot(btc, snapshot);
+  books.flush();
+
+  auto stats = books.stats(0);
+  EXPECT_EQ(stats.enqueued, 1000);
+  EXPECT_EQ(stats.applied, 1000);
+  EXPECT_EQ(stats.depth, 0);
+  EXPECT_LE(stats.max_depth, 4);
+  EXPECT_GT(stats.overflows, 0);
+  EXPECT_EQ(books.book(btc).best_bid().value().price, 100.0);
+}
+
+TEST(BookManager, PublishesTopOfBook) {
+  auto books = BookManager(1);
+
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  EXPECT_EQ(books.top_of_book(btc).sequence, 0);
+  EXPECT_EQ(books.top_of_book(btc).bid_count, 0);
+
+  BidAskSnapshot snapshot;
+  for (int i = 0; i < 30; i++) {
+    snapshot.bids.push_back({100.0 - i * 0.5, 1});
+    snapshot.asks.push_back({100.5 + i * 0.5, 2});
+  }
+  books.on_snapshot(btc, snapshot);
+  books.on_delta(btc, {.bids = {{OfferAction::Remove, {100.0, 0}}}, .asks = {}});
+  books.flush();
+
+  auto top = books.top_of_book(btc);
+  EXPECT_EQ(top.sequence, 2);
+  EXPECT_EQ(top.bid_count, TOP_OF_BOOK_DEPTH);
+  EXPECT_EQ(top.ask_count, TOP_OF_BOOK_DEPTH);
+  EXPECT_EQ(top.bids[0].price, 99.5);
+  EXPECT_EQ(top.asks[0].price, 100.5);
+  EXPECT_EQ(top.asks[TOP_OF_BOOK_DEPTH - 1].price, 110.0);
+}
+
+TEST(BookManager, WaitsForUpdates) {
+  auto books = BookManager(2);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  EXPECT_EQ(books.wait_for_updates(0, std::chrono::milliseconds(1)), 0);
+
+  std::thread feeder([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {{100.5, 2}}});
+  });
+  EXPECT_EQ(books.wait_for_updates(0, std::chrono::seconds(10)), 1);
+  feeder.join();
+  EXPECT_EQ(books.updates(), 1);
+}
+
+TEST(BookManager, SnapshotReplacesBook) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}, {99.5, 1}},
+                          .asks = {{100.5, 2}, {101.0, 2}}});
+  books.on_snapshot(btc, {.bids = {{99.0, 3}}, .asks = {{101.5, 4}}});
+  books.flush();
+
+  auto top = books.top_of_book(btc);
+  EXPECT_EQ(top.sequence, 2);
+  ASSERT_EQ(top.bid_count, 1);
+  ASSERT_EQ(top.ask_count, 1);
+  EXPECT_EQ(top.bids[0].price, 99.0);
+  EXPECT_EQ(top.asks[0].price, 101.5);
+
+  // An empty snapshot clears the book
+  books.on_snapshot(btc, {});
+  books.flush();
+  top = books.top_of_book(btc);
+  EXPECT_EQ(top.sequence, 3);
+  EXPECT_EQ(top.bid_count, 0);
+  EXPECT_EQ(top.ask_count, 0);
+  EXPECT_EQ(books.rebuild_stats(0).rebuilds, 3);
+}
+
+TEST(BookManager, RecoversFromSequenceGaps) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  std::vector<SymbolId> recovered;
+  books.attach_recovery_handler(
+      [&](SymbolId id) { recovered.push_back(id); });
+
+  auto delta = [](double price, uint64_t sequence) {
+    return BidAskDelta{.bids = {{OfferAction::Add, {price, 1}}},
+                       .asks = {},
+                       .sequence = sequence};
+  };
+
+  // Deltas before the first snapshot have nothing to apply to
+  books.on_delta(btc, delta(98.0, 4));
+  books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {}, .sequence = 5});
+  books.on_delta(btc, delta(99.5, 6));
+  books.on_delta(btc, delta(99.0, 6));
+  EXPECT_TRUE(recovered.empty());
+
+  books.on_delta(btc, delta(98.5, 8));
+  books.on_delta(btc, delta(98.0, 9));
+  EXPECT_EQ(recovered, std::vector<SymbolId>{btc});
+
+  auto sync = books.sync_stats(btc);
+  EXPECT_FALSE(sync.synced);
+  EXPECT_EQ(sync.recoveries, 1);
+  EXPECT_EQ(sync.dropped, 4);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}, {99.5, 1}},
+                          .asks = {},
+                          .sequence = 9});
+  books.on_delta(btc, delta(97.0, 10));
+  books.flush();
+
+  EXPECT_TRUE(books.sync_stats(btc).synced);
+  auto top = books.top_of_book(btc);
+  ASSERT_EQ(top.bid_count, 3);
+  EXPECT_EQ(top.bids[1].price, 99.5);
+  EXPECT_EQ(top.bids[2].price, 97.0);
+
+  // A delta whose entries are numbered each takes up all of their numbers
+  books.on_delta(btc, {.bids = {{OfferAction::Add, {96.5, 1}}},
+                       .asks = {},
+                       .sequence = 13,
+                       .first_sequence = 11});
+  books.on_delta(btc, delta(96.0, 14));
+  EXPECT_EQ(books.sync_stats(btc).recoveries, 1);
+  books.on_delta(btc, delta(95.5, 16));
+  EXPECT_EQ(books.sync_stats(btc).recoveries, 2);
+
+  // The datasource can tell that updates were lost without sequence numbers
+  books.invalidate(btc);
+  EXPECT_EQ(books.sync_stats(btc).recoveries, 3);
+  EXPECT_EQ(recovered.size(), 3);
+}
+
+TEST(BookManager, PublishesMetrics) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 3}, {99.5, 1}},
+                          .asks = {{100.5, 1}, {200.0, 100}}});
+  books.flush();
+
+  auto metrics = books.top_of_book(btc).metrics;
+  EXPECT_DOUBLE_EQ(metrics.microprice, (100.0 * 1 + 100.5 * 3) / 4);
+  EXPECT_DOUBLE_EQ(metrics.imbalance, (4.0 - 101) / 105);
+  // The far ask is well out of `METRICS_BPS`
+  EXPECT_EQ(metrics.bid_depth, 3);
+  EXPECT_EQ(metrics.ask_depth, 1);
+  EXPECT_DOUBLE_EQ(metrics.weighted_mid, (100.0 + 100.5) / 2);
+}
+
+TEST(BookManager, TracksQueuesOnlyWhenAsked) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5, {.queues = true});
+  auto eth = books.add_book("ETH-PERPETUAL", 0.05);
+  EXPECT_TRUE(books.has_queues(btc));
+  EXPECT_FALSE(books.has_queues(eth));
+  EXPECT_THROW(books.track(eth, Side::Bid, 10.0, 1), std::runtime_error);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 10}}, .asks = {{100.5, 5}}});
+  books.on_snapshot(eth, {.bids = {{10.0, 10}}, .asks = {}});
+  books.flush();
+  // Tracked while the shard runs, without flushing before reading
+  auto order = books.track(btc, Side::Bid, 100.0, 1);
+
+  // A sell of 4 takes the bid down to 6, which is no cancel
+  books.on_delta(btc, {.bids = {{OfferAction::Update, {100.0, 6}}},
+                       .asks = {},
+                       .trades = {{Aggressor::Seller, {100.0, 4}}}});
+  books.on_delta(eth, {.bids = {{OfferAction::Update, {10.0, 6}}},
+                       .asks = {},
+                       .trades = {{Aggressor::Seller, {10.0, 4}}}});
+  books.flush();
+
+  EXPECT_EQ(books.position(btc, order)->ahead, 6);
+  EXPECT_EQ(books.trade_rate(btc, Side::Bid), 4 / TRADE_RATE_WINDOW);
+  EXPECT_GT(books.fill_probability(btc, order, 60), 0);
+  EXPECT_EQ(books.trade_rate(eth, Side::Bid), 0);
+  EXPECT_EQ(books.top_of_book(btc).bids[0].quantity, 6);
+  EXPECT_EQ(books.top_of_book(eth).bids[0].quantity, 6);
+
+  books.cancel(btc, order);
+  books.flush();
+  EXPECT_FALSE(books.position(btc, order).has_value());
+  EXPECT_EQ(books.fill_probability(btc, order, 60), 0);
+}
+
+TEST(BookManager, LimitsTrackedOrders) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5, {.queues = true});
+  books.on_snapshot(btc, {.bids = {{100.0, 10}}, .asks = {{100.5, 5}}});
+  books.flush();
+
+  std::vector<QueueBook::OrderId> orders;
+  for (size_t i = 0; i < MAX_TRACKED_ORDERS; i++)
+    orders.push_back(books.track(btc, Side::Ask, 100.5, 1));
+  EXPECT_THROW(books.track(btc, Side::Ask, 100.5, 1), std::runtime_error);
+
+  // A slot is free again once the cancel is applied
+  books.cancel(btc, orders.front());
+  books.flush();
+  auto order = books.track(btc, Side::Ask, 100.5, 1);
+  books.flush();
+  // Our orders are hypothetical, they never stand ahead of each other
+  EXPECT_EQ(books.position(btc, order)->ahead, 5);
+}
+
+TEST(BookManager, RefreshesBooksWithDepthInPlace) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5, {.depth = 10});
+  EXPECT_EQ(books.depth(btc), 10);
+
+  std::vector<SymbolId> recovered;
+  books.attach_recovery_handler(
+      [&](SymbolId id) { recovered.push_back(id); });
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}, {99.5, 2}},
+                          .asks = {{100.5, 1}}});
+  books.on_snapshot(btc, {.bids = {{99.5, 3}, {99.0, 2}}, .asks = {}});
+  books.flush();
+
+  auto top = books.top_of_book(btc);
+  ASSERT_EQ(top.bid_count, 2);
+  EXPECT_EQ(top.bids[0].price, 99.5);
+  EXPECT_EQ(top.bids[0].quantity, 3);
+  EXPECT_EQ(top.ask_count, 0);
+  EXPECT_EQ(books.rebuild_stats(0).rebuilds, 0);
+
+  // Switching to the whole book asks for a new subscription, whose snapshot
+  // is rebuilt as usual
+  books.set_depth(btc, 0);
+  EXPECT_EQ(recovered, std::vector<SymbolId>{btc});
+  EXPECT_FALSE(books.sync_stats(btc).synced);
+  books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {}});
+  books.on_delta(btc, {.bids = {{OfferAction::Add, {99.0, 1}}}, .asks = {}});
+  books.flush();
+
+  EXPECT_EQ(books.top_of_book(btc).bid_count, 2);
+  EXPECT_EQ(books.rebuild_stats(0).rebuilds, 1);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/datasources/capture.h"
+#include "../src/datasources/replay.h"
+
+// A capture file in the temporary directory, removed once the test is done.
+class CaptureFile {
+ public:
+  std::string path;
+
+  CaptureFile()
+      : path((std::filesystem::temp_directory_path() /
+              ("orderbook_capture_" +
+               std::string(::testing::UnitTest::GetInstance()
+                               ->current_test_info()
+                               ->name()) +
+               ".bin"))
+                 .string()) {
+    std::filesystem::remove(path);
+  }
+
+  ~CaptureFile() { std::filesystem::remove(path); }
+};
+
+TEST(Capture, RoundTrip) {
+  CaptureFile file;
+  {
+    Capture::Writer writer(file.path);
+    writer.write("BTC-PERPETUAL",
+                 BidAskSnapshot{{{100, 1}, {99.5, 2}}, {{100.5, 3}}}, 1000);
+    writer.write("ETH-PERPETUAL",
+                 BidAskDelta{{{OfferAction::Remove, {10, 0}}},
+                             {{OfferAction::Add, {11, 4}},
+                              {OfferAction::Update, {12, 5}}}},
+                 2000);
+    writer.write("BTC-PERPETUAL",
+                 BidAskDelta{.bids = {{OfferAction::Update, {100, 0.5}}},
+                             .asks = {},
+                             .trades = {{Aggressor::Seller, {100, 0.5}},
+                                        {Aggressor::Unknown, {99.5, 2}}}},
+                 3000);
+  }
+
+  Capture::Reader reader(file.path);
+  Capture::Record record;
+  BidAskSnapshot snapshot;
+  BidAskDelta delta;
+
+  ASSERT_TRUE(reader.next(record, snapshot, delta));
+  EXPECT_EQ(record.kind, Capture::RecordKind::Snapshot);
+  EXPECT_EQ(record.timestamp, 1000);
+  EXPECT_EQ(record.symbol, "BTC-PERPETUAL");
+  ASSERT_EQ(snapshot.bids.size(), 2);
+  ASSERT_EQ(snapshot.asks.size(), 1);
+  EXPECT_EQ(snapshot.bids[1].price, 99.5);
+  EXPECT_EQ(snapshot.asks[0].quantity, 3);
+
+  ASSERT_TRUE(reader.next(record, snapshot, delta));
+  EXPECT_EQ(record.kind, Capture::RecordKind::Delta);
+  EXPECT_EQ(record.symbol, "ETH-PERPETUAL");
+  ASSERT_EQ(delta.bids.size(), 1);
+  ASSERT_EQ(delta.asks.size(), 2);
+  EXPECT_EQ(delta.bids[0].action, OfferAction::Remove);
+  EXPECT_EQ(delta.asks[1].action, OfferAction::Update);
+  EXPECT_EQ(delta.asks[1].offer.price, 12);
+  EXPECT_TRUE(delta.trades.empty());
+
+  // Trades are kept for books which track queues
+  ASSERT_TRUE(reader.next(record, snapshot, delta));
+  EXPECT_EQ(record.timestamp, 3000);
+  ASSERT_EQ(delta.bids.size(), 1);
+  EXPECT_TRUE(delta.asks.empty());
+  ASSERT_EQ(delta.trades.size(), 2);
+  EXPECT_EQ(delta.trades[0].aggressor, Aggressor::Seller);
+  EXPECT_EQ(delta.trades[0].offer.quantity, 0.5);
+  EXPECT_EQ(delta.trades[1].aggressor, Aggressor::Unknown);
+  EXPECT_EQ(delta.trades[1].offer.price, 99.5);
+
+  EXPECT_FALSE(reader.next(record, snapshot, delta));
+}
+
+TEST(Capture, AppendsAndStopsAtTruncatedRecord) {
+  CaptureFile file;
+  BidAskDelta delta = {{{OfferAction::Add, {1, 1}}}, {}};
+  for (int i = 0; i < 3; i++) {
+    Capture::Writer writer(file.path);
+    writer.write("BTC-PERPETUAL", delta, i);
+  }
+
+  // Cut the last record short as a crash in the middle of a write would
+  std::filesystem::resize_file(file.path,
+                               std::filesystem::file_size(file.path) - 4);
+
+  Capture::Reader reader(file.path);
+  Capture::Record record;
+  BidAskSnapshot snapshot;
+  size_t count = 0;
+  while (reader.next(record, snapshot, delta))
+    EXPECT_EQ(record.timestamp, count++);
+  EXPECT_EQ(count, 2);
+}
+
+TEST(Capture, RejectsOtherFiles) {
+  CaptureFile file;
+  std::ofstream(file.path) << "8=FIX.4.4|9=12|35=0|";
+
+  EXPECT_THROW(Capture::Reader reader(file.path), std::runtime_error);
+  EXPECT_THROW(Capture::Writer writer(file.path), std::runtime_error);
+}
+
+TEST(Replay, FeedsHandlers) {
+  CaptureFile file;
+  {
+    Capture::Writer writer(file.path);
+    writer.write("BTC-PERPETUAL", BidAskSnapshot{{{100, 1}}, {{101, 1}}}, 0);
+    for (int i = 1; i <= 10; i++)
+      writer.write("BTC-PERPETUAL",
+                   BidAskDelta{{{OfferAction::Update, {100, double(i)}}}, {}},
+                   i * 2000000);
+    // Not followed, it is skipped
+    writer.write("SOL-PERPETUAL", BidAskSnapshot{{{10, 1}}, {}}, 20000000);
+  }
+
+  SymbolTable symbols(4);
+  symbols.intern("ETH-PERPETUAL");
+  auto btc = symbols.intern("BTC-PERPETUAL");
+
+  for (bool paced : {false, true}) {
+    Replay source(file.path, paced);
+    source.attach_symbols(symbols);
+    size_t snapshots = 0;
+    std::vector<double> quantities;
+    source.attach_bid_ask_snapshot_handler(
+        [&](SymbolId id, BidAskSnapshot const&) {
+          EXPECT_EQ(id, btc);
+          snapshots++;
+        });
+    source.attach_bid_ask_delta_handler(
+        [&](SymbolId, BidAskDelta const& delta) {
+          quantities.push_back(delta.bids[0].offer.quantity);
+        });
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(source.replay_all(), 12);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(snapshots, 1);
+    ASSERT_EQ(quantities.size(), 10);
+    EXPECT_EQ(quantities.back(), 10);
+    // The last update was received 20ms after the first one
+    if (paced) {
+      EXPECT_GE(elapsed, std::chrono::milliseconds(20));
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../src/book_manager.h"
+#include "../src/consolidated_book.h"
+
+TEST(ConsolidatedBook, MergesSourcesWithTheirBasis) {
+  ConsolidatedBook book(0.5);
+  auto perpetual = book.add_source(0, 0);
+  // The future trades 10 over the perpetual
+  auto future = book.add_source(1, -10);
+
+  std::vector<Level> bids = {{100.0, 1}, {99.5, 2}};
+  book.update(perpetual, Side::Bid, bids, false);
+  bids = {{110.0, 3}, {109.0, 4}};
+  book.update(future, Side::Bid, bids, false);
+
+  ConsolidatedLevel levels[4];
+  ASSERT_EQ(book.best_levels(Side::Bid, levels), 3);
+  EXPECT_EQ(levels[0].price, 100.0);
+  EXPECT_EQ(levels[0].quantity, 4);
+  EXPECT_EQ(levels[0].sources, 2);
+  EXPECT_EQ(levels[1].price, 99.5);
+  EXPECT_EQ(levels[2].price, 99.0);
+  EXPECT_FALSE(book.best(Side::Ask).has_value());
+
+  // Only the levels which changed move
+  bids = {{110.0, 3}, {109.5, 1}};
+  book.update(future, Side::Bid, bids, false);
+  ASSERT_EQ(book.best_levels(Side::Bid, levels), 2);
+  EXPECT_EQ(levels[0].quantity, 4);
+  EXPECT_EQ(levels[1].price, 99.5);
+  EXPECT_EQ(levels[1].quantity, 3);
+  EXPECT_EQ(levels[1].sources, 2);
+
+  book.set_basis(future, -9.5);
+  EXPECT_EQ(book.best(Side::Bid)->price, 100.5);
+  EXPECT_EQ(book.best(Side::Bid)->quantity, 3);
+
+  book.update(perpetual, Side::Bid, {}, false);
+  book.update(future, Side::Bid, {}, false);
+  EXPECT_FALSE(book.best(Side::Bid).has_value());
+}
+
+TEST(ConsolidatedBook, StopsAtTheHorizon) {
+  ConsolidatedBook book(0.5);
+  auto a = book.add_source(0, 0);
+  auto b = book.add_source(1, 0);
+
+  std::vector<Level> asks = {{100.0, 1}, {100.5, 1}};
+  book.update(a, Side::Ask, asks, true);
+  asks = {{100.0, 1}, {101.0, 1}, {102.0, 1}};
+  book.update(b, Side::Ask, asks, false);
+
+  // `a` may have size at 101 which it did not publish
+  ConsolidatedLevel levels[4];
+  ASSERT_EQ(book.best_levels(Side::Ask, levels), 2);
+  EXPECT_EQ(levels[0].quantity, 2);
+  EXPECT_EQ(levels[1].price, 100.5);
+}
+
+TEST(ConsolidatedBook, PollsChangedBooks) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  auto future = books.add_book("BTC-27DEC24", 0.5);
+
+  ConsolidatedBook book(0.5);
+  book.add_source(btc, 0);
+  book.add_source(future, -50);
+  EXPECT_EQ(book.poll(books), 0);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {{100.5, 1}}});
+  books.on_snapshot(future, {.bids = {{150.0, 2}}, .asks = {}});
+  books.flush();
+  EXPECT_EQ(book.poll(books), 2);
+  EXPECT_EQ(book.best(Side::Bid)->quantity, 3);
+
+  books.on_delta(future,
+                 {.bids = {{OfferAction::Remove, {150.0, 0}}}, .asks = {}});
+  books.flush();
+  EXPECT_EQ(book.poll(books), 1);
+  EXPECT_EQ(book.best(Side::Bid)->quantity, 1);
+  EXPECT_EQ(book.best(Side::Ask)->price, 100.5);
+}
+
+TEST(ConsolidatedBook, PollsRestoredBooksOnce) {
+  std::string path =
+      testing::TempDir() + "consolidated-" + std::to_string(getpid());
+  {
+    auto books = BookManager(1);
+    auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+    for (int i = 0; i < 3; i++)
+      books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {{100.5, 1}}});
+    books.flush();
+    books.save(path);
+  }
+
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  ConsolidatedBook book(0.5);
+  book.add_source(btc, 0);
+  EXPECT_EQ(books.restore(path), 1);
+  books.flush();
+
+  EXPECT_EQ(book.poll(books), 1);
+  EXPECT_EQ(book.best(Side::Bid)->price, 100.0);
+  // Nothing was published since
+  EXPECT_EQ(book.poll(books), 0);
+
+  books.on_snapshot(btc, {.bids = {{99.5, 2}}, .asks = {}});
+  books.flush();
+  EXPECT_EQ(book.poll(books), 1);
+  EXPECT_EQ(book.best(Side::Bid)->price, 99.5);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <quickfix/DataDictionary.h>
+#include <quickfix/fix44/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix44/MarketDataSnapshotFullRefresh.h>
+#include <quickfix/fix44/SecurityList.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/datasources/deribit.h"
+#include "../src/datasources/fix_scanner.h"
+
+static FIX::DataDictionary const& dictionary() {
+  static FIX::DataDictionary dictionary(SPEC_DIR "/DERIBIT_FIX44.xml");
+  return dictionary;
+}
+
+// Messages are written with '|' in place of SOH for readability.
+static std::string fix(std::string message) {
+  std::replace(message.begin(), message.end(), '|', FixScanner::SOH);
+  return message;
+}
+
+TEST(Deribit, DecodersAgreeOnRptSeq) {
+  std::string_view symbol;
+
+  // Every entry is numbered
+  auto raw_delta = fix(
+      "8=FIX.4.4|9=10|35=X|49=DERIBITSERVER|56=CLIENT|34=4|"
+      "52=20240101-00:00:00.000|55=BTC-PERPETUAL|268=3|"
+      "279=0|269=0|270=64122.5|271=30|83=41|"
+      "279=2|269=1|270=64124|271=0|83=42|"
+      "279=0|269=2|270=64123.5|271=10|54=2|83=43|10=000|");
+  BidAskDelta scanned_delta;
+  ASSERT_TRUE(FixScanner::decode_delta(raw_delta, symbol, scanned_delta));
+
+  FIX44::MarketDataIncrementalRefresh incremental;
+  incremental.setString(raw_delta, false, &dictionary());
+  BidAskDelta delta;
+  Deribit::Fix::decode(incremental, delta);
+  EXPECT_EQ(delta.first_sequence, 41);
+  EXPECT_EQ(delta.sequence, 43);
+  EXPECT_TRUE(FixScanner::same(scanned_delta, delta));
+
+  // Only the body is numbered
+  auto raw_snapshot = fix(
+      "8=FIX.4.4|9=10|35=W|49=DERIBITSERVER|56=CLIENT|34=5|"
+      "52=20240101-00:00:00.000|55=BTC-PERPETUAL|83=44|268=2|"
+      "269=0|270=64122.5|271=30|269=1|270=64124|271=5|10=000|");
+  BidAskSnapshot scanned_snapshot;
+  ASSERT_TRUE(
+      FixScanner::decode_snapshot(raw_snapshot, symbol, scanned_snapshot));
+
+  FIX44::MarketDataSnapshotFullRefresh full_refresh;
+  full_refresh.setString(raw_snapshot, false, &dictionary());
+  BidAskSnapshot snapshot;
+  Deribit::Fix::decode(full_refresh, snapshot);
+  EXPECT_EQ(snapshot.sequence, 44);
+  EXPECT_TRUE(FixScanner::same(scanned_snapshot, snapshot));
+}
+
+TEST(Deribit, MatchesInstrumentFilters) {
+  Deribit::Instrument future = {"BTC-27DEC24", "FUT", "BTC", "20241227", 2.5};
+  Deribit::Instrument perpetual = {"ETH-PERPETUAL", "FUT", "ETH", "", 0.05};
+
+  // Empty fields match anything
+  EXPECT_TRUE(Deribit::matches({}, future));
+  EXPECT_TRUE(Deribit::matches({.currency = "BTC"}, future));
+  EXPECT_FALSE(Deribit::matches({.currency = "BTC"}, perpetual));
+  EXPECT_TRUE(Deribit::matches({.kind = "FUT"}, perpetual));
+  EXPECT_FALSE(Deribit::matches({.kind = "OPT"}, perpetual));
+  EXPECT_TRUE(Deribit::matches(
+      {.currency = "BTC", .kind = "FUT", .expiry = "20241227"}, future));
+  EXPECT_FALSE(Deribit::matches(
+      {.currency = "BTC", .kind = "FUT", .expiry = "20250328"}, future));
+}
+
+TEST(Deribit, DecodesSecurityLists) {
+  auto path =
+      (std::filesystem::temp_directory_path() / "orderbook_test").string();
+  std::istringstream config(
+      "[DEFAULT]\n"
+      "ConnectionType=initiator\n"
+      "FileStorePath=" + path + "\n"
+      "FileLogPath=" + path + "\n"
+      "[SESSION]\n"
+      "BeginString=FIX.4.4\n"
+      "SenderCompID=CLIENT\n"
+      "TargetCompID=DERIBITSERVER\n");
+  Deribit::Fix application{FIX::SessionSettings(config)};
+  FIX::SessionID session_id("FIX.4.4", "CLIENT", "DERIBITSERVER");
+
+  std::vector<Deribit::Instrument> instruments;
+  size_t lists = 0;
+  application.attach_instruments_handler(
+      [&](std::vector<Deribit::Instrument> const& list) {
+        instruments = list;
+        lists++;
+      });
+
+  // The list comes in two fragments, handed on once complete
+  FIX44::SecurityList fragment;
+  fragment.setString(
+      fix("8=FIX.4.4|9=10|35=y|49=DERIBITSERVER|56=CLIENT|34=2|"
+          "52=20240101-00:00:00.000|320=1|322=1|560=0|146=1|"
+          "55=BTC-27DEC24|167=FUT|15=BTC|541=20241227|969=2.5|893=N|"
+          "10=000|"),
+      false, &dictionary());
+  application.onMessage(fragment, session_id);
+  EXPECT_EQ(lists, 0);
+
+  FIX44::SecurityList last;
+  last.setString(
+      fix("8=FIX.4.4|9=10|35=y|49=DERIBITSERVER|56=CLIENT|34=3|"
+          "52=20240101-00:00:00.000|320=1|322=1|560=0|146=2|"
+          "55=ETH-PERPETUAL|167=FUT|15=ETH|969=0.05|"
+          "55=BTC_USDC|167=SPOT|15=BTC|893=Y|10=000|"),
+      false, &dictionary());
+  application.onMessage(last, session_id);
+  ASSERT_EQ(lists, 1);
+  ASSERT_EQ(instruments.size(), 3);
+
+  EXPECT_EQ(instruments[0].symbol, "BTC-27DEC24");
+  EXPECT_EQ(instruments[0].kind, "FUT");
+  EXPECT_EQ(instruments[0].currency, "BTC");
+  EXPECT_EQ(instruments[0].expiry, "20241227");
+  EXPECT_EQ(instruments[0].tick_size, 2.5);
+  EXPECT_EQ(instruments[1].symbol, "ETH-PERPETUAL");
+  EXPECT_EQ(instruments[1].expiry, "");
+  EXPECT_EQ(instruments[1].tick_size, 0.05);
+  // Instruments without a tick size are not followed
+  EXPECT_EQ(instruments[2].kind, "SPOT");
+  EXPECT_EQ(instruments[2].tick_size, 0);
+}
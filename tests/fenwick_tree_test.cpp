@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include "../src/fenwick_tree.h"
+
+TEST(FenwickTree, Prefix) {
+  FenwickTree tree(100);
+  tree.add(3, 1, 10, 100);
+  tree.add(50, 1, 5, 150);
+  tree.add(99, 1, 1, 200);
+
+  EXPECT_EQ(tree.prefix(3).levels, 0);
+  EXPECT_EQ(tree.prefix(4).levels, 1);
+  EXPECT_EQ(tree.prefix(51).quantity, 15);
+  EXPECT_EQ(tree.prefix(51).notional, 10 * 100 + 5 * 150);
+  EXPECT_EQ(tree.prefix(100).levels, 3);
+
+  tree.add(50, -1, -5, 150);
+  EXPECT_EQ(tree.prefix(100).levels, 2);
+  EXPECT_EQ(tree.prefix(100).quantity, 11);
+
+  tree.clear();
+  EXPECT_EQ(tree.prefix(100).levels, 0);
+}
+
+TEST(FenwickTree, Search) {
+  FenwickTree tree(100);
+  tree.add(3, 1, 10, 100);
+  tree.add(50, 1, 5, 150);
+  tree.add(99, 1, 1, 200);
+
+  Depth total;
+  // The slot at the returned count is the one which tips the total over
+  EXPECT_EQ(tree.search([](Depth const& d) { return d.quantity < 12; }, total),
+            50);
+  EXPECT_EQ(total.quantity, 10);
+  EXPECT_EQ(tree.search([](Depth const& d) { return d.levels < 1; }, total),
+            3);
+  EXPECT_EQ(tree.search([](Depth const& d) { return d.levels < 10; }, total),
+            100);
+  EXPECT_EQ(total.levels, 3);
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "../src/datasources/fix_scanner.h"
+
+// Messages are written with '|' in place of SOH for readability.
+static std::string fix(std::string message) {
+  std::replace(message.begin(), message.end(), '|', FixScanner::SOH);
+  return message;
+}
+
+TEST(FixScanner, ParseFixed) {
+  EXPECT_EQ(FixScanner::parse_fixed("64123.5"), 6412350000000);
+  EXPECT_EQ(FixScanner::parse_fixed("0.0005"), 50000);
+  EXPECT_EQ(FixScanner::parse_fixed("-1.25"), -125000000);
+  EXPECT_EQ(FixScanner::parse_fixed("10"), 1000000000);
+  EXPECT_EQ(FixScanner::parse_fixed(".5"), 50000000);
+  EXPECT_EQ(FixScanner::parse_fixed("1.1234567800"), 112345678);
+
+  EXPECT_EQ(FixScanner::parse_fixed(""), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_fixed("."), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_fixed("1.123456789"), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_fixed("1e5"), std::nullopt);
+
+  EXPECT_EQ(FixScanner::to_double(*FixScanner::parse_fixed("0.1")), 0.1);
+  EXPECT_EQ(FixScanner::to_double(*FixScanner::parse_fixed("64123.5")),
+            64123.5);
+}
+
+TEST(FixScanner, ToDoubleMatchesStrtod) {
+  // Past 2^53 once scaled the division alone is no longer exact
+  std::mt19937_64 random(7);
+  for (std::string integer : {"0", "1", "64123", "90071992", "1234567890",
+                              "-1234567890", "9999999999"}) {
+    for (int i = 0; i < 1000; i++) {
+      auto value = integer + "." + std::to_string(random() % 100000000);
+      EXPECT_EQ(FixScanner::to_double(*FixScanner::parse_fixed(value)),
+                std::strtod(value.c_str(), nullptr))
+          << value;
+    }
+  }
+}
+
+TEST(FixScanner, ParseTimestamp) {
+  // 2024-03-01 12:34:56 UTC
+  constexpr int64_t SECONDS = 1709296496;
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301-12:34:56"),
+            SECONDS * 1000000000);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301-12:34:56.789"),
+            SECONDS * 1000000000 + 789000000);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301-12:34:56.123456789"),
+            SECONDS * 1000000000 + 123456789);
+
+  EXPECT_EQ(FixScanner::parse_timestamp(""), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301"), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240230-12:34:56"), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301-12:34:56."), std::nullopt);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301-12:34:56.1234567890"),
+            std::nullopt);
+  EXPECT_EQ(FixScanner::parse_timestamp("20240301 12:34:56"), std::nullopt);
+}
+
+TEST(FixScanner, ParseFixedMatchesScalar) {
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> integers(0, 9999999999);
+  std::uniform_int_distribution<int> decimals(0, 9);
+  for (int i = 0; i < 100000; i++) {
+    auto value = std::to_string(integers(rng) >> decimals(rng) * 3);
+    if (int count = decimals(rng); count > 0)
+      value += "." + std::to_string(integers(rng)).substr(0, count);
+    EXPECT_EQ(FixScanner::parse_fixed(value),
+              FixScanner::parse_fixed_scalar(value))
+        << value;
+  }
+
+  for (auto value : {"", ".", "1.2.3", "12a", "-5", "123456789.5", " 1"})
+    EXPECT_EQ(FixScanner::parse_fixed(value),
+              FixScanner::parse_fixed_scalar(value))
+        << value;
+}
+
+TEST(FixScanner, FindSoh) {
+  std::string raw(300, 'x');
+  for (size_t pos : {0, 1, 63, 64, 65, 130, 299}) {
+    raw[pos] = FixScanner::SOH;
+    for (size_t from = 0; from <= pos; from += 7)
+      EXPECT_EQ(FixScanner::find_soh(raw, from), pos);
+    raw[pos] = 'x';
+  }
+  EXPECT_EQ(FixScanner::find_soh(raw, 0), raw.size());
+  EXPECT_EQ(FixScanner::find_soh_scalar(raw, 0), raw.size());
+}
+
+TEST(FixScanner, DecodeSnapshot) {
+  auto raw = fix(
+      "8=FIX.4.4|9=200|35=W|49=DERIBITSERVER|56=CLIENT|34=3|"
+      "52=20240101-00:00:00.000|55=BTC-PERPETUAL|231=1|311=index|"
+      "268=4|269=0|270=64123.5|271=1000|269=0|270=64123|271=20|"
+      "269=1|270=64124|271=500|269=2|270=64123.5|271=10|10=000|");
+
+  std::string_view symbol;
+  BidAskSnapshot snapshot;
+  ASSERT_TRUE(FixScanner::decode_snapshot(raw, symbol, snapshot));
+
+  EXPECT_EQ(symbol, "BTC-PERPETUAL");
+  ASSERT_EQ(snapshot.bids.size(), 2);
+  ASSERT_EQ(snapshot.asks.size(), 1);
+  EXPECT_EQ(snapshot.bids[0].price, 64123.5);
+  EXPECT_EQ(snapshot.bids[0].quantity, 1000);
+  EXPECT_EQ(snapshot.bids[1].price, 64123);
+  EXPECT_EQ(snapshot.asks[0].price, 64124);
+  EXPECT_EQ(snapshot.asks[0].quantity, 500);
+}
+
+TEST(FixScanner, DecodeDelta) {
+  auto raw = fix(
+      "8=FIX.4.4|9=200|35=X|49=DERIBITSERVER|56=CLIENT|34=4|"
+      "52=20240101-00:00:00.000|55=BTC-PERPETUAL|268=3|"
+      "279=0|269=0|270=64122.5|271=30|"
+      "279=2|269=1|270=64124|271=0|"
+      "279=0|269=2|270=64123.5|271=10|54=2|10=000|");
+
+  std::string_view symbol;
+  BidAskDelta delta;
+  ASSERT_TRUE(FixScanner::decode_delta(raw, symbol, delta));
+
+  EXPECT_EQ(symbol, "BTC-PERPETUAL");
+  ASSERT_EQ(delta.bids.size(), 1);
+  ASSERT_EQ(delta.asks.size(), 1);
+  EXPECT_EQ(delta.bids[0].action, OfferAction::Add);
+  EXPECT_EQ(delta.bids[0].offer.price, 64122.5);
+  EXPECT_EQ(delta.bids[0].offer.quantity, 30);
+  EXPECT_EQ(delta.asks[0].action, OfferAction::Remove);
+  EXPECT_EQ(delta.asks[0].offer.price, 64124);
+  ASSERT_EQ(delta.trades.size(), 1);
+  EXPECT_EQ(delta.trades[0].aggressor, Aggressor::Seller);
+  EXPECT_EQ(delta.trades[0].offer.price, 64123.5);
+  EXPECT_EQ(delta.trades[0].offer.quantity, 10);
+}
+
+TEST(FixScanner, DecodeRptSeq) {
+  std::string_view symbol;
+  BidAskDelta delta;
+  ASSERT_TRUE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=X|55=BTC-PERPETUAL|268=2|"
+          "279=0|269=0|270=1|271=1|83=41|279=0|269=0|270=2|271=1|83=42|"
+          "10=000|"),
+      symbol, delta));
+  // The delta takes up the numbers of all of its entries
+  EXPECT_EQ(delta.first_sequence, 41);
+  EXPECT_EQ(delta.sequence, 42);
+
+  // Entries of a message are numbered one after the other
+  BidAskDelta gapped;
+  EXPECT_FALSE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=X|55=BTC-PERPETUAL|268=2|"
+          "279=0|269=0|270=1|271=1|83=41|279=0|269=0|270=2|271=1|83=43|"
+          "10=000|"),
+      symbol, gapped));
+
+  BidAskDelta unnumbered;
+  ASSERT_TRUE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=X|55=BTC-PERPETUAL|268=1|279=0|269=0|270=1|"
+          "271=1|10=000|"),
+      symbol, unnumbered));
+  EXPECT_EQ(unnumbered.sequence, 0);
+  EXPECT_EQ(unnumbered.first_sequence, 0);
+  EXPECT_FALSE(FixScanner::same(delta, unnumbered));
+
+  BidAskSnapshot snapshot;
+  EXPECT_FALSE(FixScanner::decode_snapshot(
+      fix("8=FIX.4.4|9=10|35=W|55=BTC-PERPETUAL|83=x|268=0|10=000|"), symbol,
+      snapshot));
+}
+
+TEST(FixScanner, RejectsWhatItCannotDecode) {
+  std::string_view symbol;
+  BidAskDelta delta;
+
+  // Wrong message type
+  EXPECT_FALSE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=W|55=BTC-PERPETUAL|268=0|10=000|"), symbol,
+      delta));
+  // Unknown update action
+  EXPECT_FALSE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=X|55=BTC-PERPETUAL|268=1|279=5|269=0|270=1|"
+          "271=1|10=000|"),
+      symbol, delta));
+  // Missing price
+  EXPECT_FALSE(FixScanner::decode_delta(
+      fix("8=FIX.4.4|9=10|35=X|55=BTC-PERPETUAL|268=1|279=0|269=0|271=1|"
+          "10=000|"),
+      symbol, delta));
+}
+
+TEST(FixScanner, Same) {
+  BidAskDelta a = {.bids = {{OfferAction::Add, {0.1 + 0.2, 1}}}, .asks = {}};
+  BidAskDelta b = {.bids = {{OfferAction::Add, {0.3, 1}}}, .asks = {}};
+  BidAskDelta c = {.bids = {{OfferAction::Update, {0.3, 1}}}, .asks = {}};
+
+  EXPECT_TRUE(FixScanner::same(a, b));
+  EXPECT_FALSE(FixScanner::same(b, c));
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../src/frame_diff.h"
+
+TEST(NumberCell, FormatsFixedWidth) {
+  NumberCell cell(2, 10);
+  EXPECT_EQ(cell.format(64123.5), "  64123.50");
+  EXPECT_EQ(cell.format(0.125), "      0.12");
+  EXPECT_EQ(cell.clear(), "          ");
+  EXPECT_EQ(cell.format(0.125), "      0.12");
+
+  // Numbers wider than the cell are not cut
+  EXPECT_EQ(NumberCell(1, 4).format(123456), "123456.0");
+}
+
+TEST(Frame, WritesOnlyChangedRows) {
+  Frame frame;
+  std::string out;
+
+  frame.update("a\r\nb\r\nc");
+  EXPECT_EQ(frame.flush(out), 3);
+  EXPECT_EQ(out, "\x1b[?25l\x1b[2J\x1b[1;1Ha\x1b[2;1Hb\x1b[3;1Hc");
+
+  out.clear();
+  frame.update("a\r\nb\r\nc");
+  EXPECT_EQ(frame.flush(out), 0);
+  EXPECT_EQ(out, "");
+
+  frame.update("a\r\nB\r\nc");
+  EXPECT_EQ(frame.flush(out), 1);
+  EXPECT_EQ(out, "\x1b[2;1HB");
+}
+
+TEST(Frame, RedrawsWhenInvalidatedOrShrunk) {
+  Frame frame;
+  std::string out;
+  frame.update("a\nb");
+  frame.flush(out);
+
+  out.clear();
+  frame.invalidate();
+  EXPECT_EQ(frame.flush(out), 2);
+
+  out.clear();
+  frame.update("a");
+  EXPECT_EQ(frame.flush(out), 1);
+  EXPECT_EQ(out, "\x1b[?25l\x1b[2J\x1b[1;1Ha");
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+
+#include "../src/hdr_histogram.h"
+
+TEST(HdrHistogram, BucketsKeepRelativeError) {
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 100000; i++) {
+    uint64_t value = rng() >> (rng() % 64);
+    size_t index = HdrHistogram::index_of(value);
+    ASSERT_LT(index, HdrHistogram::BUCKETS);
+    uint64_t highest = HdrHistogram::highest_equivalent(index);
+    ASSERT_GE(highest, value);
+    ASSERT_LE(highest - value, value / 64);
+  }
+  EXPECT_EQ(HdrHistogram::index_of(127), 127u);
+  EXPECT_EQ(HdrHistogram::index_of(~uint64_t(0)), HdrHistogram::BUCKETS - 1);
+}
+
+TEST(HdrHistogram, Percentiles) {
+  auto histogram = std::make_unique<HdrHistogram>();
+  EXPECT_EQ(histogram->value_at(50), 0u);
+
+  for (uint64_t value = 1; value <= 10000; value++)
+    histogram->record(value);
+
+  EXPECT_EQ(histogram->count(), 10000u);
+  EXPECT_EQ(histogram->max(), 10000u);
+  EXPECT_DOUBLE_EQ(histogram->mean(), 5000.5);
+  EXPECT_NEAR(histogram->value_at(50), 5000, 5000 / 64);
+  EXPECT_NEAR(histogram->value_at(99), 9900, 9900 / 64);
+  EXPECT_EQ(histogram->value_at(100), 10000u);
+}
+
+TEST(HdrHistogram, Merge) {
+  auto a = std::make_unique<HdrHistogram>();
+  auto b = std::make_unique<HdrHistogram>();
+  for (uint64_t value = 0; value < 100; value++) {
+    a->record(value);
+    b->record(value + 100);
+  }
+  a->merge(*b);
+
+  EXPECT_EQ(a->count(), 200u);
+  EXPECT_EQ(a->max(), 199u);
+  EXPECT_EQ(a->value_at(50), 99u);
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/datasources/journal.h"
+
+// A directory in the temporary directory, removed once the test is done.
+class JournalDirectory {
+ public:
+  std::filesystem::path path;
+
+  JournalDirectory()
+      : path(std::filesystem::temp_directory_path() /
+             ("orderbook_journal_" +
+              std::string(::testing::UnitTest::GetInstance()
+                              ->current_test_info()
+                              ->name()))) {
+    std::filesystem::remove_all(path);
+  }
+
+  ~JournalDirectory() { std::filesystem::remove_all(path); }
+
+  std::string file(std::string const& name) const {
+    return (path / name).string();
+  }
+};
+
+static std::vector<std::string> read_all(std::string const& path) {
+  Journal::Reader reader(path);
+  Journal::Record record;
+  std::vector<std::string> messages;
+  while (reader.next(record))
+    messages.emplace_back(record.data);
+  return messages;
+}
+
+TEST(Journal, RoundTrip) {
+  JournalDirectory directory;
+  auto path = directory.file("session.log");
+  {
+    Journal::Writer writer;
+    Journal::File* file = writer.open(path);
+    writer.append(file, Journal::RecordKind::Stored, 7, "8=FIX.4.4|35=V|");
+    writer.append(file, Journal::RecordKind::Event, 0, "Logon");
+    writer.flush();
+
+    Journal::Reader reader(path);
+    Journal::Record record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.kind, Journal::RecordKind::Stored);
+    EXPECT_EQ(record.sequence, 7u);
+    EXPECT_EQ(record.data, "8=FIX.4.4|35=V|");
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.kind, Journal::RecordKind::Event);
+    EXPECT_EQ(record.data, "Logon");
+    EXPECT_FALSE(reader.next(record));
+
+    // Everything queued is written before the writer goes away
+    writer.append(file, Journal::RecordKind::Incoming, 0, "35=X");
+  }
+  EXPECT_EQ(read_all(path),
+            (std::vector<std::string>{"8=FIX.4.4|35=V|", "Logon", "35=X"}));
+
+  // Reopening appends
+  {
+    Journal::Writer writer;
+    writer.append(writer.open(path), Journal::RecordKind::Incoming, 0, "35=W");
+  }
+  EXPECT_EQ(read_all(path).size(), 4u);
+
+  EXPECT_TRUE(read_all(directory.file("missing.log")).empty());
+}
+
+TEST(Journal, ManyThreads) {
+  JournalDirectory directory;
+  auto path = directory.file("session.log");
+  constexpr int threads = 4;
+  constexpr int count = 10000;
+  {
+    Journal::Writer writer(64);
+    Journal::File* file = writer.open(path);
+    std::vector<std::thread> appenders;
+    for (int t = 0; t < threads; t++)
+      appenders.emplace_back([&writer, file, t] {
+        for (int i = 0; i < count; i++) {
+          writer.append(file, Journal::RecordKind::Outgoing, t,
+                        std::to_string(i));
+          // Flushes from several threads wait for their own request
+          if (i % 1000 == 999)
+            writer.flush();
+        }
+      });
+    for (auto& appender : appenders)
+      appender.join();
+  }
+
+  Journal::Reader reader(path);
+  Journal::Record record;
+  std::vector<int> next(threads, 0);
+  while (reader.next(record))
+    ASSERT_EQ(record.data, std::to_string(next[record.sequence]++));
+  EXPECT_EQ(next, std::vector<int>(threads, count));
+}
+
+TEST(Journal, WakesIdleWriter) {
+  JournalDirectory directory;
+  auto path = directory.file("session.log");
+  Journal::Writer writer;
+  Journal::File* file = writer.open(path);
+
+  // Long enough for the background thread to go to sleep
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  writer.append(file, Journal::RecordKind::Incoming, 0, "35=0");
+  writer.flush();
+  EXPECT_EQ(read_all(path), std::vector<std::string>{"35=0"});
+}
+
+TEST(Journal, TruncateAndBackup) {
+  JournalDirectory directory;
+  auto path = directory.file("session.log");
+  {
+    Journal::Writer writer;
+    Journal::File* file = writer.open(path);
+    writer.append(file, Journal::RecordKind::Event, 0, "first");
+    writer.truncate(file);
+    writer.append(file, Journal::RecordKind::Event, 0, "second");
+    writer.backup(file);
+    writer.append(file, Journal::RecordKind::Event, 0, "third");
+  }
+  EXPECT_EQ(read_all(path), std::vector<std::string>{"third"});
+  EXPECT_EQ(read_all(path + ".1"), std::vector<std::string>{"second"});
+}
+
+TEST(Journal, SequencesPersist) {
+  JournalDirectory directory;
+  auto path = directory.file("session.seqnums");
+  {
+    Journal::Sequences sequences(path);
+    EXPECT_EQ(sequences.next_sender(), 1u);
+    EXPECT_EQ(sequences.next_target(), 1u);
+    EXPECT_GT(sequences.creation_time(), 0);
+    sequences.set_next_sender(5);
+    sequences.set_next_target(1234);
+  }
+  {
+    Journal::Sequences sequences(path);
+    EXPECT_EQ(sequences.next_sender(), 5u);
+    EXPECT_EQ(sequences.next_target(), 1234u);
+    sequences.reset(42);
+  }
+  Journal::Sequences sequences(path);
+  EXPECT_EQ(sequences.next_sender(), 1u);
+  EXPECT_EQ(sequences.next_target(), 1u);
+  EXPECT_EQ(sequences.creation_time(), 42);
+}
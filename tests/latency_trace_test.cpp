@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "../src/book_manager.h"
+#include "../src/latency_trace.h"
+
+#ifdef ORDERBOOK_LATENCY_TRACE
+
+TEST(LatencyTrace, RecordsAppliedUpdates) {
+  {
+    BookManager books(1);
+    SymbolId id = books.add_book("BTC-PERPETUAL", 0.5);
+
+    LatencyTrace::received(LatencyTrace::now());
+    books.on_snapshot(id, {{{100, 1}}, {{101, 1}}});
+    books.flush();
+  }
+
+  std::ostringstream out;
+  LatencyTrace::dump(out);
+  std::istringstream lines(out.str());
+  std::string line;
+  bool found = false;
+  while (std::getline(lines, line)) {
+    std::istringstream fields(line);
+    std::string stage;
+    uint64_t count = 0;
+    if (fields >> stage >> count && stage == "tick-to-book") {
+      EXPECT_GE(count, 1u);
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found) << out.str();
+}
+
+#else
+
+TEST(LatencyTrace, CompiledOut) {
+  static_assert(!LatencyTrace::ENABLED);
+  static_assert(std::is_empty_v<LatencyTrace::QueueStamps>);
+
+  // The stamps take no space in the queued records
+  EXPECT_EQ(sizeof(BookRecord), offsetof(BookRecord, offer) + sizeof(Offer));
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/mpsc_queue.h"
+
+TEST(MpscQueue, PushPop) {
+  auto queue = MpscQueue<std::string>(3);
+
+  EXPECT_EQ(queue.max_size(), 4);
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(queue.try_push(std::to_string(i)));
+
+  // A failed push leaves the item alone
+  std::string item = "4";
+  EXPECT_FALSE(queue.try_push(std::move(item)));
+  EXPECT_EQ(item, "4");
+  EXPECT_EQ(queue.size(), 4);
+
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_pop(item));
+    EXPECT_EQ(item, std::to_string(i));
+  }
+  EXPECT_FALSE(queue.try_pop(item));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueue, ManyProducers) {
+  auto queue = MpscQueue<uint64_t>(64);
+  constexpr uint64_t producers = 4;
+  constexpr uint64_t count = 50000;
+
+  std::vector<std::thread> threads;
+  for (uint64_t p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, p] {
+      for (uint64_t i = 0; i < count; i++) {
+        uint64_t item = p << 32 | i;
+        while (!queue.try_push(std::move(item)))
+          std::this_thread::yield();
+      }
+    });
+  }
+
+  // Items of each producer come out in the order they were pushed
+  std::vector<uint64_t> next(producers, 0);
+  for (uint64_t received = 0; received < producers * count;) {
+    uint64_t item;
+    if (!queue.try_pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    uint64_t p = item >> 32;
+    ASSERT_LT(p, producers);
+    ASSERT_EQ(item & 0xffffffff, next[p]++);
+    received++;
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <map>
+
 #include "../src/orderbook.h"
 
 TEST(OrderBook, AddLevel) {
@@ -33,3 +36,277 @@ TEST(OrderBook, Spread) {
 
   EXPECT_EQ(ob.spread(), 1.1 - 1.0);
 }
+
+TEST(OrderBook, RemoveBestLevel) {
+  auto ob = OrderBook(0.5);
+
+  ob.add_level(Level{.price = 100.0, .quantity = 1}, Side::Bid);
+  ob.add_level(Level{.price = 99.0, .quantity = 2}, Side::Bid);
+  ob.add_level(Level{.price = 101.0, .quantity = 3}, Side::Ask);
+  ob.add_level(Level{.price = 103.5, .quantity = 4}, Side::Ask);
+
+  ob.remove_level(100.0, Side::Bid);
+  ob.remove_level(101.0, Side::Ask);
+
+  EXPECT_EQ(ob.best_bid().value().price, 99.0);
+  EXPECT_EQ(ob.best_ask().value().price, 103.5);
+
+  ob.remove_level(99.0, Side::Bid);
+  EXPECT_FALSE(ob.best_bid().has_value());
+}
+
+TEST(OrderBook, TopN) {
+  auto ob = OrderBook(0.5);
+
+  for (int i = 0; i < 10; i++) {
+    ob.add_level(Level{.price = 100.0 - i, .quantity = 1.0 + i}, Side::Bid);
+    ob.add_level(Level{.price = 101.0 + i, .quantity = 1.0 + i}, Side::Ask);
+  }
+
+  auto [bids, asks] = ob.top_n(3);
+
+  ASSERT_EQ(bids.size(), 3);
+  ASSERT_EQ(asks.size(), 3);
+  EXPECT_EQ(bids[0].price, 100.0);
+  EXPECT_EQ(bids[2].price, 98.0);
+  EXPECT_EQ(asks[0].price, 101.0);
+  EXPECT_EQ(asks[2].price, 103.0);
+}
+
+TEST(OrderBook, LevelsOutsideLadder) {
+  auto ob = OrderBook(0.5, 64);
+
+  ob.add_level(Level{.price = 100.0, .quantity = 1}, Side::Bid);
+  ob.add_level(Level{.price = 10.0, .quantity = 2}, Side::Bid);
+  ob.add_level(Level{.price = 500.0, .quantity = 3}, Side::Bid);
+
+  EXPECT_EQ(ob.best_bid().value().price, 500.0);
+
+  ob.remove_level(500.0, Side::Bid);
+  EXPECT_EQ(ob.best_bid().value().price, 100.0);
+
+  ob.remove_level(100.0, Side::Bid);
+  EXPECT_EQ(ob.best_bid().value().price, 10.0);
+}
+
+TEST(OrderBook, ApplyCoalescesChanges) {
+  auto ob = OrderBook(0.5);
+  ob.add_level({100.0, 1}, Side::Bid);
+  ob.add_level({99.5, 1}, Side::Bid);
+  ob.add_level({101.0, 1}, Side::Ask);
+
+  ob.apply({.bids = {{OfferAction::Remove, {100.0, 0}},
+                     {OfferAction::Add, {100.5, 2}},
+                     {OfferAction::Update, {100.5, 3}},
+                     {OfferAction::Add, {99.0, 4}},
+                     {OfferAction::Remove, {99.0, 0}}},
+            .asks = {{OfferAction::Remove, {101.0, 0}},
+                     {OfferAction::Add, {101.0, 5}}}});
+
+  Level bids[4];
+  ASSERT_EQ(ob.best_levels(Side::Bid, bids), 2);
+  EXPECT_EQ(bids[0].price, 100.5);
+  EXPECT_EQ(bids[0].quantity, 3);
+  EXPECT_EQ(bids[1].price, 99.5);
+  EXPECT_EQ(ob.best_ask().value().price, 101.0);
+  EXPECT_EQ(ob.best_ask().value().quantity, 5);
+}
+
+TEST(OrderBook, ReplaceKeepsOnlyTheRefresh) {
+  auto ob = OrderBook(0.5);
+  ob.replace({.bids = {{100.0, 1}, {99.5, 2}, {99.0, 3}},
+              .asks = {{100.5, 1}, {101.0, 2}}});
+  // The price moves up a tick, out of order refreshes are fine as well
+  ob.replace({.bids = {{100.5, 4}, {100.0, 1}, {99.5, 5}},
+              .asks = {{101.5, 3}, {101.0, 2}}});
+
+  Level bids[4];
+  ASSERT_EQ(ob.best_levels(Side::Bid, bids), 3);
+  EXPECT_EQ(bids[0].price, 100.5);
+  EXPECT_EQ(bids[0].quantity, 4);
+  EXPECT_EQ(bids[1].quantity, 1);
+  EXPECT_EQ(bids[2].price, 99.5);
+  EXPECT_EQ(bids[2].quantity, 5);
+  Level asks[4];
+  ASSERT_EQ(ob.best_levels(Side::Ask, asks), 2);
+  EXPECT_EQ(asks[0].price, 101.0);
+  EXPECT_EQ(asks[1].price, 101.5);
+  EXPECT_EQ(ob.depth(Side::Bid, 3).quantity, 10);
+
+  ob.replace({});
+  EXPECT_FALSE(ob.best_bid().has_value());
+  EXPECT_FALSE(ob.best_ask().has_value());
+}
+
+TEST(OrderBook, Metrics) {
+  auto ob = OrderBook(0.5);
+  EXPECT_FALSE(ob.microprice().has_value());
+  EXPECT_FALSE(ob.imbalance(5).has_value());
+
+  ob.add_level({100.0, 3}, Side::Bid);
+  ob.add_level({99.5, 5}, Side::Bid);
+  ob.add_level({99.0, 10}, Side::Bid);
+  ob.add_level({100.5, 1}, Side::Ask);
+  ob.add_level({101.0, 1}, Side::Ask);
+
+  // Leans towards the ask, which has less size
+  EXPECT_DOUBLE_EQ(ob.microprice().value(), (100.0 * 1 + 100.5 * 3) / 4);
+  EXPECT_DOUBLE_EQ(ob.imbalance(2).value(), (8.0 - 2) / 10);
+
+  auto depth = ob.depth(Side::Bid, 2);
+  EXPECT_EQ(depth.levels, 2);
+  EXPECT_EQ(depth.quantity, 8);
+
+  // 50 bps of 100 reaches down to 99.5
+  depth = ob.depth_within(Side::Bid, 50);
+  EXPECT_EQ(depth.levels, 2);
+  EXPECT_EQ(depth.notional, 100.0 * 3 + 99.5 * 5);
+
+  auto fill = ob.fill(Side::Bid, 10);
+  EXPECT_EQ(fill.levels, 3);
+  EXPECT_EQ(fill.quantity, 10);
+  EXPECT_EQ(fill.notional, 100.0 * 3 + 99.5 * 5 + 99.0 * 2);
+  EXPECT_EQ(ob.fill(Side::Ask, 10).quantity, 2);
+
+  EXPECT_DOUBLE_EQ(ob.weighted_mid(50).value(),
+                   ((100.0 * 3 + 99.5 * 5) / 8 + (100.5 + 101.0) / 2) / 2);
+}
+
+template <typename T>
+class OrderBookStorage : public testing::Test {};
+
+typedef testing::Types<OrderBook, MapOrderBook, FlatOrderBook, RadixOrderBook>
+    OrderBookTypes;
+TYPED_TEST_SUITE(OrderBookStorage, OrderBookTypes);
+
+TYPED_TEST(OrderBookStorage, MatchesOrderedMap) {
+  auto ob = TypeParam(1, 128);
+  std::map<double, Level> bids, asks;
+
+  std::srand(42);
+  for (int i = 0; i < 100000; i++) {
+    bool bid = std::rand() % 2;
+    double price = bid ? 1000 - std::rand() % 4000 : 1001 + std::rand() % 4000;
+    auto& side = bid ? bids : asks;
+
+    if (std::rand() % 3 == 0) {
+      ob.remove_level(price, bid ? Side::Bid : Side::Ask);
+      side.erase(price);
+    } else {
+      Level level{.price = price, .quantity = double(i)};
+      ob.add_level(level, bid ? Side::Bid : Side::Ask);
+      side[price] = level;
+    }
+
+    ASSERT_EQ(ob.best_bid().has_value(), !bids.empty());
+    ASSERT_EQ(ob.best_ask().has_value(), !asks.empty());
+    if (!bids.empty()) {
+      ASSERT_EQ(ob.best_bid().value().price, bids.rbegin()->first);
+    }
+    if (!asks.empty()) {
+      ASSERT_EQ(ob.best_ask().value().price, asks.begin()->first);
+    }
+  }
+
+  auto [top_bids, top_asks] = ob.top_n(1000);
+  auto bid_it = bids.rbegin();
+  for (auto const& level : top_bids) {
+    EXPECT_EQ(level.price, bid_it->first);
+    EXPECT_EQ(level.quantity, bid_it->second.quantity);
+    bid_it++;
+  }
+  auto ask_it = asks.begin();
+  for (auto const& level : top_asks) {
+    EXPECT_EQ(level.price, ask_it->first);
+    EXPECT_EQ(level.quantity, ask_it->second.quantity);
+    ask_it++;
+  }
+}
+
+TYPED_TEST(OrderBookStorage, ApplyMatchesEntryByEntry) {
+  auto batched = TypeParam(1, 128);
+  auto single = TypeParam(1, 128);
+
+  std::srand(7);
+  for (int i = 0; i < 10000; i++) {
+    // Few distinct prices so that messages often touch a price twice
+    BidAskDelta delta;
+    int entries = 1 + std::rand() % 8;
+    for (int j = 0; j < entries; j++) {
+      bool bid = std::rand() % 2;
+      double price = bid ? 1000 - std::rand() % 16 : 1001 + std::rand() % 16;
+      OfferChange change = {
+          std::rand() % 3 == 0 ? OfferAction::Remove : OfferAction::Update,
+          {price, double(i * 8 + j)}};
+      (bid ? delta.bids : delta.asks).push_back(change);
+
+      Side side = bid ? Side::Bid : Side::Ask;
+      if (change.action == OfferAction::Remove)
+        single.remove_level(price, side);
+      else
+        single.add_level({price, change.offer.quantity}, side);
+    }
+    batched.apply(delta);
+
+    ASSERT_EQ(batched.best_bid().has_value(), single.best_bid().has_value());
+    ASSERT_EQ(batched.best_ask().has_value(), single.best_ask().has_value());
+  }
+
+  auto [batched_bids, batched_asks] = batched.top_n(100);
+  auto [single_bids, single_asks] = single.top_n(100);
+  ASSERT_EQ(batched_bids.size(), single_bids.size());
+  ASSERT_EQ(batched_asks.size(), single_asks.size());
+  for (size_t i = 0; i < batched_bids.size(); i++) {
+    EXPECT_EQ(batched_bids[i].price, single_bids[i].price);
+    EXPECT_EQ(batched_bids[i].quantity, single_bids[i].quantity);
+  }
+  for (size_t i = 0; i < batched_asks.size(); i++) {
+    EXPECT_EQ(batched_asks[i].price, single_asks[i].price);
+    EXPECT_EQ(batched_asks[i].quantity, single_asks[i].quantity);
+  }
+}
+
+TYPED_TEST(OrderBookStorage, MetricsMatchLadder) {
+  // A window of a few blocks, narrow enough that queries often run into the
+  // ladder's overflow map
+  auto ob = TypeParam(1, 256);
+  auto over_ladder = OrderBook(1, 256);
+
+  std::srand(11);
+  for (int i = 0; i < 20000; i++) {
+    bool bid = std::rand() % 2;
+    double price = bid ? 1000 - std::rand() % 200 : 1001 + std::rand() % 200;
+    Side side = bid ? Side::Bid : Side::Ask;
+    if (std::rand() % 3 == 0) {
+      ob.remove_level(price, side);
+      over_ladder.remove_level(price, side);
+    } else {
+      ob.add_level({price, double(i % 7 + 1)}, side);
+      over_ladder.add_level({price, double(i % 7 + 1)}, side);
+    }
+
+    if (i % 10 != 0)
+      continue;
+    size_t levels = std::rand() % 120;
+    double quantity = std::rand() % 500;
+    double bps = std::rand() % 2000;
+    for (Side s : {Side::Bid, Side::Ask}) {
+      auto expected = ob.depth(s, levels);
+      auto actual = over_ladder.depth(s, levels);
+      ASSERT_EQ(actual.levels, expected.levels);
+      ASSERT_NEAR(actual.quantity, expected.quantity, 1e-6);
+      ASSERT_NEAR(actual.notional, expected.notional, 1e-3);
+
+      expected = ob.depth_within(s, bps);
+      actual = over_ladder.depth_within(s, bps);
+      ASSERT_EQ(actual.levels, expected.levels);
+      ASSERT_NEAR(actual.notional, expected.notional, 1e-3);
+
+      expected = ob.fill(s, quantity);
+      actual = over_ladder.fill(s, quantity);
+      ASSERT_EQ(actual.levels, expected.levels);
+      ASSERT_NEAR(actual.quantity, expected.quantity, 1e-6);
+      ASSERT_NEAR(actual.notional, expected.notional, 1e-3);
+    }
+  }
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "../src/queue_book.h"
+#include "../src/slab_pool.h"
+
+TEST(SlabPool, ReusesReleasedObjects) {
+  SlabPool<int, 4> pool;
+
+  std::vector<int*> items;
+  for (int i = 0; i < 6; i++) {
+    items.push_back(pool.acquire());
+    *items.back() = i;
+  }
+  EXPECT_EQ(pool.size(), 6);
+  EXPECT_EQ(pool.capacity(), 8);
+  // Growing never moves what was handed out
+  for (int i = 0; i < 6; i++)
+    EXPECT_EQ(*items[i], i);
+
+  pool.release(items[2]);
+  EXPECT_EQ(pool.size(), 5);
+  EXPECT_EQ(pool.acquire(), items[2]);
+  EXPECT_EQ(pool.capacity(), 8);
+}
+
+TEST(QueueBook, TradesTakeFromTheFront) {
+  QueueBook queues(0.5);
+  queues.set(Side::Bid, 100, 10);
+  auto order = queues.track(Side::Bid, 100, 2);
+  queues.set(Side::Bid, 100, 15);
+
+  auto position = queues.position(order);
+  ASSERT_TRUE(position.has_value());
+  EXPECT_EQ(position->ahead, 10);
+  EXPECT_EQ(position->remaining, 2);
+
+  // The level's update after the trade is not a cancel
+  queues.trade(Side::Bid, 100, 4, 0);
+  queues.set(Side::Bid, 100, 11);
+  EXPECT_EQ(queues.position(order)->ahead, 6);
+
+  // What is left of a trade once it gets to the order fills it
+  queues.trade(Side::Bid, 100, 7, 0);
+  queues.set(Side::Bid, 100, 4);
+  position = queues.position(order);
+  EXPECT_EQ(position->ahead, 0);
+  EXPECT_EQ(position->remaining, 1);
+  EXPECT_EQ(position->filled, 1);
+
+  // Trading through the level fills it completely
+  queues.trade(Side::Bid, 99.5, 1, 0);
+  position = queues.position(order);
+  EXPECT_EQ(position->remaining, 0);
+  EXPECT_EQ(position->filled, 2);
+  EXPECT_EQ(queues.fill_probability(order, 1), 1);
+}
+
+TEST(QueueBook, CancelsTakeFromTheBack) {
+  QueueBook queues(0.5);
+  queues.set(Side::Ask, 101, 5);
+  queues.set(Side::Ask, 101, 8);
+  auto order = queues.track(Side::Ask, 101, 1);
+  queues.set(Side::Ask, 101, 10);
+  queues.set(Side::Ask, 101, 14);
+
+  // The last event of exactly the cancelled size, wherever it is
+  queues.set(Side::Ask, 101, 11);
+  EXPECT_EQ(queues.position(order)->ahead, 5);
+
+  // Otherwise the size behind the order goes first
+  queues.set(Side::Ask, 101, 7);
+  EXPECT_EQ(queues.position(order)->ahead, 5);
+  queues.set(Side::Ask, 101, 3);
+  EXPECT_EQ(queues.position(order)->ahead, 3);
+
+  // An order keeps its place when its level goes away
+  queues.set(Side::Ask, 101, 0);
+  EXPECT_EQ(queues.position(order)->ahead, 0);
+  queues.set(Side::Ask, 101, 3);
+  EXPECT_EQ(queues.position(order)->ahead, 0);
+
+  queues.cancel(order);
+  EXPECT_FALSE(queues.position(order).has_value());
+  queues.set(Side::Ask, 101, 0);
+  EXPECT_EQ(queues.entries(), 0);
+}
+
+TEST(QueueBook, FilledOrdersLeaveTheirLevels) {
+  QueueBook queues(0.5);
+  queues.set(Side::Ask, 101, 3);
+  auto front = queues.track(Side::Ask, 101, 1);
+  auto inside = queues.track(Side::Ask, 100.5, 1);
+  auto behind = queues.track(Side::Ask, 102, 1);
+  EXPECT_EQ(queues.levels(), 3);
+
+  // Trading through 100.5 only reaches the order there
+  queues.trade(Side::Ask, 101, 4, 0);
+  EXPECT_EQ(queues.position(inside)->filled, 1);
+  EXPECT_EQ(queues.position(front)->filled, 1);
+  EXPECT_EQ(queues.position(behind)->filled, 0);
+  EXPECT_EQ(queues.levels(), 1);
+
+  queues.trade(Side::Ask, 102.5, 1, 0);
+  EXPECT_EQ(queues.position(behind)->filled, 1);
+  EXPECT_EQ(queues.levels(), 0);
+  EXPECT_EQ(queues.entries(), 0);
+
+  // Cancelling a filled order leaves nothing to clean up
+  queues.cancel(behind);
+  EXPECT_EQ(queues.levels(), 0);
+}
+
+TEST(QueueBook, SnapshotKeepsQueues) {
+  QueueBook queues(0.5);
+  queues.set(Side::Bid, 100, 10);
+  auto order = queues.track(Side::Bid, 100, 1);
+  queues.set(Side::Bid, 100, 12);
+  queues.set(Side::Bid, 99, 5);
+
+  queues.begin_snapshot();
+  queues.set(Side::Bid, 100, 15);
+  queues.end_snapshot();
+
+  EXPECT_EQ(queues.position(order)->ahead, 10);
+  // The level at 99 was not in the snapshot
+  EXPECT_EQ(queues.entries(), 4);
+}
+
+TEST(QueueBook, FillProbability) {
+  QueueBook queues(0.5);
+  queues.set(Side::Bid, 100, 10);
+  auto early = queues.track(Side::Bid, 100, 2);
+  EXPECT_EQ(queues.fill_probability(early, 60), 0);
+  queues.cancel(early);
+
+  queues.trade(Side::Bid, 99, 60, 1'000'000'000);
+  auto order = queues.track(Side::Bid, 100, 2);
+  EXPECT_DOUBLE_EQ(queues.trade_rate(Side::Bid), 1);
+  EXPECT_EQ(queues.trade_rate(Side::Ask), 0);
+
+  // About 60 contracts trade a minute against the 12 the order needs
+  EXPECT_NEAR(queues.fill_probability(order, 60), std::exp(-12.0 / 60), 1e-9);
+  EXPECT_LT(queues.fill_probability(order, 1),
+            queues.fill_probability(order, 60));
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "../src/seqlock.h"
+
+typedef struct {
+  uint64_t values[16];
+} Values;
+
+TEST(Seqlock, ReadersNeverSeeTornValues) {
+  Seqlock<Values> slot;
+  std::atomic<bool> done = false;
+
+  std::thread writer([&] {
+    Values values;
+    for (uint64_t i = 1; i <= 100000; i++) {
+      for (auto& value : values.values)
+        value = i;
+      slot.store(values);
+    }
+    done = true;
+  });
+
+  uint64_t last = 0;
+  while (!done) {
+    Values values;
+    if (!slot.try_load(values)) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (auto value : values.values)
+      ASSERT_EQ(value, values.values[0]);
+    ASSERT_GE(values.values[0], last);
+    last = values.values[0];
+  }
+  writer.join();
+
+  EXPECT_EQ(slot.load().values[0], 100000);
+  EXPECT_EQ(slot.sequence(), 100000);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "../src/book_manager.h"
+#include "../src/shared_books.h"
+
+TEST(SharedBooks, MirrorsPublishedBooks) {
+  std::string name = "/orderbook-test-" + std::to_string(getpid());
+  auto books = BookManager(2);
+  auto publisher = std::make_unique<SharedBooks::Publisher>(name, 4);
+  books.attach_top_of_book_handler(
+      [&](SymbolId id, TopOfBook const& top) { publisher->publish(id, top); });
+
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+  auto eth = books.add_book("ETH-PERPETUAL", 0.05);
+  publisher->add(btc, "BTC-PERPETUAL");
+  publisher->add(eth, "ETH-PERPETUAL");
+
+  SharedBooks::Reader reader(name);
+  EXPECT_EQ(reader.size(), 2);
+  EXPECT_EQ(reader.find("ETH-PERPETUAL"), eth);
+  EXPECT_EQ(reader.find("SOL-PERPETUAL"), std::nullopt);
+  EXPECT_EQ(reader.symbol(btc), "BTC-PERPETUAL");
+  EXPECT_EQ(reader.sequence(btc), 0);
+
+  books.on_snapshot(btc, {.bids = {{100.0, 1}}, .asks = {{100.5, 2}}});
+  books.on_snapshot(eth, {.bids = {{10.0, 3}}, .asks = {}});
+  books.flush();
+
+  EXPECT_EQ(reader.sequence(btc), 1);
+  auto top = reader.load(btc);
+  ASSERT_EQ(top.bid_count, 1);
+  EXPECT_EQ(top.bids[0].price, 100.0);
+  EXPECT_EQ(top.asks[0].quantity, 2);
+  EXPECT_EQ(reader.load(eth).bids[0].quantity, 3);
+
+  // Ids past the directory have no book, even beyond the region's capacity
+  for (SymbolId id : {SymbolId(2), SymbolId(100)}) {
+    EXPECT_EQ(reader.symbol(id), "");
+    EXPECT_EQ(reader.sequence(id), 0);
+    EXPECT_FALSE(reader.try_load(id, top));
+    EXPECT_EQ(reader.load(id).bid_count, 0);
+  }
+
+  EXPECT_THROW(publisher->add(4, "SOL-PERPETUAL"), std::runtime_error);
+
+  EXPECT_FALSE(reader.closed());
+  publisher.reset();
+  EXPECT_TRUE(reader.closed());
+  EXPECT_THROW(SharedBooks::Reader{name}, std::runtime_error);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+
+#include "../src/book_manager.h"
+#include "../src/datasources/datasource.h"
+
+// Counts the allocations made by the current thread.
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  if (void* ptr = std::malloc(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+TEST(SmallVector, InlineAndSpilled) {
+  SmallVector<int, 4> items = {1, 2, 3};
+
+  EXPECT_EQ(items.size(), 3);
+  EXPECT_EQ(items.capacity(), 4);
+
+  for (int i = 4; i <= 10; i++)
+    items.push_back(i);
+  EXPECT_EQ(items.size(), 10);
+  EXPECT_GE(items.capacity(), 10);
+
+  SmallVector<int, 4> copy = items;
+  SmallVector<int, 4> moved = std::move(items);
+  EXPECT_TRUE(items.empty());
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(copy[i], i + 1);
+    EXPECT_EQ(moved[i], i + 1);
+  }
+}
+
+TEST(SmallVector, SteadyStateDoesNotAllocate) {
+  auto books = BookManager(1);
+  auto btc = books.add_book("BTC-PERPETUAL", 0.5);
+
+  // Mimics the datasource, which builds a fresh update for every message
+  auto handle_messages = [&] {
+    for (int message = 0; message < 100; message++) {
+      BidAskDelta delta;
+      for (int i = 0; i < message % 8; i++) {
+        delta.bids.push_back({OfferAction::Update, {100.0 - i * 0.5, 1}});
+        delta.asks.push_back({OfferAction::Update, {100.5 + i * 0.5, 1}});
+      }
+      books.on_delta(btc, delta);
+
+      BidAskSnapshot snapshot;
+      for (int i = 0; i < (message % 4) * 500; i++) {
+        snapshot.bids.push_back({100.0 - i * 0.5, 1});
+        snapshot.asks.push_back({100.5 + i * 0.5, 1});
+      }
+      books.on_snapshot(btc, snapshot);
+    }
+  };
+
+  // The first round warms up the spill pool
+  size_t before = allocations;
+  handle_messages();
+  EXPECT_GT(allocations - before, 0);
+
+  before = allocations;
+  handle_messages();
+  EXPECT_EQ(allocations - before, 0);
+
+  books.flush();
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../src/spsc_queue.h"
+
+TEST(SpscQueue, PushPop) {
+  auto queue = SpscQueue<int>(3);
+
+  EXPECT_EQ(queue.max_size(), 4);
+  for (int i = 0; i < 4; i++)
+    EXPECT_TRUE(queue.try_push(i));
+  EXPECT_FALSE(queue.try_push(4));
+  EXPECT_EQ(queue.size(), 4);
+
+  int item;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.try_pop(item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_FALSE(queue.try_pop(item));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueue, ProducerConsumer) {
+  auto queue = SpscQueue<uint64_t>(64);
+  constexpr uint64_t count = 100000;
+
+  std::thread producer([&] {
+    for (uint64_t i = 0; i < count; i++)
+      while (!queue.try_push(i))
+        std::this_thread::yield();
+  });
+
+  uint64_t expected = 0;
+  while (expected < count) {
+    uint64_t item;
+    if (queue.try_pop(item)) {
+      ASSERT_EQ(item, expected++);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/datasources/subscription_queue.h"
+
+using Deribit::SubscriptionQueue;
+
+typedef std::vector<std::string> Symbols;
+
+TEST(SubscriptionQueue, PacksSymbolsIntoRequests) {
+  SubscriptionQueue queue(2);
+  EXPECT_FALSE(queue.pending());
+  EXPECT_FALSE(queue.next("0").has_value());
+
+  for (auto symbol : {"BTC-PERPETUAL", "ETH-PERPETUAL", "SOL-PERPETUAL"})
+    queue.queue(symbol, {.depth = 0, .trades = false});
+  EXPECT_TRUE(queue.pending());
+
+  // Up to the most symbols a request takes, the rest go next
+  auto first = queue.next("1");
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(first->request_id, "1");
+  EXPECT_EQ(first->symbols, (Symbols{"BTC-PERPETUAL", "ETH-PERPETUAL"}));
+  EXPECT_TRUE(first->cancels.empty());
+
+  auto second = queue.next("2");
+  ASSERT_TRUE(second.has_value());
+  EXPECT_EQ(second->symbols, Symbols{"SOL-PERPETUAL"});
+  EXPECT_FALSE(queue.pending());
+}
+
+TEST(SubscriptionQueue, KeepsDifferentSubscriptionsApart) {
+  SubscriptionQueue queue(100);
+  queue.queue("BTC-PERPETUAL", {.depth = 0, .trades = false});
+  queue.queue("ETH-PERPETUAL", {.depth = 10, .trades = false});
+  queue.queue("SOL-PERPETUAL", {.depth = 0, .trades = true});
+  queue.queue("XRP-PERPETUAL", {.depth = 0, .trades = false});
+
+  // Those like the oldest go first, the others stay queued in order
+  auto request = queue.next("1");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, (Symbols{"BTC-PERPETUAL", "XRP-PERPETUAL"}));
+  EXPECT_EQ(request->subscription.depth, 0);
+  EXPECT_FALSE(request->subscription.trades);
+
+  request = queue.next("2");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, Symbols{"ETH-PERPETUAL"});
+  EXPECT_EQ(request->subscription.depth, 10);
+
+  request = queue.next("3");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, Symbols{"SOL-PERPETUAL"});
+  EXPECT_TRUE(request->subscription.trades);
+  EXPECT_FALSE(queue.pending());
+}
+
+TEST(SubscriptionQueue, CancelsTheRequestOfAResubscribedSymbol) {
+  SubscriptionQueue queue(100);
+  queue.queue("BTC-PERPETUAL", {.depth = 0, .trades = false});
+  queue.queue("ETH-PERPETUAL", {.depth = 0, .trades = false});
+  ASSERT_TRUE(queue.next("1").has_value());
+
+  // Subscribing twice before the request goes out sends it once
+  queue.queue("BTC-PERPETUAL", {.depth = 1, .trades = false});
+  queue.queue("BTC-PERPETUAL", {.depth = 10, .trades = false});
+  auto request = queue.next("2");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, Symbols{"BTC-PERPETUAL"});
+  EXPECT_EQ(request->subscription.depth, 10);
+  ASSERT_EQ(request->cancels.size(), 1);
+  EXPECT_EQ(request->cancels.at("1"), Symbols{"BTC-PERPETUAL"});
+  EXPECT_FALSE(queue.pending());
+
+  // A rejection of the first request only takes the book still on it
+  EXPECT_EQ(queue.reject("1"), Symbols{"ETH-PERPETUAL"});
+  EXPECT_TRUE(queue.reject("1").empty());
+
+  // A new session sends what is left again without cancelling anything
+  queue.renew();
+  request = queue.next("3");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, Symbols{"BTC-PERPETUAL"});
+  EXPECT_TRUE(request->cancels.empty());
+}
+
+TEST(SubscriptionQueue, SkipsBooksRejectedWhileQueued) {
+  SubscriptionQueue queue(100);
+  queue.queue("BTC-PERPETUAL", {.depth = 0, .trades = false});
+  queue.queue("ETH-PERPETUAL", {.depth = 0, .trades = false});
+  ASSERT_TRUE(queue.next("1").has_value());
+
+  // Queued again, the book outlives the rejection of its earlier request
+  queue.queue("ETH-PERPETUAL", {.depth = 0, .trades = false});
+  EXPECT_EQ(queue.reject("1"), Symbols{"BTC-PERPETUAL"});
+  auto request = queue.next("2");
+  ASSERT_TRUE(request.has_value());
+  EXPECT_EQ(request->symbols, Symbols{"ETH-PERPETUAL"});
+}
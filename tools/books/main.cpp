@@ -0,0 +1,46 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../../src/shared_books.h"
+
+// Prints the best bid and ask of every book a running orderbook_cli mirrors
+// into shared memory, without disturbing it.
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <shared memory name>" << std::endl;
+    return 1;
+  }
+
+  try {
+    SharedBooks::Reader reader(argv[1]);
+    if (reader.closed())
+      std::cerr << "Warning: the publisher has gone away" << std::endl;
+
+    std::cout << std::fixed;
+    for (SymbolId id = 0; id < reader.size(); id++) {
+      if (reader.symbol(id).empty())
+        continue;
+      TopOfBook top = reader.load(id);
+      std::cout << std::left << std::setw(24) << reader.symbol(id)
+                << std::right << std::setw(10) << top.sequence;
+      if (top.bid_count > 0)
+        std::cout << std::setw(12) << std::setprecision(2)
+                  << top.bids[0].quantity << " @ " << std::setprecision(4)
+                  << top.bids[0].price;
+      else
+        std::cout << std::setw(15) << "-";
+      std::cout << "  |  ";
+      if (top.ask_count > 0)
+        std::cout << std::setprecision(4) << top.asks[0].price << " x "
+                  << std::setprecision(2) << top.asks[0].quantity;
+      else
+        std::cout << "-";
+      std::cout << '\n';
+    }
+    return 0;
+  } catch (std::exception const& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,209 @@
+#include "book_dynamics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Share of the changes which only update the size of a level.
+constexpr double UPDATE_SHARE = 0.8;
+// New levels are added up to this many ticks inside the spread.
+constexpr int64_t MAX_IMPROVEMENT = 2;
+
+template <typename Levels>
+void apply_changes(Levels& levels,
+                   SmallVector<OfferChange, INLINE_OFFERS> const& changes) {
+  for (auto const& change : changes) {
+    if (change.action == OfferAction::Remove)
+      levels.erase(change.offer.price);
+    else
+      levels[change.offer.price] = change.offer.quantity;
+  }
+}
+
+template <typename Levels>
+void diff_levels(Levels const& from,
+                 SmallVector<Offer, INLINE_OFFERS> const& to,
+                 SmallVector<OfferChange, INLINE_OFFERS>& changes) {
+  Levels target;
+  for (auto const& offer : to)
+    target[offer.price] = offer.quantity;
+
+  for (auto const& [price, quantity] : from)
+    if (!target.contains(price))
+      changes.push_back({OfferAction::Remove, {price, 0}});
+  for (auto const& [price, quantity] : target) {
+    auto it = from.find(price);
+    if (it == from.end())
+      changes.push_back({OfferAction::Add, {price, quantity}});
+    else if (it->second != quantity)
+      changes.push_back({OfferAction::Update, {price, quantity}});
+  }
+}
+
+template <typename Levels>
+void copy_levels(Levels const& levels,
+                 size_t depth,
+                 SmallVector<Offer, INLINE_OFFERS>& offers) {
+  for (auto const& [price, quantity] : levels) {
+    if (depth != 0 && offers.size() == depth)
+      break;
+    offers.push_back({price, quantity});
+  }
+}
+
+}  // namespace
+
+void BookDynamics::apply(BidAskDelta const& delta) {
+  apply_changes(bids, delta.bids);
+  apply_changes(asks, delta.asks);
+}
+
+void BookDynamics::diff(BidAskSnapshot const& snapshot,
+                        BidAskDelta& delta) const {
+  diff_levels(bids, snapshot.bids, delta.bids);
+  diff_levels(asks, snapshot.asks, delta.asks);
+}
+
+void BookDynamics::snapshot(BidAskSnapshot& snapshot, size_t depth) const {
+  copy_levels(bids, depth, snapshot.bids);
+  copy_levels(asks, depth, snapshot.asks);
+}
+
+SyntheticDynamics::SyntheticDynamics(double mid,
+                                     double tick_size,
+                                     size_t depth,
+                                     size_t entries_per_message,
+                                     uint64_t seed)
+    : tick_size(tick_size),
+      depth(std::max<size_t>(depth, 2)),
+      entries_per_message(std::max<size_t>(entries_per_message, 1)),
+      rng(seed) {
+  int64_t best_bid = std::llround(mid / tick_size) - 1;
+  for (size_t i = 0; i < this->depth; i++) {
+    bids[(best_bid - int64_t(i)) * tick_size] = random_quantity();
+    asks[(best_bid + 1 + int64_t(i)) * tick_size] = random_quantity();
+  }
+}
+
+double SyntheticDynamics::random_quantity() {
+  // Deribit perpetuals trade in lots of 10 USD
+  return 10 * std::uniform_int_distribution<int>(1, 5000)(rng);
+}
+
+size_t SyntheticDynamics::random_distance(size_t size) {
+  std::geometric_distribution<size_t> distance(0.15);
+  return std::min(distance(rng), size - 1);
+}
+
+void SyntheticDynamics::change(bool bid, BidAskDelta& delta) {
+  auto& changes = bid ? delta.bids : delta.asks;
+  size_t size = bid ? bids.size() : asks.size();
+  size_t distance = random_distance(size);
+  auto level_at = [&](size_t distance) {
+    return bid ? std::next(bids.begin(), distance)->first
+               : std::next(asks.begin(), distance)->first;
+  };
+
+  auto set = [&](double price, double quantity, bool exists) {
+    changes.push_back(
+        {exists ? OfferAction::Update : OfferAction::Add, {price, quantity}});
+    if (bid)
+      bids[price] = quantity;
+    else
+      asks[price] = quantity;
+  };
+
+  if (std::uniform_real_distribution<>(0, 1)(rng) < UPDATE_SHARE || size < 2) {
+    set(level_at(distance), random_quantity(), true);
+    return;
+  }
+
+  double removed = level_at(distance);
+  changes.push_back({OfferAction::Remove, {removed, 0}});
+  if (bid)
+    bids.erase(removed);
+  else
+    asks.erase(removed);
+
+  // Add a level somewhere between just inside the spread and the far end of
+  // the book without crossing the other side, on a free tick so that the depth
+  // stays the same
+  int64_t best_bid = std::llround(bids.begin()->first / tick_size);
+  int64_t best_ask = std::llround(asks.begin()->first / tick_size);
+  std::uniform_int_distribution<int64_t> offsets(-MAX_IMPROVEMENT,
+                                                 int64_t(depth) - 1);
+  double price = 0;
+  for (bool free = false; !free;) {
+    int64_t offset = offsets(rng);
+    int64_t tick = bid ? std::min(best_bid - offset, best_ask - 1)
+                       : std::max(best_ask + offset, best_bid + 1);
+    price = tick * tick_size;
+    free = bid ? !bids.contains(price) : !asks.contains(price);
+  }
+  set(price, random_quantity(), false);
+}
+
+void SyntheticDynamics::next(BidAskDelta& delta) {
+  std::bernoulli_distribution side(0.5);
+  for (size_t i = 0; i < entries_per_message; i++)
+    change(side(rng), delta);
+}
+
+RecordedDynamics::RecordedDynamics(std::string const& path, std::string symbol)
+    : symbol(std::move(symbol)), reader(path) {
+  Capture::Record record;
+  while (reader.next(record, skipped_snapshot, skipped_delta)) {
+    if (record.kind == Capture::RecordKind::Snapshot &&
+        record.symbol == this->symbol) {
+      initial = skipped_snapshot;
+      BidAskDelta delta;
+      diff(initial, delta);
+      apply(delta);
+      return;
+    }
+  }
+  throw std::runtime_error("No snapshot of " + this->symbol + " in " + path);
+}
+
+Capture::RecordKind RecordedDynamics::read(BidAskSnapshot& snapshot,
+                                           BidAskDelta& delta) {
+  Capture::Record record;
+  while (true) {
+    if (!reader.next(record, skipped_snapshot, skipped_delta)) {
+      // Start over from the first snapshot, the records before it and the
+      // snapshot itself are skipped
+      reader.rewind();
+      while (reader.next(record, skipped_snapshot, skipped_delta) &&
+             (record.kind != Capture::RecordKind::Snapshot ||
+              record.symbol != symbol))
+        continue;
+      snapshot = initial;
+      return Capture::RecordKind::Snapshot;
+    }
+    if (record.symbol != symbol)
+      continue;
+    if (record.kind == Capture::RecordKind::Snapshot)
+      snapshot = skipped_snapshot;
+    else
+      delta = skipped_delta;
+    return record.kind;
+  }
+}
+
+void RecordedDynamics::next(BidAskDelta& delta) {
+  BidAskSnapshot snapshot;
+  BidAskDelta recorded;
+  if (read(snapshot, recorded) == Capture::RecordKind::Snapshot) {
+    // A resubscription in the capture, send whatever changed
+    diff(snapshot, delta);
+  } else {
+    for (auto const& change : recorded.bids)
+      delta.bids.push_back(change);
+    for (auto const& change : recorded.asks)
+      delta.asks.push_back(change);
+  }
+  apply(delta);
+}
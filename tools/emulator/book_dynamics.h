@@ -0,0 +1,84 @@
+#ifndef book_dynamics
+#define book_dynamics
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "../../src/datasources/capture.h"
+#include "../../src/datasources/datasource.h"
+
+// Drives how an emulated book evolves. The book is kept in full so that the
+// snapshot sent on subscription and every later update are consistent.
+class BookDynamics {
+ protected:
+  std::map<double, double, std::greater<double>> bids;
+  std::map<double, double> asks;
+
+  // Applies `delta` to the book.
+  void apply(BidAskDelta const& delta);
+
+  // Appends the changes which turn the book into `snapshot` to `delta`.
+  void diff(BidAskSnapshot const& snapshot, BidAskDelta& delta) const;
+
+ public:
+  virtual ~BookDynamics() = default;
+
+  // Current state of the book, at most `depth` levels a side, 0 for all.
+  void snapshot(BidAskSnapshot& snapshot, size_t depth = 0) const;
+
+  // Produces the next update and applies it to the book.
+  virtual void next(BidAskDelta& delta) = 0;
+};
+
+// A random book around a mid price. Most updates change the size of a level
+// close to the touch, the rest remove a level and add another one so that the
+// depth stays roughly constant, which moves the touch from time to time.
+class SyntheticDynamics : public BookDynamics {
+ private:
+  double tick_size;
+  size_t depth;
+  size_t entries_per_message;
+  std::mt19937_64 rng;
+
+  double random_quantity();
+  // Distance in levels from the touch, most changes happen close to it.
+  size_t random_distance(size_t size);
+
+  void change(bool bid, BidAskDelta& delta);
+
+ public:
+  SyntheticDynamics(double mid,
+                    double tick_size,
+                    size_t depth,
+                    size_t entries_per_message,
+                    uint64_t seed);
+
+  void next(BidAskDelta& delta) override;
+};
+
+// Replays the updates recorded for `symbol` in a capture file. The book starts
+// from the first snapshot, once the capture runs out it is turned back into
+// that snapshot and replayed again.
+class RecordedDynamics : public BookDynamics {
+ private:
+  std::string symbol;
+  Capture::Reader reader;
+  BidAskSnapshot initial;
+  // Scratch space for records of other symbols and kinds.
+  BidAskSnapshot skipped_snapshot;
+  BidAskDelta skipped_delta;
+
+  // Reads the next record for `symbol`, rewinding at the end of the file.
+  Capture::RecordKind read(BidAskSnapshot& snapshot, BidAskDelta& delta);
+
+ public:
+  RecordedDynamics(std::string const& path, std::string symbol);
+
+  void next(BidAskDelta& delta) override;
+};
+
+#endif  // book_dynamics
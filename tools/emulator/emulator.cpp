@@ -0,0 +1,284 @@
+#include "emulator.h"
+
+#include <openssl/sha.h>
+#include <quickfix/FixFieldNumbers.h>
+#include <quickfix/FixFields.h>
+#include <quickfix/FixValues.h>
+#include <quickfix/Session.h>
+#include <quickfix/fix44/MarketDataIncrementalRefresh.h>
+#include <quickfix/fix44/MarketDataSnapshotFullRefresh.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+#include "../../src/crypto.h"
+
+namespace {
+
+double get_double(FIX::Dictionary const& dictionary,
+                  std::string const& key,
+                  double fallback) {
+  return dictionary.has(key) ? dictionary.getDouble(key) : fallback;
+}
+
+char entry_type(bool bid) {
+  return bid ? FIX::MDEntryType_BID : FIX::MDEntryType_OFFER;
+}
+
+char update_action(OfferAction action) {
+  switch (action) {
+    case OfferAction::Add:
+      return FIX::MDUpdateAction_NEW;
+    case OfferAction::Update:
+      return FIX::MDUpdateAction_CHANGE;
+    case OfferAction::Remove:
+      return FIX::MDUpdateAction_DELETE;
+  }
+  return FIX::MDUpdateAction_CHANGE;
+}
+
+}  // namespace
+
+EmulatorSettings Emulator::read_settings(FIX::SessionSettings const& settings) {
+  auto const& defaults = settings.get();
+  return {
+      .message_rate = get_double(defaults, "MessageRate", 1000),
+      .entries_per_message =
+          size_t(get_double(defaults, "EntriesPerMessage", 4)),
+      .book_depth = size_t(get_double(defaults, "BookDepth", 500)),
+      .tick_size = get_double(defaults, "TickSize", 0.5),
+      .mid_price = get_double(defaults, "MidPrice", 64000),
+      .replay_file = defaults.has("ReplayFile")
+                         ? defaults.getString("ReplayFile")
+                         : std::string(),
+      .secret = defaults.has("Secret") ? defaults.getString("Secret")
+                                       : std::string(),
+  };
+}
+
+Emulator::Emulator(EmulatorSettings settings)
+    : settings(std::move(settings)),
+      stopping(false),
+      messages_sent(0),
+      entries_sent(0) {}
+
+Emulator::~Emulator() {
+  stop();
+}
+
+void Emulator::start() {
+  publisher = std::thread(&Emulator::publish, this);
+}
+
+void Emulator::stop() {
+  stopping = true;
+  if (publisher.joinable())
+    publisher.join();
+}
+
+uint64_t Emulator::messages() const {
+  return messages_sent;
+}
+
+uint64_t Emulator::entries() const {
+  return entries_sent;
+}
+
+std::unique_ptr<BookDynamics> Emulator::make_dynamics(
+    std::string const& symbol) {
+  if (!settings.replay_file.empty())
+    return std::make_unique<RecordedDynamics>(settings.replay_file, symbol);
+  return std::make_unique<SyntheticDynamics>(
+      settings.mid_price, settings.tick_size, settings.book_depth,
+      settings.entries_per_message, std::hash<std::string>()(symbol));
+}
+
+void Emulator::send_snapshot(Subscription const& subscription, size_t depth) {
+  BidAskSnapshot snapshot;
+  subscription.dynamics->snapshot(snapshot, depth);
+
+  FIX44::MarketDataSnapshotFullRefresh message;
+  message.setField(FIX::Symbol(subscription.symbol));
+  message.setField(FIX::MDReqID(subscription.request_id));
+
+  FIX44::MarketDataSnapshotFullRefresh::NoMDEntries entry;
+  for (bool bid : {true, false}) {
+    for (auto const& offer : bid ? snapshot.bids : snapshot.asks) {
+      entry.set(FIX::MDEntryType(entry_type(bid)));
+      entry.set(FIX::MDEntryPx(offer.price));
+      entry.set(FIX::MDEntrySize(offer.quantity));
+      message.addGroup(entry);
+    }
+  }
+
+  FIX::Session::sendToTarget(message, subscription.session_id);
+  messages_sent++;
+  entries_sent += snapshot.bids.size() + snapshot.asks.size();
+}
+
+bool Emulator::send_delta(Subscription& subscription) {
+  BidAskDelta delta;
+  subscription.dynamics->next(delta);
+
+  if (subscription.full_refresh_depth > 0) {
+    send_snapshot(subscription, subscription.full_refresh_depth);
+    return true;
+  }
+  if (delta.bids.empty() && delta.asks.empty())
+    return false;
+
+  FIX44::MarketDataIncrementalRefresh message;
+  message.setField(FIX::Symbol(subscription.symbol));
+  message.setField(FIX::MDReqID(subscription.request_id));
+
+  FIX44::MarketDataIncrementalRefresh::NoMDEntries entry;
+  for (bool bid : {true, false}) {
+    for (auto const& change : bid ? delta.bids : delta.asks) {
+      entry.set(FIX::MDUpdateAction(update_action(change.action)));
+      entry.set(FIX::MDEntryType(entry_type(bid)));
+      entry.set(FIX::MDEntryPx(change.offer.price));
+      entry.set(FIX::MDEntrySize(change.offer.quantity));
+      message.addGroup(entry);
+    }
+  }
+
+  FIX::Session::sendToTarget(message, subscription.session_id);
+  messages_sent++;
+  entries_sent += delta.bids.size() + delta.asks.size();
+  return true;
+}
+
+void Emulator::publish() {
+  using namespace std::chrono;
+
+  // Every subscription gets one message per period, without a rate the loop
+  // sends as fast as the sessions take the messages
+  auto period = settings.message_rate > 0
+                    ? duration_cast<steady_clock::duration>(
+                          duration<double>(1 / settings.message_rate))
+                    : steady_clock::duration::zero();
+  auto next = steady_clock::now();
+
+  while (!stopping) {
+    bool sent = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto& subscription : subscriptions)
+        sent |= send_delta(subscription);
+    }
+
+    if (!sent) {
+      std::this_thread::sleep_for(milliseconds(1));
+      next = steady_clock::now();
+    } else if (period > steady_clock::duration::zero()) {
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+  }
+}
+
+void Emulator::onCreate(FIX::SessionID const&) {}
+
+void Emulator::onLogon(FIX::SessionID const& session_id) {
+  std::cout << "Logon " << session_id << std::endl;
+}
+
+void Emulator::onLogout(FIX::SessionID const& session_id) {
+  std::cout << "Logout " << session_id << std::endl;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::erase_if(subscriptions, [&](Subscription const& subscription) {
+    return subscription.session_id == session_id;
+  });
+}
+
+void Emulator::toAdmin(FIX::Message&, FIX::SessionID const&) {}
+
+void Emulator::toApp(FIX::Message&, FIX::SessionID const&) EXCEPT(DoNotSend) {}
+
+void Emulator::fromAdmin(FIX::Message const& message, FIX::SessionID const&)
+    EXCEPT(FieldNotFound, IncorrectDataFormat, IncorrectTagValue, RejectLogon) {
+  if (message.getHeader().getField(FIX::FIELD::MsgType) != FIX::MsgType_Logon ||
+      settings.secret.empty())
+    return;
+
+  // Deribit signs logons with base64(sha256(RawData ++ secret)) where RawData
+  // is the client's timestamp and nonce
+  std::string raw_data = message.getField(FIX::FIELD::RawData);
+  std::string signed_data = raw_data + settings.secret;
+
+  unsigned char hash[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<unsigned char const*>(signed_data.data()),
+         signed_data.size(), hash);
+  if (message.getField(FIX::FIELD::Password) !=
+      Base64::encode(hash, sizeof(hash)))
+    throw FIX::RejectLogon("Invalid signature");
+}
+
+void Emulator::fromApp(FIX::Message const& message,
+                       FIX::SessionID const& session_id)
+    EXCEPT(FieldNotFound,
+           IncorrectDataFormat,
+           IncorrectTagValue,
+           UnsupportedMessageType) {
+  crack(message, session_id);
+}
+
+void Emulator::onMessage(FIX44::MarketDataRequest const& message,
+                         FIX::SessionID const& session_id) {
+  std::string request_id = message.getField(FIX::FIELD::MDReqID);
+  char request_type =
+      message.getField(FIX::FIELD::SubscriptionRequestType).front();
+
+  // One request may cover many books, every one of them in a group
+  std::vector<std::string> symbols;
+  FIX44::MarketDataRequest::NoRelatedSym related_symbol;
+  size_t groups = message.groupCount(FIX::FIELD::NoRelatedSym);
+  for (size_t i = 1; i <= groups; i++) {
+    message.getGroup(i, related_symbol);
+    symbols.push_back(related_symbol.getField(FIX::FIELD::Symbol));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // 0=snapshot, 1=snapshot and updates, 2=unsubscribe. A cancel names the
+  // request and the books of it to stop, all of them if it lists none
+  if (request_type == '2') {
+    std::erase_if(subscriptions, [&](Subscription const& subscription) {
+      return subscription.session_id == session_id &&
+             subscription.request_id == request_id &&
+             (symbols.empty() ||
+              std::find(symbols.begin(), symbols.end(), subscription.symbol) !=
+                  symbols.end());
+    });
+    return;
+  }
+
+  size_t depth = message.isSetField(FIX::FIELD::MarketDepth)
+                     ? std::stoul(message.getField(FIX::FIELD::MarketDepth))
+                     : 0;
+  bool full_refresh = message.isSetField(FIX::FIELD::MDUpdateType) &&
+                      message.getField(FIX::FIELD::MDUpdateType) == "0";
+
+  for (auto const& symbol : symbols) {
+    // Replaces any earlier subscription to the same book
+    std::erase_if(subscriptions, [&](Subscription const& subscription) {
+      return subscription.session_id == session_id &&
+             subscription.symbol == symbol;
+    });
+
+    Subscription subscription = {
+        .session_id = session_id,
+        .symbol = symbol,
+        .request_id = request_id,
+        .full_refresh_depth = full_refresh ? std::max<size_t>(depth, 1) : 0,
+        .dynamics = make_dynamics(symbol),
+    };
+    send_snapshot(subscription, subscription.full_refresh_depth);
+
+    if (request_type == '1')
+      subscriptions.push_back(std::move(subscription));
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef emulator
+#define emulator
+
+#include <quickfix/Application.h>
+#include <quickfix/MessageCracker.h>
+#include <quickfix/SessionSettings.h>
+#include <quickfix/fix44/MarketDataRequest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "book_dynamics.h"
+
+// Settings of the emulated exchange, read from the `[DEFAULT]` section.
+typedef struct {
+  // X messages sent per second for each subscription, 0 for as fast as the
+  // session takes them.
+  double message_rate;
+  // Changes in every X message of a synthetic book.
+  size_t entries_per_message;
+  // Levels on each side of a synthetic book.
+  size_t book_depth;
+  double tick_size;
+  double mid_price;
+  // Capture file to take the book dynamics from instead of generating them.
+  std::string replay_file;
+  // Secret logons are checked against, logons are not checked if empty.
+  std::string secret;
+} EmulatorSettings;
+
+// Stands in for Deribit's FIX gateway. Logons are checked the way Deribit
+// checks them, a MarketDataRequest (V) is answered with a full snapshot (W)
+// followed by a stream of incremental refreshes (X) at the configured rate.
+class Emulator : public FIX::Application, public FIX::MessageCracker {
+ private:
+  typedef struct {
+    FIX::SessionID session_id;
+    std::string symbol;
+    std::string request_id;
+    // Levels sent in every full refresh (MDUpdateType=0), 0 when incremental
+    // refreshes are streamed instead.
+    size_t full_refresh_depth;
+    std::unique_ptr<BookDynamics> dynamics;
+  } Subscription;
+
+  EmulatorSettings settings;
+
+  std::mutex mutex;
+  std::vector<Subscription> subscriptions;
+
+  std::thread publisher;
+  std::atomic<bool> stopping;
+  std::atomic<uint64_t> messages_sent;
+  std::atomic<uint64_t> entries_sent;
+
+  std::unique_ptr<BookDynamics> make_dynamics(std::string const& symbol);
+  void send_snapshot(Subscription const& subscription, size_t depth);
+  bool send_delta(Subscription& subscription);
+  void publish();
+
+ public:
+  static EmulatorSettings read_settings(FIX::SessionSettings const& settings);
+
+  Emulator(EmulatorSettings settings);
+  ~Emulator();
+
+  // Starts streaming updates to subscribers.
+  void start();
+  void stop();
+
+  uint64_t messages() const;
+  uint64_t entries() const;
+
+  /* Implementing Application interface */
+  void onCreate(FIX::SessionID const&) override;
+  void onLogon(FIX::SessionID const&) override;
+  void onLogout(FIX::SessionID const&) override;
+  void toAdmin(FIX::Message&, FIX::SessionID const&) override;
+  void toApp(FIX::Message&, FIX::SessionID const&) EXCEPT(DoNotSend) override;
+  void fromAdmin(FIX::Message const&, FIX::SessionID const&)
+      EXCEPT(FieldNotFound,
+             IncorrectDataFormat,
+             IncorrectTagValue,
+             RejectLogon) override;
+  void fromApp(FIX::Message const&, FIX::SessionID const&)
+      EXCEPT(FieldNotFound,
+             IncorrectDataFormat,
+             IncorrectTagValue,
+             UnsupportedMessageType) override;
+
+  /* Implementing MessageCracker interface */
+  void onMessage(FIX44::MarketDataRequest const&,
+                 FIX::SessionID const&) override;
+};
+
+#endif  // emulator
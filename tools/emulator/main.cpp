@@ -0,0 +1,56 @@
+#include <quickfix/MemoryStore.h>
+#include <quickfix/Log.h>
+#include <quickfix/SessionSettings.h>
+#include <quickfix/SocketAcceptor.h>
+
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+#include "emulator.h"
+
+static volatile std::sig_atomic_t stopped = 0;
+
+// Runs a local stand-in for Deribit's FIX gateway, see
+// `emulator_settings.cfg` for the settings it takes.
+int main(int argc, char** argv) {
+  try {
+    FIX::SessionSettings settings(argc > 1 ? argv[1]
+                                           : "emulator_settings.cfg");
+
+    Emulator application(Emulator::read_settings(settings));
+    FIX::MemoryStoreFactory store_factory;
+    // Only session events are printed, logging every message would make the
+    // emulator the bottleneck
+    FIX::ScreenLogFactory log_factory(false, false, true);
+    FIX::SocketAcceptor acceptor(application, store_factory, settings,
+                                 log_factory);
+
+    std::signal(SIGINT, [](int) { stopped = 1; });
+    std::signal(SIGTERM, [](int) { stopped = 1; });
+
+    acceptor.start();
+    application.start();
+
+    // Report what was sent every second, a rate below the configured one
+    // means the initiator is not keeping up
+    uint64_t messages = 0;
+    uint64_t entries = 0;
+    while (!stopped) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      std::cout << application.messages() - messages << " msg/s "
+                << application.entries() - entries << " entries/s"
+                << std::endl;
+      messages = application.messages();
+      entries = application.entries();
+    }
+
+    application.stop();
+    acceptor.stop();
+    return 0;
+  } catch (std::exception const& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../../src/datasources/journal.h"
+
+static char const* kind_name(Journal::RecordKind kind) {
+  switch (kind) {
+    case Journal::RecordKind::Stored:
+      return "stored";
+    case Journal::RecordKind::Incoming:
+      return "incoming";
+    case Journal::RecordKind::Outgoing:
+      return "outgoing";
+    case Journal::RecordKind::Event:
+      return "event";
+  }
+  return "unknown";
+}
+
+// Prints the records of journals written by the async store, one per line
+// with SOH shown as '|', the way QuickFIX's file log would have written them.
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <journal>..." << std::endl;
+    return 1;
+  }
+
+  try {
+    for (int i = 1; i < argc; i++) {
+      Journal::Reader reader(argv[i]);
+      Journal::Record record;
+      while (reader.next(record)) {
+        std::time_t seconds = record.timestamp / 1000000000;
+        std::tm time;
+        gmtime_r(&seconds, &time);
+
+        std::string data(record.data);
+        std::replace(data.begin(), data.end(), '\x01', '|');
+        std::cout << std::put_time(&time, "%Y%m%d-%H:%M:%S") << '.'
+                  << std::setw(9) << std::setfill('0')
+                  << record.timestamp % 1000000000 << std::setfill(' ') << ' '
+                  << kind_name(record.kind);
+        if (record.kind == Journal::RecordKind::Stored)
+          std::cout << ' ' << record.sequence;
+        std::cout << " : " << data << '\n';
+      }
+    }
+    return 0;
+  } catch (std::exception const& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+}